@@ -0,0 +1,576 @@
+/****************************************************************************
+ * benchmark.c
+ * openacousticdevices.info
+ * October 2026
+ *****************************************************************************/
+
+/* Measure the host cost of each filter and trigger path against the DMA period, and of each compressed file encoder against the SRAM buffer period, at each supported sample rate. Finish by measuring the cycle counts used by the automatic energy saver mode cost model in main.c */
+
+#include <math.h>
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "audiomothstub.h"
+#include "digitalfilter.h"
+#include "flac.h"
+#include "adpcm.h"
+
+/* The Costas loop is private to the acoustic configuration receiver */
+
+#include "../src/audioconfig.c"
+
+/* Buffer constants matching main.c */
+
+#define MAXIMUM_SAMPLES_IN_DMA_TRANSFER         1024
+#define NUMBER_OF_SAMPLES_IN_BUFFER             16384
+
+/* Benchmark constants */
+
+#define BENCHMARK_DURATION_IN_SECONDS           2
+#define TEST_TONE_FREQUENCY                     4000
+#define TEST_TONE_AMPLITUDE                     4000
+#define NOISE_AMPLITUDE                         500
+
+#define BAND_PASS_LOWER_FREQUENCY               1000
+#define BAND_PASS_HIGHER_FREQUENCY              3000
+#define DC_BLOCKING_FREQUENCY                   48
+
+#define AMPLITUDE_THRESHOLD                     30000
+#define FREQUENCY_TRIGGER_WINDOW_LENGTH         64
+#define FREQUENCY_TRIGGER_THRESHOLD             100.0f
+#define SPECTRAL_TRIGGER_WINDOW_LENGTH          512
+#define SPECTRAL_TRIGGER_RATIO                  60.0f
+
+#define NUMBER_OF_ENCODED_BUFFERS               256
+
+/* Cost model constants. Each measurement keeps the fastest of several runs to reject interruptions by the host, and the fixed cost of a transfer is found from two transfer sizes */
+
+#define COST_MODEL_REPEATS                      5
+#define COST_MODEL_SAMPLE_RATE                  384000
+#define COST_MODEL_ENCODER_SAMPLE_RATE          48000
+#define COST_MODEL_SHORT_TRANSFER               64
+
+static const uint32_t decimationDividers[] = {2, 4, 8, 12, 24, 48};
+
+#define NUMBER_OF_DECIMATION_DIVIDERS           (sizeof(decimationDividers) / sizeof(uint32_t))
+
+#define NANOSECONDS_IN_SECOND                   1000000000.0
+#define MICROSECONDS_IN_SECOND                  1000000.0
+
+/* Useful macros */
+
+#define MIN(a, b)                               ((a) < (b) ? (a) : (b))
+#define MAX(a, b)                               ((a) > (b) ? (a) : (b))
+
+/* Supported sample rates as configured by the configuration app */
+
+typedef struct {
+    uint32_t sampleRate;
+    uint32_t sampleRateDivider;
+} sampleRate_t;
+
+static const sampleRate_t sampleRates[] = {
+    {384000, 48},
+    {384000, 24},
+    {384000, 12},
+    {384000, 8},
+    {384000, 4},
+    {384000, 2},
+    {250000, 1},
+    {384000, 1}
+};
+
+#define NUMBER_OF_SAMPLE_RATES                  (sizeof(sampleRates) / sizeof(sampleRate_t))
+
+/* Filter and trigger paths */
+
+typedef enum {HIGH_PASS, BAND_PASS} filter_t;
+
+typedef enum {NO_TRIGGER, AMPLITUDE_TRIGGER, FREQUENCY_TRIGGER, SPECTRAL_TRIGGER} trigger_t;
+
+typedef struct {
+    char *name;
+    filter_t filter;
+    bool fixedPoint;
+    trigger_t trigger;
+} path_t;
+
+static const path_t paths[] = {
+    {"High-pass", HIGH_PASS, false, NO_TRIGGER},
+    {"Band-pass", BAND_PASS, false, NO_TRIGGER},
+    {"Band-pass + amplitude", BAND_PASS, false, AMPLITUDE_TRIGGER},
+    {"Band-pass + Goertzel", BAND_PASS, false, FREQUENCY_TRIGGER},
+    {"Band-pass + spectral", BAND_PASS, false, SPECTRAL_TRIGGER},
+    {"Fixed high-pass", HIGH_PASS, true, NO_TRIGGER},
+    {"Fixed band-pass", BAND_PASS, true, NO_TRIGGER},
+    {"Fixed band-pass + amplitude", BAND_PASS, true, AMPLITUDE_TRIGGER},
+    {"Fixed band-pass + Goertzel", BAND_PASS, true, FREQUENCY_TRIGGER}
+};
+
+#define NUMBER_OF_PATHS                         (sizeof(paths) / sizeof(path_t))
+
+/* Higher order filters use float arithmetic and no trigger */
+
+static const uint32_t filterOrders[] = {4, 6, 8};
+
+#define NUMBER_OF_FILTER_ORDERS                 (sizeof(filterOrders) / sizeof(uint32_t))
+
+/* Compressed file encoders */
+
+typedef enum {FLAC_ENCODER, IMA_ADPCM_ENCODER} encoder_t;
+
+static const char *encoderNames[] = {"FLAC", "IMA-ADPCM"};
+
+#define NUMBER_OF_ENCODERS                      (sizeof(encoderNames) / sizeof(char*))
+
+/* Sample buffers */
+
+static int16_t source[MAXIMUM_SAMPLES_IN_DMA_TRANSFER];
+
+static int16_t destination[NUMBER_OF_SAMPLES_IN_BUFFER];
+
+static int16_t buffer[NUMBER_OF_SAMPLES_IN_BUFFER];
+
+/* Handlers required by the stub and the acoustic configuration receiver */
+
+void AudioMoth_handleSwitchInterrupt() { }
+
+void AudioMoth_handleDirectMemoryAccessInterrupt(bool isPrimaryBuffer, int16_t **nextBuffer) {
+
+    AudioConfig_handleDirectMemoryAccessInterrupt(isPrimaryBuffer, nextBuffer);
+
+}
+
+void AudioConfig_handleAudioConfigurationEvent(AC_audioConfigurationEvent_t event) { }
+
+void AudioConfig_handleAudioConfigurationPacket(uint8_t *receiveBuffer, uint32_t size) { }
+
+/* Timing functions */
+
+static double getSeconds() {
+
+    struct timespec time;
+
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    return (double)time.tv_sec + (double)time.tv_nsec / NANOSECONDS_IN_SECOND;
+
+}
+
+static uint64_t getCycles() {
+
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+
+}
+
+/* Generate a noisy test tone at the raw sample rate */
+
+static void generateSamples(int16_t *buffer, uint32_t numberOfSamples, uint32_t sampleRate) {
+
+    static uint32_t phase;
+
+    for (uint32_t i = 0; i < numberOfSamples; i += 1) {
+
+        float tone = TEST_TONE_AMPLITUDE * sinf(2.0f * (float)M_PI * (float)TEST_TONE_FREQUENCY * (float)phase / (float)sampleRate);
+
+        float noise = NOISE_AMPLITUDE * ((float)rand() / (float)RAND_MAX - 0.5f);
+
+        buffer[i] = (int16_t)(tone + noise);
+
+        phase = (phase + 1) % sampleRate;
+
+    }
+
+}
+
+/* Configure the digital filter as makeRecording does */
+
+static void configureFilter(const path_t *path, uint32_t sampleRate, uint32_t sampleRateDivider, uint32_t filterOrder) {
+
+    uint32_t effectiveSampleRate = sampleRate / sampleRateDivider;
+
+    DigitalFilter_reset();
+
+    DigitalFilter_setFixedPointArithmetic(path->fixedPoint);
+
+    DigitalFilter_setDecimationFilter(sampleRateDivider);
+
+    DigitalFilter_setFilterOrder(filterOrder);
+
+    if (path->filter == HIGH_PASS) {
+
+        DigitalFilter_designHighPassFilter(effectiveSampleRate, DC_BLOCKING_FREQUENCY);
+
+    } else {
+
+        DigitalFilter_designBandPassFilter(effectiveSampleRate, BAND_PASS_LOWER_FREQUENCY, BAND_PASS_HIGHER_FREQUENCY);
+
+    }
+
+    DigitalFilter_setAdditionalGain(16.0f / (float)sampleRateDivider);
+
+    if (path->trigger == AMPLITUDE_TRIGGER) DigitalFilter_setAmplitudeThreshold(AMPLITUDE_THRESHOLD);
+
+    if (path->trigger == FREQUENCY_TRIGGER) DigitalFilter_setFrequencyTrigger(FREQUENCY_TRIGGER_WINDOW_LENGTH, effectiveSampleRate, MIN(effectiveSampleRate / 2, TEST_TONE_FREQUENCY), FREQUENCY_TRIGGER_THRESHOLD);
+
+    if (path->trigger == SPECTRAL_TRIGGER) DigitalFilter_setSpectralTrigger(SPECTRAL_TRIGGER_WINDOW_LENGTH, effectiveSampleRate, BAND_PASS_LOWER_FREQUENCY, BAND_PASS_HIGHER_FREQUENCY, SPECTRAL_TRIGGER_RATIO);
+
+    DigitalFilter_setTriggerActive(false);
+
+}
+
+/* Match the DMA transfer size calculation in makeRecording */
+
+static uint32_t getNumberOfRawSamplesInDMATransfer(uint32_t sampleRateDivider) {
+
+    uint32_t numberOfRawSamples = MAXIMUM_SAMPLES_IN_DMA_TRANSFER / sampleRateDivider;
+
+    while (numberOfRawSamples & (numberOfRawSamples - 1)) numberOfRawSamples = numberOfRawSamples & (numberOfRawSamples - 1);
+
+    return numberOfRawSamples * sampleRateDivider;
+
+}
+
+/* Run one path for the benchmark duration and return the processing time per DMA transfer in seconds and the host cycles per DMA transfer. Triggers evaluated on whole SRAM buffers in the main loop are charged to each transfer pro rata */
+
+static double measurePath(const path_t *path, uint32_t sampleRate, uint32_t sampleRateDivider, uint32_t filterOrder, uint32_t numberOfRawSamples, double *cyclesPerTransfer) {
+
+    uint32_t numberOfOutputSamples = numberOfRawSamples / sampleRateDivider;
+
+    uint32_t numberOfTransfers = BENCHMARK_DURATION_IN_SECONDS * sampleRate / numberOfRawSamples;
+
+    uint32_t transfersPerBuffer = NUMBER_OF_SAMPLES_IN_BUFFER / numberOfOutputSamples;
+
+    bool triggerInMainLoop = path->trigger == SPECTRAL_TRIGGER || (path->trigger == FREQUENCY_TRIGGER && sampleRateDivider > 1);
+
+    configureFilter(path, sampleRate, sampleRateDivider, filterOrder);
+
+    generateSamples(source, numberOfRawSamples, sampleRate);
+
+    double startTime = getSeconds();
+
+    uint64_t startCycles = getCycles();
+
+    uint32_t writeIndex = 0;
+
+    for (uint32_t i = 0; i < numberOfTransfers; i += 1) {
+
+        DigitalFilter_applyFilter(source, destination + writeIndex, sampleRateDivider, numberOfRawSamples);
+
+        writeIndex += numberOfOutputSamples;
+
+        if (writeIndex == transfersPerBuffer * numberOfOutputSamples) {
+
+            writeIndex = 0;
+
+            if (triggerInMainLoop && path->trigger == SPECTRAL_TRIGGER) DigitalFilter_applySpectralTrigger(destination, NUMBER_OF_SAMPLES_IN_BUFFER);
+
+            if (triggerInMainLoop && path->trigger == FREQUENCY_TRIGGER) DigitalFilter_applyFrequencyTrigger(destination, NUMBER_OF_SAMPLES_IN_BUFFER);
+
+        }
+
+    }
+
+    *cyclesPerTransfer = (double)(getCycles() - startCycles) / (double)numberOfTransfers;
+
+    return (getSeconds() - startTime) / (double)numberOfTransfers;
+
+}
+
+/* Encode SRAM buffers as the main loop of makeRecording does and return the processing time per buffer in seconds and the host cycles per buffer */
+
+static double measureEncoder(encoder_t encoder, uint32_t effectiveSampleRate, double *cyclesPerBuffer) {
+
+    generateSamples(buffer, NUMBER_OF_SAMPLES_IN_BUFFER, effectiveSampleRate);
+
+    if (encoder == FLAC_ENCODER) FLAC_initialise(effectiveSampleRate);
+
+    if (encoder == IMA_ADPCM_ENCODER) ADPCM_initialise();
+
+    volatile uint32_t numberOfBytes = 0;
+
+    double startTime = getSeconds();
+
+    uint64_t startCycles = getCycles();
+
+    for (uint32_t i = 0; i < NUMBER_OF_ENCODED_BUFFERS; i += 1) {
+
+        if (encoder == FLAC_ENCODER) {
+
+            for (uint32_t j = 0; j < NUMBER_OF_SAMPLES_IN_BUFFER; j += FLAC_BLOCK_SIZE) {
+
+                uint32_t frameSize;
+
+                FLAC_encodeFrame(buffer + j, FLAC_BLOCK_SIZE, &frameSize);
+
+                numberOfBytes += frameSize;
+
+            }
+
+        } else {
+
+            uint32_t numberOfSamplesEncoded = 0;
+
+            while (numberOfSamplesEncoded < NUMBER_OF_SAMPLES_IN_BUFFER) {
+
+                uint8_t *block;
+
+                numberOfSamplesEncoded += ADPCM_encode(buffer + numberOfSamplesEncoded, NUMBER_OF_SAMPLES_IN_BUFFER - numberOfSamplesEncoded, &block);
+
+                if (block) numberOfBytes += ADPCM_BLOCK_SIZE;
+
+            }
+
+        }
+
+    }
+
+    *cyclesPerBuffer = (double)(getCycles() - startCycles) / (double)NUMBER_OF_ENCODED_BUFFERS;
+
+    return (getSeconds() - startTime) / (double)NUMBER_OF_ENCODED_BUFFERS;
+
+}
+
+/* Return the fastest of several runs of a band-pass path in host cycles per DMA transfer at the cost model sample rate */
+
+static double measureFastestPath(const path_t *path, uint32_t sampleRateDivider, uint32_t filterOrder, uint32_t numberOfRawSamples) {
+
+    double fastestCycles = INFINITY;
+
+    for (uint32_t i = 0; i < COST_MODEL_REPEATS; i += 1) {
+
+        double cyclesPerTransfer;
+
+        measurePath(path, COST_MODEL_SAMPLE_RATE, sampleRateDivider, filterOrder, numberOfRawSamples, &cyclesPerTransfer);
+
+        fastestCycles = MIN(fastestCycles, cyclesPerTransfer);
+
+    }
+
+    return fastestCycles;
+
+}
+
+/* Return the fastest of several runs of an encoder in host cycles per sample */
+
+static double measureFastestEncoder(encoder_t encoder) {
+
+    double fastestCycles = INFINITY;
+
+    for (uint32_t i = 0; i < COST_MODEL_REPEATS; i += 1) {
+
+        double cyclesPerBuffer;
+
+        measureEncoder(encoder, COST_MODEL_ENCODER_SAMPLE_RATE, &cyclesPerBuffer);
+
+        fastestCycles = MIN(fastestCycles, cyclesPerBuffer);
+
+    }
+
+    return fastestCycles / (double)NUMBER_OF_SAMPLES_IN_BUFFER;
+
+}
+
+/* Print one cost model constant rounded up to whole cycles */
+
+static void printConstant(char *name, double cycles) {
+
+    printf("%-40s %8.0f\n", name, ceil(MAX(1.0, cycles)));
+
+}
+
+/* Separate the cost of each stage from the differences between paths. Higher order filters add two sections for each step of the order */
+
+static void measureCostModel() {
+
+    const path_t *bandPass = paths + 1;
+
+    const path_t *amplitudeTrigger = paths + 2;
+
+    const path_t *frequencyTrigger = paths + 3;
+
+    const path_t *spectralTrigger = paths + 4;
+
+    uint32_t numberOfRawSamples = getNumberOfRawSamplesInDMATransfer(1);
+
+    double transferCycles = measureFastestPath(bandPass, 1, 0, numberOfRawSamples);
+
+    double shortTransferCycles = measureFastestPath(bandPass, 1, 0, COST_MODEL_SHORT_TRANSFER);
+
+    double filterCycles = (transferCycles - shortTransferCycles) / (double)(numberOfRawSamples - COST_MODEL_SHORT_TRANSFER);
+
+    double interruptCycles = shortTransferCycles - COST_MODEL_SHORT_TRANSFER * filterCycles;
+
+    /* The decimation filter has the same number of taps per phase at each divider so report the most expensive */
+
+    double decimationCycles = 0.0;
+
+    for (uint32_t i = 0; i < NUMBER_OF_DECIMATION_DIVIDERS; i += 1) {
+
+        uint32_t sampleRateDivider = decimationDividers[i];
+
+        uint32_t numberOfDecimatedSamples = getNumberOfRawSamplesInDMATransfer(sampleRateDivider);
+
+        double cycles = measureFastestPath(bandPass, sampleRateDivider, 0, numberOfDecimatedSamples);
+
+        cycles -= interruptCycles + numberOfDecimatedSamples / sampleRateDivider * filterCycles;
+
+        decimationCycles = MAX(decimationCycles, cycles / (double)numberOfDecimatedSamples);
+
+    }
+
+    double sectionCycles = (measureFastestPath(bandPass, 1, 8, numberOfRawSamples) - measureFastestPath(bandPass, 1, 4, numberOfRawSamples)) / (double)(2 * numberOfRawSamples);
+
+    printf("\nHost cycle counts for the automatic energy saver mode cost model in main.c\n\n");
+
+    printConstant("DMA_INTERRUPT_CYCLES", interruptCycles);
+
+    printConstant("DECIMATION_CYCLES_PER_RAW_SAMPLE", decimationCycles);
+
+    printConstant("FILTER_CYCLES_PER_SAMPLE", filterCycles);
+
+    printConstant("FILTER_CYCLES_PER_SECTION", sectionCycles);
+
+    printConstant("AMPLITUDE_THRESHOLD_CYCLES_PER_SAMPLE", (measureFastestPath(amplitudeTrigger, 1, 0, numberOfRawSamples) - transferCycles) / (double)numberOfRawSamples);
+
+    printConstant("FREQUENCY_TRIGGER_CYCLES_PER_SAMPLE", (measureFastestPath(frequencyTrigger, 1, 0, numberOfRawSamples) - transferCycles) / (double)numberOfRawSamples);
+
+    printConstant("SPECTRAL_TRIGGER_CYCLES_PER_SAMPLE", (measureFastestPath(spectralTrigger, 1, 0, numberOfRawSamples) - transferCycles) / (double)numberOfRawSamples);
+
+    printConstant("FLAC_CYCLES_PER_SAMPLE", measureFastestEncoder(FLAC_ENCODER));
+
+    printConstant("IMA_ADPCM_CYCLES_PER_SAMPLE", measureFastestEncoder(IMA_ADPCM_ENCODER));
+
+}
+
+/* Print one result row */
+
+static void printResult(char *name, uint32_t effectiveSampleRate, uint32_t rawSampleRate, uint32_t numberOfRawSamples, double secondsPerTransfer) {
+
+    double dmaPeriod = (double)numberOfRawSamples / (double)rawSampleRate;
+
+    double nanosecondsPerSample = secondsPerTransfer * NANOSECONDS_IN_SECOND / (double)numberOfRawSamples;
+
+    double headroom = 100.0 * (1.0 - secondsPerTransfer / dmaPeriod);
+
+    printf("%7u  %-30s %10.2f %12.2f %12.1f %9.2f%%\n", effectiveSampleRate, name, nanosecondsPerSample, secondsPerTransfer * MICROSECONDS_IN_SECOND, dmaPeriod * MICROSECONDS_IN_SECOND, headroom);
+
+}
+
+static void printHeader(char *name, char *cost, char *period) {
+
+    printf("%7s  %-30s %10s %12s %12s %10s\n", "Rate", name, "ns/sample", cost, period, "Headroom");
+
+}
+
+/* Measure the acoustic configuration Costas loop over DMA blocks */
+
+static void benchmarkCostasLoop() {
+
+    static int16_t block[CONFIG_DMA_BLOCK_SIZE];
+
+    AudioConfig_enableAudioConfiguration();
+
+    AudioConfig_disableAudioConfiguration();
+
+    uint32_t numberOfBlocks = BENCHMARK_DURATION_IN_SECONDS * CONFIG_SAMPLE_RATE / CONFIG_DMA_BLOCK_SIZE;
+
+    generateSamples(block, CONFIG_DMA_BLOCK_SIZE, CONFIG_SAMPLE_RATE);
+
+    volatile float output = 0.0f;
+
+    double startTime = getSeconds();
+
+    for (uint32_t i = 0; i < numberOfBlocks; i += 1) {
+
+        for (uint32_t j = 0; j < CONFIG_DMA_BLOCK_SIZE; j += 1) output += updateCostasLoop(block[j]);
+
+    }
+
+    printResult("Costas loop", CONFIG_SAMPLE_RATE, CONFIG_SAMPLE_RATE, CONFIG_DMA_BLOCK_SIZE, (getSeconds() - startTime) / (double)numberOfBlocks);
+
+}
+
+int main(int argc, char **argv) {
+
+    printf("Host processing cost per DMA transfer. The headroom is measured on this host and does not represent the device\n\n");
+
+    printHeader("Path", "us/transfer", "DMA us");
+
+    for (uint32_t i = 0; i < NUMBER_OF_SAMPLE_RATES; i += 1) {
+
+        uint32_t sampleRate = sampleRates[i].sampleRate;
+
+        uint32_t sampleRateDivider = sampleRates[i].sampleRateDivider;
+
+        for (uint32_t j = 0; j < NUMBER_OF_PATHS; j += 1) {
+
+            double cyclesPerTransfer;
+
+            uint32_t numberOfRawSamples = getNumberOfRawSamplesInDMATransfer(sampleRateDivider);
+
+            double secondsPerTransfer = measurePath(paths + j, sampleRate, sampleRateDivider, 0, numberOfRawSamples, &cyclesPerTransfer);
+
+            printResult(paths[j].name, sampleRate / sampleRateDivider, sampleRate, numberOfRawSamples, secondsPerTransfer);
+
+        }
+
+        for (uint32_t j = 0; j < NUMBER_OF_FILTER_ORDERS; j += 1) {
+
+            for (uint32_t k = 0; k < 2; k += 1) {
+
+                char name[32];
+
+                double cyclesPerTransfer;
+
+                uint32_t numberOfRawSamples = getNumberOfRawSamplesInDMATransfer(sampleRateDivider);
+
+                double secondsPerTransfer = measurePath(paths + k, sampleRate, sampleRateDivider, filterOrders[j], numberOfRawSamples, &cyclesPerTransfer);
+
+                sprintf(name, "%s order %u", paths[k].name, filterOrders[j]);
+
+                printResult(name, sampleRate / sampleRateDivider, sampleRate, numberOfRawSamples, secondsPerTransfer);
+
+            }
+
+        }
+
+        printf("\n");
+
+    }
+
+    benchmarkCostasLoop();
+
+    printf("\nHost encoding cost per SRAM buffer of %u samples\n\n", NUMBER_OF_SAMPLES_IN_BUFFER);
+
+    printHeader("Encoder", "us/buffer", "Buffer us");
+
+    for (uint32_t i = 0; i < NUMBER_OF_SAMPLE_RATES; i += 1) {
+
+        uint32_t effectiveSampleRate = sampleRates[i].sampleRate / sampleRates[i].sampleRateDivider;
+
+        for (uint32_t j = 0; j < NUMBER_OF_ENCODERS; j += 1) {
+
+            double cyclesPerBuffer;
+
+            printResult((char*)encoderNames[j], effectiveSampleRate, effectiveSampleRate, NUMBER_OF_SAMPLES_IN_BUFFER, measureEncoder(j, effectiveSampleRate, &cyclesPerBuffer));
+
+        }
+
+    }
+
+    measureCostModel();
+
+    return 0;
+
+}
@@ -0,0 +1,340 @@
+/****************************************************************************
+ * estimator.c
+ * openacousticdevices.info
+ * October 2026
+ *****************************************************************************/
+
+/* Print the processing load estimated by the automatic energy saver mode cost model in main.c, and the decision it makes, for a configuration at each supported sample rate. Each estimate is shown beside the host cycles taken by the DSP modules to process one second of audio with the same configuration */
+
+#include <stdio.h>
+#include <getopt.h>
+#include <stdlib.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "audiomothstub.h"
+
+/* Build the firmware into this program with its entry point renamed */
+
+#define main firmwareMain
+
+#include "../src/main.c"
+
+#undef main
+
+/* Estimator constants */
+
+#define MEASUREMENT_REPEATS                     5
+#define DEFAULT_WINDOW_LENGTH_SHIFT             9
+
+/* The frequency and spectral triggers stop at the first window that exceeds the threshold, so thresholds that are never reached give the worst case which the cost model must cover */
+
+#define UNREACHABLE_PERCENTAGE_THRESHOLD        100.0f
+#define UNREACHABLE_RATIO_DECIBELS              120
+
+#define TEST_TONE_FREQUENCY                     4000
+#define TEST_TONE_AMPLITUDE                     4000
+#define NOISE_AMPLITUDE                         500
+
+#define CYCLES_IN_MEGACYCLE                     1000000.0
+
+/* Supported sample rates as configured by the configuration app */
+
+typedef struct {
+    uint32_t sampleRate;
+    uint32_t sampleRateDivider;
+} sampleRate_t;
+
+static const sampleRate_t sampleRates[] = {
+    {384000, 48},
+    {384000, 24},
+    {384000, 12},
+    {384000, 8},
+    {384000, 4},
+    {384000, 2},
+    {250000, 1},
+    {384000, 1}
+};
+
+#define NUMBER_OF_SAMPLE_RATES                  (sizeof(sampleRates) / sizeof(sampleRate_t))
+
+/* Sample buffers */
+
+static int16_t source[MAXIMUM_SAMPLES_IN_DMA_TRANSFER];
+
+static int16_t buffer[NUMBER_OF_SAMPLES_IN_BUFFER];
+
+/* Timing function */
+
+static uint64_t getCycles() {
+
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+
+}
+
+/* Generate a noisy test tone at the raw sample rate */
+
+static void generateSamples(int16_t *samples, uint32_t numberOfSamples, uint32_t sampleRate) {
+
+    for (uint32_t i = 0; i < numberOfSamples; i += 1) {
+
+        float tone = TEST_TONE_AMPLITUDE * sinf(2.0f * (float)M_PI * (float)TEST_TONE_FREQUENCY * (float)i / (float)sampleRate);
+
+        float noise = NOISE_AMPLITUDE * ((float)rand() / (float)RAND_MAX - 0.5f);
+
+        samples[i] = (int16_t)(tone + noise);
+
+    }
+
+}
+
+/* Configure the filter and trigger as makeRecording does */
+
+static void configureDigitalFilter(configSettings_t *configSettings, extendedConfigSettings_t *extendedConfigSettings) {
+
+    uint32_t effectiveSampleRate = configSettings->sampleRate / configSettings->sampleRateDivider;
+
+    uint32_t lowerFilterFrequency = MAX(DEFAULT_DC_BLOCKING_FREQ, FILTER_FREQ_MULTIPLIER * configSettings->lowerFilterFreq);
+
+    uint32_t higherFilterFrequency = FILTER_FREQ_MULTIPLIER * configSettings->higherFilterFreq;
+
+    DigitalFilter_reset();
+
+    DigitalFilter_setFixedPointArithmetic(configSettings->enableFixedPointFilter);
+
+    DigitalFilter_setDecimationFilter(configSettings->sampleRateDivider);
+
+    DigitalFilter_setFilterOrder(getFilterOrder(configSettings));
+
+    if (configSettings->lowerFilterFreq == 0 && configSettings->higherFilterFreq == 0) {
+
+        DigitalFilter_designHighPassFilter(effectiveSampleRate, DEFAULT_DC_BLOCKING_FREQ);
+
+    } else if (configSettings->lowerFilterFreq == UINT16_MAX) {
+
+        DigitalFilter_designBandPassFilter(effectiveSampleRate, DEFAULT_DC_BLOCKING_FREQ, higherFilterFrequency);
+
+    } else if (configSettings->higherFilterFreq == UINT16_MAX) {
+
+        DigitalFilter_designHighPassFilter(effectiveSampleRate, lowerFilterFrequency);
+
+    } else {
+
+        DigitalFilter_designBandPassFilter(effectiveSampleRate, lowerFilterFrequency, higherFilterFrequency);
+
+    }
+
+    DigitalFilter_setAdditionalGain(16.0f / (float)configSettings->sampleRateDivider);
+
+    uint32_t windowLength = MIN(FREQUENCY_TRIGGER_WINDOW_MAXIMUM, MAX(FREQUENCY_TRIGGER_WINDOW_MINIMUM, 1 << configSettings->frequencyTriggerWindowLengthShift));
+
+    uint32_t centreFrequency = MIN(effectiveSampleRate / 2, FILTER_FREQ_MULTIPLIER * configSettings->frequencyTriggerCentreFrequency);
+
+    if (configSettings->enableFrequencyTrigger && extendedConfigSettings->enableSpectralTrigger) {
+
+        uint32_t halfBandwidth = FILTER_FREQ_MULTIPLIER * extendedConfigSettings->spectralTriggerBandwidth / 2;
+
+        uint32_t lowerFrequency = centreFrequency > halfBandwidth ? centreFrequency - halfBandwidth : 0;
+
+        uint32_t higherFrequency = MIN(effectiveSampleRate / 2, centreFrequency + halfBandwidth);
+
+        DigitalFilter_setSpectralTrigger(MAX(SPECTRAL_TRIGGER_WINDOW_MINIMUM, windowLength), effectiveSampleRate, lowerFrequency, higherFrequency, (float)UNREACHABLE_RATIO_DECIBELS);
+
+    } else if (configSettings->enableFrequencyTrigger) {
+
+        DigitalFilter_setFrequencyTrigger(windowLength, effectiveSampleRate, centreFrequency, UNREACHABLE_PERCENTAGE_THRESHOLD);
+
+        for (uint32_t i = 0; i < MAXIMUM_ADDITIONAL_FREQUENCY_TRIGGERS; i += 1) {
+
+            if (extendedConfigSettings->additionalFrequencyTriggers[i].centreFrequency > 0) DigitalFilter_addFrequencyTrigger(effectiveSampleRate, centreFrequency, UNREACHABLE_PERCENTAGE_THRESHOLD);
+
+        }
+
+    } else if (configSettings->amplitudeThreshold > 0) {
+
+        DigitalFilter_setAmplitudeThreshold(configSettings->amplitudeThreshold);
+
+    }
+
+    DigitalFilter_setTriggerActive(false);
+
+}
+
+/* Process one second of audio through the filter, trigger and encoder as makeRecording does with every buffer written, and return the host cycles taken */
+
+static uint64_t measureProcessingCycles(configSettings_t *configSettings, extendedConfigSettings_t *extendedConfigSettings) {
+
+    uint32_t effectiveSampleRate = configSettings->sampleRate / configSettings->sampleRateDivider;
+
+    uint32_t numberOfRawSamples = MAXIMUM_SAMPLES_IN_DMA_TRANSFER / configSettings->sampleRateDivider;
+
+    while (numberOfRawSamples & (numberOfRawSamples - 1)) numberOfRawSamples = numberOfRawSamples & (numberOfRawSamples - 1);
+
+    numberOfRawSamples *= configSettings->sampleRateDivider;
+
+    uint32_t numberOfOutputSamples = numberOfRawSamples / configSettings->sampleRateDivider;
+
+    bool evaluateInMainLoop = configSettings->enableFrequencyTrigger && (extendedConfigSettings->enableSpectralTrigger || configSettings->sampleRateDivider > 1);
+
+    configureDigitalFilter(configSettings, extendedConfigSettings);
+
+    if (extendedConfigSettings->fileFormat == FLAC_FILE_FORMAT) FLAC_initialise(effectiveSampleRate);
+
+    if (extendedConfigSettings->fileFormat == IMA_ADPCM_FILE_FORMAT) ADPCM_initialise();
+
+    generateSamples(source, numberOfRawSamples, configSettings->sampleRate);
+
+    uint32_t numberOfBuffers = MAX(1, effectiveSampleRate / NUMBER_OF_SAMPLES_IN_BUFFER);
+
+    uint64_t startCycles = getCycles();
+
+    for (uint32_t i = 0; i < numberOfBuffers; i += 1) {
+
+        for (uint32_t j = 0; j < NUMBER_OF_SAMPLES_IN_BUFFER; j += numberOfOutputSamples) {
+
+            DigitalFilter_applyFilter(source, buffer + j, configSettings->sampleRateDivider, numberOfRawSamples);
+
+        }
+
+        if (evaluateInMainLoop && extendedConfigSettings->enableSpectralTrigger) DigitalFilter_applySpectralTrigger(buffer, NUMBER_OF_SAMPLES_IN_BUFFER);
+
+        if (evaluateInMainLoop && extendedConfigSettings->enableSpectralTrigger == false) DigitalFilter_applyFrequencyTrigger(buffer, NUMBER_OF_SAMPLES_IN_BUFFER);
+
+        for (uint32_t j = 0; j < NUMBER_OF_SAMPLES_IN_BUFFER && extendedConfigSettings->fileFormat == FLAC_FILE_FORMAT; j += FLAC_BLOCK_SIZE) {
+
+            uint32_t frameSize;
+
+            FLAC_encodeFrame(buffer + j, FLAC_BLOCK_SIZE, &frameSize);
+
+        }
+
+        uint32_t numberOfSamplesEncoded = 0;
+
+        while (numberOfSamplesEncoded < NUMBER_OF_SAMPLES_IN_BUFFER && extendedConfigSettings->fileFormat == IMA_ADPCM_FILE_FORMAT) {
+
+            uint8_t *block;
+
+            numberOfSamplesEncoded += ADPCM_encode(buffer + numberOfSamplesEncoded, NUMBER_OF_SAMPLES_IN_BUFFER - numberOfSamplesEncoded, &block);
+
+        }
+
+    }
+
+    uint64_t cycles = getCycles() - startCycles;
+
+    return cycles * effectiveSampleRate / (numberOfBuffers * NUMBER_OF_SAMPLES_IN_BUFFER);
+
+}
+
+static void printUsage(char *name) {
+
+    fprintf(stderr, "Usage: %s [options]\n\n", name);
+    fprintf(stderr, "  -f format      File format: wav, flac or adpcm\n");
+    fprintf(stderr, "  -b low:high    Band-pass filter in Hz (0 for no lower or upper edge)\n");
+    fprintf(stderr, "  -o order       Filter order selection from 0 to 3 (default 0)\n");
+    fprintf(stderr, "  -x             Use fixed-point arithmetic\n");
+    fprintf(stderr, "  -a threshold   Amplitude threshold (0 to 32768)\n");
+    fprintf(stderr, "  -g frequency   Frequency trigger centre frequency in Hz\n");
+    fprintf(stderr, "  -n count       Additional frequency triggers (0 to %u)\n", MAXIMUM_ADDITIONAL_FREQUENCY_TRIGGERS);
+    fprintf(stderr, "  -s bandwidth   Use the spectral trigger with this bandwidth in Hz around the frequency trigger\n");
+    fprintf(stderr, "  -w shift       Trigger window length as a power of two (default %u)\n", DEFAULT_WINDOW_LENGTH_SHIFT);
+
+}
+
+int main(int argc, char **argv) {
+
+    configSettings_t settings = defaultConfigSettings;
+
+    extendedConfigSettings_t extendedSettings = defaultExtendedConfigSettings;
+
+    settings.frequencyTriggerWindowLengthShift = DEFAULT_WINDOW_LENGTH_SHIFT;
+
+    extendedSettings.enableAutomaticEnergySaverMode = 1;
+
+    uint32_t lowerFilterFrequency, higherFilterFrequency;
+
+    int option;
+
+    while ((option = getopt(argc, argv, "f:b:o:xa:g:n:s:w:")) != -1) {
+
+        switch (option) {
+
+            case 'f':
+                extendedSettings.fileFormat = strcmp(optarg, "flac") == 0 ? FLAC_FILE_FORMAT : strcmp(optarg, "adpcm") == 0 ? IMA_ADPCM_FILE_FORMAT : WAV_FILE_FORMAT;
+                break;
+            case 'b':
+                if (sscanf(optarg, "%u:%u", &lowerFilterFrequency, &higherFilterFrequency) != 2) {
+                    printUsage(argv[0]);
+                    return 1;
+                }
+                settings.lowerFilterFreq = lowerFilterFrequency == 0 ? UINT16_MAX : lowerFilterFrequency / FILTER_FREQ_MULTIPLIER;
+                settings.higherFilterFreq = higherFilterFrequency == 0 ? UINT16_MAX : higherFilterFrequency / FILTER_FREQ_MULTIPLIER;
+                break;
+            case 'o': settings.filterOrder = atoi(optarg); break;
+            case 'x': settings.enableFixedPointFilter = 1; break;
+            case 'a': settings.amplitudeThreshold = atoi(optarg); break;
+            case 'g':
+                settings.enableFrequencyTrigger = 1;
+                settings.frequencyTriggerCentreFrequency = atoi(optarg) / FILTER_FREQ_MULTIPLIER;
+                break;
+            case 'n':
+                for (uint32_t i = 0; i < MIN(MAXIMUM_ADDITIONAL_FREQUENCY_TRIGGERS, (uint32_t)atoi(optarg)); i += 1) extendedSettings.additionalFrequencyTriggers[i].centreFrequency = 1;
+                break;
+            case 's':
+                extendedSettings.enableSpectralTrigger = 1;
+                extendedSettings.spectralTriggerBandwidth = atoi(optarg) / FILTER_FREQ_MULTIPLIER;
+                break;
+            case 'w': settings.frequencyTriggerWindowLengthShift = atoi(optarg); break;
+            default:
+                printUsage(argv[0]);
+                return 1;
+
+        }
+
+    }
+
+    if (optind != argc || (extendedSettings.enableSpectralTrigger && settings.enableFrequencyTrigger == false)) {
+
+        printUsage(argv[0]);
+
+        return 1;
+
+    }
+
+    /* The energy saver halves the clock so the load is shown against the cycles available at half speed */
+
+    uint64_t availableCycles = (uint64_t)FULL_SPEED_CLOCK_FREQUENCY / 2 * ENERGY_SAVER_MAXIMUM_LOAD_PERCENTAGE / 100;
+
+    printf("Model cycles include SD card transfers at %u cycles per byte. Host cycles are the DSP modules alone\n\n", SD_CARD_CYCLES_PER_BYTE);
+
+    printf("%7s %14s %14s %14s %14s\n", "Rate", "Model Mcyc/s", "Host Mcyc/s", "Half speed", "Energy saver");
+
+    for (uint32_t i = 0; i < NUMBER_OF_SAMPLE_RATES; i += 1) {
+
+        settings.sampleRate = sampleRates[i].sampleRate;
+
+        settings.sampleRateDivider = sampleRates[i].sampleRateDivider;
+
+        uint64_t estimatedCycles = estimateProcessingCyclesPerSecond(&settings, &extendedSettings);
+
+        uint64_t measuredCycles = UINT64_MAX;
+
+        for (uint32_t j = 0; j < MEASUREMENT_REPEATS; j += 1) measuredCycles = MIN(measuredCycles, measureProcessingCycles(&settings, &extendedSettings));
+
+        double load = 100.0 * (double)estimatedCycles / (double)(FULL_SPEED_CLOCK_FREQUENCY / 2);
+
+        printf("%7u %14.2f %14.2f %13.1f%% %14s\n", settings.sampleRate / settings.sampleRateDivider, estimatedCycles / CYCLES_IN_MEGACYCLE, measuredCycles / CYCLES_IN_MEGACYCLE, load, selectEnergySaverMode(&settings, &extendedSettings) ? "Yes" : "No");
+
+    }
+
+    printf("\nThe automatic energy saver mode is selected when the model load at half speed is at most %u%%, or %.2f Mcyc/s\n", ENERGY_SAVER_MAXIMUM_LOAD_PERCENTAGE, availableCycles / CYCLES_IN_MEGACYCLE);
+
+    return 0;
+
+}
@@ -0,0 +1,515 @@
+/****************************************************************************
+ * simulator.c
+ * openacousticdevices.info
+ * October 2026
+ *****************************************************************************/
+
+/* Replay a WAV file through the unmodified firmware with simulated DMA timing and SD card latency */
+
+#include <stdio.h>
+#include <dirent.h>
+#include <getopt.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+
+#include "audiomothstub.h"
+
+/* Build the firmware into this program with its entry point renamed */
+
+#define main firmwareMain
+
+#include "../src/main.c"
+
+#undef main
+
+/* Simulator constants */
+
+#define DEFAULT_START_TIME                      1700000000
+#define DEFAULT_OUTPUT_DIRECTORY                "output"
+
+#define ADC_SCALE_SHIFT                         4
+
+#define MAXIMUM_PATH_LENGTH                     512
+
+/* Cluster size of an SDHC card formatted as FAT32 */
+
+#define SD_CARD_CLUSTER_SIZE_IN_BYTES           32768
+
+/* Supported sample rates as configured by the configuration app */
+
+typedef struct {
+    uint32_t sampleRate;
+    uint32_t sampleRateDivider;
+} sampleRate_t;
+
+static const sampleRate_t sampleRates[] = {
+    {384000, 48},
+    {384000, 24},
+    {384000, 12},
+    {384000, 8},
+    {384000, 4},
+    {384000, 2},
+    {250000, 1},
+    {384000, 1}
+};
+
+#define NUMBER_OF_SAMPLE_RATES                  (sizeof(sampleRates) / sizeof(sampleRate_t))
+
+/* SD card latency model in microseconds. The cost of each cluster added to a file models the search for a free cluster in a fragmented FAT */
+
+typedef struct {
+    uint32_t base;
+    uint32_t perKilobyte;
+    uint32_t jitter;
+    double stallProbability;
+    uint32_t stall;
+    uint32_t perCluster;
+} latencyModel_t;
+
+static latencyModel_t latencyModel = {
+    .base = 1000,
+    .perKilobyte = 100,
+    .jitter = 1000,
+    .stallProbability = 0.0,
+    .stall = 250000,
+    .perCluster = 0
+};
+
+static uint32_t randomState = 1;
+
+/* Input state */
+
+static int16_t *inputSamples;
+
+static uint32_t numberOfInputSamples;
+
+static uint32_t inputIndex;
+
+static uint32_t inputRepeatCount;
+
+static uint32_t rawSamplesPerInputSample;
+
+/* Statistics */
+
+static uint64_t occupancyHistogram[NUMBER_OF_BUFFERS];
+
+static uint32_t maximumOccupancy;
+
+static uint32_t lastNumberOfDroppedBuffers;
+
+static uint64_t totalNumberOfDroppedBuffers;
+
+static uint64_t numberOfStalls;
+
+static uint64_t numberOfFileOperations;
+
+static uint64_t numberOfClusterAllocations[2];
+
+static uint64_t clusterAllocationLatency[2];
+
+static uint64_t maximumRecordingLatency;
+
+/* Deterministic pseudo-random numbers */
+
+static uint32_t nextRandom() {
+
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+
+    return randomState;
+
+}
+
+static double nextUniform() {
+
+    return (double)nextRandom() / 4294967296.0;
+
+}
+
+/* Stub callbacks */
+
+static bool sampleSource(int16_t *buffer, uint32_t numberOfSamples) {
+
+    if (inputIndex >= numberOfInputSamples) return false;
+
+    /* Start the input with the first transfer the firmware records rather than those it discards before the scheduled start */
+
+    if (numberOfCompletedDMABlocks < numberOfDMATransfersToWait) {
+
+        memset(buffer, 0, numberOfSamples * NUMBER_OF_BYTES_IN_SAMPLE);
+
+        return true;
+
+    }
+
+    /* Hold each input sample for the decimation ratio and scale it to the range of the ADC */
+
+    for (uint32_t i = 0; i < numberOfSamples; i += 1) {
+
+        buffer[i] = inputIndex < numberOfInputSamples ? inputSamples[inputIndex] >> ADC_SCALE_SHIFT : 0;
+
+        inputRepeatCount += 1;
+
+        if (inputRepeatCount == rawSamplesPerInputSample) {
+
+            inputRepeatCount = 0;
+
+            inputIndex += 1;
+
+        }
+
+    }
+
+    return true;
+
+}
+
+static uint32_t fileLatency(AM_stubFileOperation_t operation, uint32_t numberOfBytes, uint32_t previousFileSize, uint32_t fileSize) {
+
+    numberOfFileOperations += 1;
+
+    uint64_t latency = latencyModel.base + ((uint64_t)numberOfBytes * latencyModel.perKilobyte / 1024);
+
+    /* Each cluster added to the file is found in the FAT, separately counted before and during the recording */
+
+    if (fileSize > previousFileSize) {
+
+        uint32_t numberOfClusters = ROUNDED_UP_DIV(fileSize, SD_CARD_CLUSTER_SIZE_IN_BYTES) - ROUNDED_UP_DIV(previousFileSize, SD_CARD_CLUSTER_SIZE_IN_BYTES);
+
+        uint32_t index = AudioMothStub_isMicrophoneRunning() ? 1 : 0;
+
+        numberOfClusterAllocations[index] += numberOfClusters;
+
+        clusterAllocationLatency[index] += (uint64_t)numberOfClusters * latencyModel.perCluster;
+
+        latency += (uint64_t)numberOfClusters * latencyModel.perCluster;
+
+    }
+
+    if (latencyModel.jitter > 0) latency += nextRandom() % latencyModel.jitter;
+
+    if (nextUniform() < latencyModel.stallProbability) {
+
+        latency += latencyModel.stall;
+
+        numberOfStalls += 1;
+
+    }
+
+    if (AudioMothStub_isMicrophoneRunning()) maximumRecordingLatency = MAX(maximumRecordingLatency, latency);
+
+    return (uint32_t)MIN(latency, UINT32_MAX);
+
+}
+
+static void interruptObserver() {
+
+    uint32_t occupancy = (writeBuffer - readBuffer) & (NUMBER_OF_BUFFERS - 1);
+
+    occupancyHistogram[occupancy] += 1;
+
+    maximumOccupancy = MAX(maximumOccupancy, occupancy);
+
+    /* The dropped buffer count restarts with each recording */
+
+    if (numberOfDroppedBuffers < lastNumberOfDroppedBuffers) lastNumberOfDroppedBuffers = 0;
+
+    totalNumberOfDroppedBuffers += numberOfDroppedBuffers - lastNumberOfDroppedBuffers;
+
+    lastNumberOfDroppedBuffers = numberOfDroppedBuffers;
+
+}
+
+/* Read a mono 16-bit PCM WAV file */
+
+static bool readWavFile(char *filename, uint32_t *sampleRate) {
+
+    FILE *file = fopen(filename, "rb");
+
+    if (file == NULL) return false;
+
+    chunk_t chunk;
+
+    char format[RIFF_ID_LENGTH];
+
+    bool success = fread(&chunk, sizeof(chunk_t), 1, file) == 1 && memcmp(chunk.id, "RIFF", RIFF_ID_LENGTH) == 0;
+
+    success = success && fread(format, RIFF_ID_LENGTH, 1, file) == 1 && memcmp(format, "WAVE", RIFF_ID_LENGTH) == 0;
+
+    bool formatFound = false;
+
+    while (success && fread(&chunk, sizeof(chunk_t), 1, file) == 1) {
+
+        if (memcmp(chunk.id, "fmt ", RIFF_ID_LENGTH) == 0) {
+
+            wavFormat_t wavFormat;
+
+            success = chunk.size >= sizeof(wavFormat_t) && fread(&wavFormat, sizeof(wavFormat_t), 1, file) == 1;
+
+            success = success && wavFormat.format == PCM_FORMAT && wavFormat.numberOfChannels == 1 && wavFormat.bitsPerSample == 16;
+
+            success = success && fseek(file, chunk.size - sizeof(wavFormat_t) + (chunk.size & 1), SEEK_CUR) == 0;
+
+            *sampleRate = wavFormat.samplesPerSecond;
+
+            formatFound = true;
+
+        } else if (memcmp(chunk.id, "data", RIFF_ID_LENGTH) == 0) {
+
+            numberOfInputSamples = chunk.size / NUMBER_OF_BYTES_IN_SAMPLE;
+
+            inputSamples = malloc(chunk.size + 1);
+
+            success = formatFound && inputSamples && fread(inputSamples, NUMBER_OF_BYTES_IN_SAMPLE, numberOfInputSamples, file) == numberOfInputSamples;
+
+            fclose(file);
+
+            return success;
+
+        } else {
+
+            success = fseek(file, chunk.size + (chunk.size & 1), SEEK_CUR) == 0;
+
+        }
+
+    }
+
+    fclose(file);
+
+    return false;
+
+}
+
+/* List the files produced by the firmware */
+
+static void listOutputDirectory(char *directory) {
+
+    DIR *dir = opendir(directory);
+
+    if (dir == NULL) return;
+
+    struct dirent *entry;
+
+    while ((entry = readdir(dir))) {
+
+        if (entry->d_name[0] == '.') continue;
+
+        char path[MAXIMUM_PATH_LENGTH];
+
+        snprintf(path, MAXIMUM_PATH_LENGTH, "%s/%s", directory, entry->d_name);
+
+        struct stat status;
+
+        if (stat(path, &status) == 0 && S_ISDIR(status.st_mode)) {
+
+            listOutputDirectory(path);
+
+        } else if (stat(path, &status) == 0) {
+
+            printf("  %-48s %10lld bytes\n", path, (long long)status.st_size);
+
+        }
+
+    }
+
+    closedir(dir);
+
+}
+
+static void printUsage(char *name) {
+
+    fprintf(stderr, "Usage: %s [options] input.wav\n\n", name);
+    fprintf(stderr, "Recording options\n");
+    fprintf(stderr, "  -r rate        Sample rate in Hz (default is the input sample rate)\n");
+    fprintf(stderr, "  -f format      File format: wav, flac or adpcm\n");
+    fprintf(stderr, "  -b low:high    Band-pass filter in Hz (0 for no lower or upper edge)\n");
+    fprintf(stderr, "  -a threshold   Amplitude threshold (0 to 32768)\n");
+    fprintf(stderr, "  -m seconds     Minimum trigger duration\n");
+    fprintf(stderr, "  -p buffers     Pre-trigger buffers\n");
+    fprintf(stderr, "  -e             Write each triggered event to its own file\n");
+    fprintf(stderr, "  -x policy      Buffer overrun policy: 0 drop oldest, 1 drop newest, 2 stop\n");
+    fprintf(stderr, "  -q             Defer DMA processing to the main loop\n");
+    fprintf(stderr, "  -y             Preallocate uncompressed files\n");
+    fprintf(stderr, "SD card latency options\n");
+    fprintf(stderr, "  -w us          Base latency of each file operation (default %u)\n", latencyModel.base);
+    fprintf(stderr, "  -k us          Additional latency per kilobyte written (default %u)\n", latencyModel.perKilobyte);
+    fprintf(stderr, "  -j us          Uniform random jitter (default %u)\n", latencyModel.jitter);
+    fprintf(stderr, "  -t probability Probability of a stall on each operation (default %g)\n", latencyModel.stallProbability);
+    fprintf(stderr, "  -T us          Stall duration (default %u)\n", latencyModel.stall);
+    fprintf(stderr, "  -c us          Additional latency per %u-byte cluster added to a file, as on a fragmented FAT (default %u)\n", SD_CARD_CLUSTER_SIZE_IN_BYTES, latencyModel.perCluster);
+    fprintf(stderr, "  -s seed        Random seed (default %u)\n", randomState);
+    fprintf(stderr, "Simulation options\n");
+    fprintf(stderr, "  -o directory   Output directory (default %s)\n", DEFAULT_OUTPUT_DIRECTORY);
+    fprintf(stderr, "  -u time        Start time in seconds since the epoch (default %u)\n", DEFAULT_START_TIME);
+
+}
+
+int main(int argc, char **argv) {
+
+    configSettings_t settings = defaultConfigSettings;
+
+    extendedConfigSettings_t extendedSettings = defaultExtendedConfigSettings;
+
+    char *outputDirectory = DEFAULT_OUTPUT_DIRECTORY;
+
+    uint32_t requestedSampleRate = 0;
+
+    uint32_t startTime = DEFAULT_START_TIME;
+
+    uint32_t lowerFilterFrequency, higherFilterFrequency;
+
+    int option;
+
+    while ((option = getopt(argc, argv, "r:f:b:a:m:p:ex:qyw:k:j:t:T:c:s:o:u:")) != -1) {
+
+        switch (option) {
+
+            case 'r': requestedSampleRate = atoi(optarg); break;
+            case 'f':
+                extendedSettings.fileFormat = strcmp(optarg, "flac") == 0 ? FLAC_FILE_FORMAT : strcmp(optarg, "adpcm") == 0 ? IMA_ADPCM_FILE_FORMAT : WAV_FILE_FORMAT;
+                break;
+            case 'b':
+                if (sscanf(optarg, "%u:%u", &lowerFilterFrequency, &higherFilterFrequency) != 2) {
+                    printUsage(argv[0]);
+                    return 1;
+                }
+                settings.lowerFilterFreq = lowerFilterFrequency == 0 ? UINT16_MAX : lowerFilterFrequency / FILTER_FREQ_MULTIPLIER;
+                settings.higherFilterFreq = higherFilterFrequency == 0 ? UINT16_MAX : higherFilterFrequency / FILTER_FREQ_MULTIPLIER;
+                break;
+            case 'a': settings.amplitudeThreshold = atoi(optarg); break;
+            case 'm': settings.minimumTriggerDuration = atoi(optarg); break;
+            case 'p': settings.preTriggerBuffers = atoi(optarg); break;
+            case 'e': extendedSettings.enableEventFiles = 1; break;
+            case 'x': settings.bufferOverrunPolicy = atoi(optarg); break;
+            case 'q': extendedSettings.enableDeferredProcessing = 1; break;
+            case 'y': extendedSettings.enableFilePreallocation = 1; break;
+            case 'w': latencyModel.base = atoi(optarg); break;
+            case 'k': latencyModel.perKilobyte = atoi(optarg); break;
+            case 'j': latencyModel.jitter = atoi(optarg); break;
+            case 't': latencyModel.stallProbability = atof(optarg); break;
+            case 'T': latencyModel.stall = atoi(optarg); break;
+            case 'c': latencyModel.perCluster = atoi(optarg); break;
+            case 's': randomState = MAX(1, atoi(optarg)); break;
+            case 'o': outputDirectory = optarg; break;
+            case 'u': startTime = atoi(optarg); break;
+            default:
+                printUsage(argv[0]);
+                return 1;
+
+        }
+
+    }
+
+    if (optind != argc - 1) {
+
+        printUsage(argv[0]);
+
+        return 1;
+
+    }
+
+    /* Read the input and select the sample rate */
+
+    uint32_t inputSampleRate = 0;
+
+    if (readWavFile(argv[optind], &inputSampleRate) == false) {
+
+        fprintf(stderr, "Could not read %s as a mono 16-bit PCM WAV file\n", argv[optind]);
+
+        return 1;
+
+    }
+
+    if (requestedSampleRate == 0) requestedSampleRate = inputSampleRate;
+
+    bool sampleRateFound = false;
+
+    for (uint32_t i = 0; i < NUMBER_OF_SAMPLE_RATES && sampleRateFound == false; i += 1) {
+
+        if (sampleRates[i].sampleRate / sampleRates[i].sampleRateDivider == requestedSampleRate) {
+
+            settings.sampleRate = sampleRates[i].sampleRate;
+
+            settings.sampleRateDivider = sampleRates[i].sampleRateDivider;
+
+            sampleRateFound = true;
+
+        }
+
+    }
+
+    if (sampleRateFound == false) {
+
+        fprintf(stderr, "Unsupported sample rate %u\n", requestedSampleRate);
+
+        return 1;
+
+    }
+
+    if (requestedSampleRate != inputSampleRate) fprintf(stderr, "Warning: input at %uHz is replayed at %uHz\n", inputSampleRate, requestedSampleRate);
+
+    rawSamplesPerInputSample = settings.sampleRateDivider;
+
+    /* Store the configuration in flash as the configuration app would */
+
+    static persistentConfigSettings_t persistentConfigSettings;
+
+    memcpy(persistentConfigSettings.firmwareVersion, firmwareVersion, AM_FIRMWARE_VERSION_LENGTH);
+
+    memcpy(persistentConfigSettings.firmwareDescription, firmwareDescription, AM_FIRMWARE_DESCRIPTION_LENGTH);
+
+    persistentConfigSettings.configSettings = settings;
+
+    persistentConfigSettings.extendedConfigSettings = extendedSettings;
+
+    AudioMoth_writeToFlashUserDataPage((uint8_t*)&persistentConfigSettings, sizeof(persistentConfigSettings_t));
+
+    /* Run the firmware in the default switch position until the input is exhausted */
+
+    mkdir(outputDirectory, 0755);
+
+    AudioMothStub_setOutputDirectory(outputDirectory);
+
+    AudioMothStub_setSwitchPosition(AM_SWITCH_DEFAULT);
+
+    AudioMothStub_setSampleSource(sampleSource);
+
+    AudioMothStub_setFileLatency(fileLatency);
+
+    AudioMothStub_setInterruptObserver(interruptObserver);
+
+    AudioMoth_setTime(startTime, 0);
+
+    AudioMothStub_run(firmwareMain);
+
+    /* Report */
+
+    uint64_t numberOfInterrupts = 0;
+
+    for (uint32_t i = 0; i < NUMBER_OF_BUFFERS; i += 1) numberOfInterrupts += occupancyHistogram[i];
+
+    printf("Simulated time      %.3f s\n", (double)AudioMothStub_getMicroseconds() / 1000000.0);
+    printf("Input               %u samples at %u Hz\n", numberOfInputSamples, inputSampleRate);
+    printf("DMA interrupts      %llu\n", (unsigned long long)numberOfInterrupts);
+    printf("File operations     %llu with %llu stalls\n", (unsigned long long)numberOfFileOperations, (unsigned long long)numberOfStalls);
+    printf("Bytes written       %llu\n", (unsigned long long)AudioMothStub_getNumberOfBytesWritten());
+    printf("Cluster allocations %llu taking %.1f ms before recording, %llu taking %.1f ms while recording\n", (unsigned long long)numberOfClusterAllocations[0], (double)clusterAllocationLatency[0] / 1000.0, (unsigned long long)numberOfClusterAllocations[1], (double)clusterAllocationLatency[1] / 1000.0);
+    printf("Longest operation   %.1f ms while recording\n", (double)maximumRecordingLatency / 1000.0);
+    printf("Dropped buffers     %llu\n", (unsigned long long)totalNumberOfDroppedBuffers);
+    printf("Peak occupancy      %u of %u buffers\n", maximumOccupancy, NUMBER_OF_BUFFERS);
+    printf("Occupancy at each DMA interrupt\n");
+
+    for (uint32_t i = 0; i < NUMBER_OF_BUFFERS; i += 1) {
+
+        printf("  %u buffers  %6.2f%%\n", i, numberOfInterrupts ? 100.0 * (double)occupancyHistogram[i] / (double)numberOfInterrupts : 0.0);
+
+    }
+
+    printf("Output files\n");
+
+    listOutputDirectory(outputDirectory);
+
+    return 0;
+
+}
@@ -0,0 +1,581 @@
+/****************************************************************************
+ * audiomoth.c
+ * openacousticdevices.info
+ * October 2026
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <setjmp.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "audiomothstub.h"
+
+/* Useful macros */
+
+#define MIN(a, b)                               ((a) < (b) ? (a) : (b))
+#define MAX(a, b)                               ((a) > (b) ? (a) : (b))
+
+/* Time constants */
+
+#define NANOSECONDS_IN_SECOND                   1000000000ULL
+#define NANOSECONDS_IN_MILLISECOND              1000000ULL
+#define NANOSECONDS_IN_MICROSECOND              1000ULL
+
+#define IDLE_SLEEP_DURATION                     NANOSECONDS_IN_MILLISECOND
+
+/* Device constants */
+
+#define FULL_SPEED_CLOCK_FREQUENCY              48000000
+#define SUPPLY_VOLTAGE                          4200
+#define TEMPERATURE                             20000
+
+#define MAXIMUM_PATH_LENGTH                     512
+
+/* Memory mapped regions */
+
+uint32_t AudioMothStub_backupDomain[AM_BACKUP_DOMAIN_SIZE_IN_BYTES / sizeof(uint32_t)];
+
+uint32_t AudioMothStub_flashUserData[AM_FLASH_USER_DATA_SIZE_IN_BYTES / sizeof(uint32_t)];
+
+uint8_t AudioMothStub_uniqueID[AM_UNIQUE_ID_SIZE_IN_BYTES] = {0x24, 0x3B, 0x5A, 0x06, 0x60, 0x55, 0x23, 0x01};
+
+int16_t AudioMothStub_externalSRAM[AM_EXTERNAL_SRAM_SIZE_IN_BYTES / sizeof(int16_t)];
+
+/* Simulation state */
+
+static jmp_buf restartPoint;
+
+static bool stopRequested;
+
+static bool initialPowerUp = true;
+
+static uint64_t currentNanoseconds;
+
+static AM_switchPosition_t switchPosition = AM_SWITCH_DEFAULT;
+
+static char *outputDirectory = ".";
+
+static AudioMothStub_sampleSource_t sampleSource;
+
+static AudioMothStub_fileLatency_t fileLatency;
+
+static AudioMothStub_interruptObserver_t interruptObserver;
+
+/* Time state */
+
+static bool timeHasBeenSet;
+
+static int64_t timeOffsetInNanoseconds;
+
+static AM_clockDivider_t clockDivider = AM_HF_CLK_DIV1;
+
+/* Direct memory access state */
+
+static bool microphoneRunning;
+
+static bool inputExhausted;
+
+static uint32_t microphoneSampleRate;
+
+static uint32_t numberOfSamplesInTransfer;
+
+static int16_t *descriptorBuffers[2];
+
+static uint32_t activeDescriptor;
+
+static uint64_t numberOfCompletedTransfers;
+
+static uint64_t microphoneStartNanoseconds;
+
+/* File state */
+
+static FILE *file;
+
+static uint32_t fileSize;
+
+static uint64_t numberOfBytesWritten;
+
+/* Private functions */
+
+static uint64_t timeOfNextTransfer() {
+
+    return microphoneStartNanoseconds + (numberOfCompletedTransfers + 1) * numberOfSamplesInTransfer * NANOSECONDS_IN_SECOND / microphoneSampleRate;
+
+}
+
+static void completeTransfer() {
+
+    currentNanoseconds = timeOfNextTransfer();
+
+    numberOfCompletedTransfers += 1;
+
+    int16_t *buffer = descriptorBuffers[activeDescriptor];
+
+    bool samplesAvailable = inputExhausted == false && sampleSource && sampleSource(buffer, numberOfSamplesInTransfer);
+
+    if (samplesAvailable == false) memset(buffer, 0, numberOfSamplesInTransfer * sizeof(int16_t));
+
+    /* The end of the input is handled as the switch being moved to USB */
+
+    if (samplesAvailable == false && inputExhausted == false && sampleSource) {
+
+        inputExhausted = true;
+
+        switchPosition = AM_SWITCH_USB;
+
+        AudioMoth_handleSwitchInterrupt();
+
+    }
+
+    AudioMoth_handleDirectMemoryAccessInterrupt(activeDescriptor == 0, descriptorBuffers + activeDescriptor);
+
+    activeDescriptor ^= 1;
+
+    if (interruptObserver) interruptObserver();
+
+}
+
+static void advanceTime(uint64_t nanoseconds) {
+
+    uint64_t target = currentNanoseconds + nanoseconds;
+
+    while (microphoneRunning && timeOfNextTransfer() <= target) completeTransfer();
+
+    currentNanoseconds = target;
+
+}
+
+static void applyFileLatency(AM_stubFileOperation_t operation, uint32_t numberOfBytes, uint32_t newFileSize) {
+
+    if (fileLatency) advanceTime(fileLatency(operation, numberOfBytes, fileSize, newFileSize) * NANOSECONDS_IN_MICROSECOND);
+
+    fileSize = newFileSize;
+
+}
+
+static char* getPath(char *filename) {
+
+    static char path[MAXIMUM_PATH_LENGTH];
+
+    snprintf(path, MAXIMUM_PATH_LENGTH, "%s/%s", outputDirectory, filename);
+
+    return path;
+
+}
+
+/* Simulation control */
+
+void AudioMothStub_setSwitchPosition(AM_switchPosition_t position) {
+
+    switchPosition = position;
+
+}
+
+void AudioMothStub_setOutputDirectory(char *directory) {
+
+    outputDirectory = directory;
+
+}
+
+void AudioMothStub_setSampleSource(AudioMothStub_sampleSource_t source) {
+
+    sampleSource = source;
+
+}
+
+void AudioMothStub_setFileLatency(AudioMothStub_fileLatency_t latency) {
+
+    fileLatency = latency;
+
+}
+
+void AudioMothStub_setInterruptObserver(AudioMothStub_interruptObserver_t observer) {
+
+    interruptObserver = observer;
+
+}
+
+void AudioMothStub_run(int (*entryPoint)(void)) {
+
+    stopRequested = false;
+
+    setjmp(restartPoint);
+
+    if (stopRequested == false) entryPoint();
+
+}
+
+void AudioMothStub_stop() {
+
+    stopRequested = true;
+
+    longjmp(restartPoint, 1);
+
+}
+
+uint64_t AudioMothStub_getMicroseconds() {
+
+    return currentNanoseconds / NANOSECONDS_IN_MICROSECOND;
+
+}
+
+bool AudioMothStub_isMicrophoneRunning() {
+
+    return microphoneRunning;
+
+}
+
+uint64_t AudioMothStub_getNumberOfBytesWritten() {
+
+    return numberOfBytesWritten;
+
+}
+
+/* Initialisation and power */
+
+void AudioMoth_initialise() { }
+
+bool AudioMoth_isInitialPowerUp() {
+
+    return initialPowerUp;
+
+}
+
+void AudioMoth_handleUSB() {
+
+    AudioMothStub_stop();
+
+}
+
+void AudioMoth_blinkDuringUSB(uint32_t blinkDuration) { }
+
+void AudioMoth_setClockDivider(AM_clockDivider_t divider) {
+
+    clockDivider = divider;
+
+}
+
+uint32_t AudioMoth_getClockFrequency() {
+
+    return FULL_SPEED_CLOCK_FREQUENCY >> clockDivider;
+
+}
+
+void AudioMoth_sleep() {
+
+    if (microphoneRunning) {
+
+        completeTransfer();
+
+    } else {
+
+        currentNanoseconds += IDLE_SLEEP_DURATION;
+
+    }
+
+}
+
+void AudioMoth_deepSleep() {
+
+    AudioMothStub_stop();
+
+}
+
+void AudioMoth_delay(uint32_t milliseconds) {
+
+    advanceTime(milliseconds * NANOSECONDS_IN_MILLISECOND);
+
+}
+
+void AudioMoth_powerDownAndWakeMilliseconds(uint32_t milliseconds) {
+
+    AudioMoth_disableMicrophone();
+
+    if (file) AudioMoth_closeFile();
+
+    currentNanoseconds += milliseconds * NANOSECONDS_IN_MILLISECOND;
+
+    initialPowerUp = false;
+
+    clockDivider = AM_HF_CLK_DIV1;
+
+    longjmp(restartPoint, 1);
+
+}
+
+bool AudioMoth_writeToFlashUserDataPage(uint8_t *data, uint32_t numberOfBytes) {
+
+    if (numberOfBytes > AM_FLASH_USER_DATA_SIZE_IN_BYTES) return false;
+
+    memcpy(AudioMothStub_flashUserData, data, numberOfBytes);
+
+    return true;
+
+}
+
+/* Switch, LEDs and sensors */
+
+AM_switchPosition_t AudioMoth_getSwitchPosition() {
+
+    return switchPosition;
+
+}
+
+void AudioMoth_setRedLED(bool state) { }
+
+void AudioMoth_setGreenLED(bool state) { }
+
+void AudioMoth_setBothLED(bool state) { }
+
+void AudioMoth_enableTemperature() { }
+
+void AudioMoth_disableTemperature() { }
+
+int32_t AudioMoth_getTemperature() {
+
+    return TEMPERATURE;
+
+}
+
+void AudioMoth_enableSupplyMonitor() { }
+
+void AudioMoth_disableSupplyMonitor() { }
+
+void AudioMoth_setSupplyMonitorThreshold(uint32_t supplyVoltage) { }
+
+bool AudioMoth_isSupplyAboveThreshold() {
+
+    return true;
+
+}
+
+uint32_t AudioMoth_getSupplyVoltage() {
+
+    return SUPPLY_VOLTAGE;
+
+}
+
+AM_batteryState_t AudioMoth_getBatteryState(uint32_t supplyVoltage) {
+
+    return AM_BATTERY_4V2;
+
+}
+
+AM_extendedBatteryState_t AudioMoth_getExtendedBatteryState(uint32_t supplyVoltage) {
+
+    return AM_EXT_BAT_4V2;
+
+}
+
+/* Time */
+
+void AudioMoth_startRealTimeClock(uint32_t seconds) { }
+
+void AudioMoth_checkAndHandleTimeOverflow() { }
+
+bool AudioMoth_hasTimeBeenSet() {
+
+    return timeHasBeenSet;
+
+}
+
+void AudioMoth_setTime(uint32_t time, uint32_t milliseconds) {
+
+    timeOffsetInNanoseconds = (int64_t)(time * NANOSECONDS_IN_SECOND + milliseconds * NANOSECONDS_IN_MILLISECOND) - (int64_t)currentNanoseconds;
+
+    timeHasBeenSet = true;
+
+}
+
+void AudioMoth_getTime(uint32_t *time, uint32_t *milliseconds) {
+
+    uint64_t nanoseconds = currentNanoseconds + timeOffsetInNanoseconds;
+
+    if (time) *time = nanoseconds / NANOSECONDS_IN_SECOND;
+
+    if (milliseconds) *milliseconds = nanoseconds % NANOSECONDS_IN_SECOND / NANOSECONDS_IN_MILLISECOND;
+
+}
+
+/* Microphone and direct memory access */
+
+void AudioMoth_enableExternalSRAM() { }
+
+bool AudioMoth_enableMicrophone(AM_gainRange_t gainRange, AM_gainSetting_t gain, uint32_t clockDivider, uint32_t acquisitionCycles, uint32_t oversampleRate) {
+
+    return false;
+
+}
+
+void AudioMoth_disableMicrophone() {
+
+    microphoneRunning = false;
+
+}
+
+void AudioMoth_initialiseMicrophoneInterrupts() { }
+
+void AudioMoth_initialiseDirectMemoryAccess(int16_t *primaryBuffer, int16_t *secondaryBuffer, uint16_t numberOfSamples) {
+
+    descriptorBuffers[0] = primaryBuffer;
+
+    descriptorBuffers[1] = secondaryBuffer;
+
+    numberOfSamplesInTransfer = numberOfSamples;
+
+    activeDescriptor = 0;
+
+}
+
+void AudioMoth_startMicrophoneSamples(uint32_t sampleRate) {
+
+    microphoneSampleRate = sampleRate;
+
+    microphoneStartNanoseconds = currentNanoseconds;
+
+    numberOfCompletedTransfers = 0;
+
+    microphoneRunning = true;
+
+}
+
+bool AudioMoth_hasInvertedOutput() {
+
+    return false;
+
+}
+
+/* File system */
+
+bool AudioMoth_enableFileSystem(AM_sdCardSpeed_t speed) {
+
+    return true;
+
+}
+
+void AudioMoth_disableFileSystem() { }
+
+bool AudioMoth_doesDirectoryExist(char *directory) {
+
+    struct stat status;
+
+    return stat(getPath(directory), &status) == 0 && S_ISDIR(status.st_mode);
+
+}
+
+bool AudioMoth_makeDirectory(char *directory) {
+
+    return mkdir(getPath(directory), 0755) == 0;
+
+}
+
+bool AudioMoth_openFile(char *filename) {
+
+    if (file) fclose(file);
+
+    file = fopen(getPath(filename), "wb+");
+
+    fileSize = 0;
+
+    return file != NULL;
+
+}
+
+bool AudioMoth_appendFile(char *filename) {
+
+    if (file) fclose(file);
+
+    file = fopen(getPath(filename), "ab");
+
+    if (file == NULL) return false;
+
+    fseek(file, 0, SEEK_END);
+
+    fileSize = ftell(file);
+
+    return true;
+
+}
+
+bool AudioMoth_writeToFile(void *bytes, uint16_t bytesToWrite) {
+
+    if (file == NULL) return false;
+
+    applyFileLatency(AM_STUB_WRITE, bytesToWrite, MAX(fileSize, ftell(file) + bytesToWrite));
+
+    numberOfBytesWritten += bytesToWrite;
+
+    return fwrite(bytes, 1, bytesToWrite, file) == bytesToWrite;
+
+}
+
+bool AudioMoth_seekInFile(uint32_t position) {
+
+    if (file == NULL) return false;
+
+    applyFileLatency(AM_STUB_SEEK, 0, MAX(fileSize, position));
+
+    /* Seeking beyond the end of the file extends it as the FatFs implementation does */
+
+    fflush(file);
+
+    struct stat status;
+
+    if (fstat(fileno(file), &status) == 0 && status.st_size < position && ftruncate(fileno(file), position) != 0) return false;
+
+    return fseek(file, position, SEEK_SET) == 0;
+
+}
+
+bool AudioMoth_syncFile() {
+
+    if (file == NULL) return false;
+
+    applyFileLatency(AM_STUB_SYNC, 0, fileSize);
+
+    return fflush(file) == 0;
+
+}
+
+bool AudioMoth_truncateFile() {
+
+    if (file == NULL) return false;
+
+    /* Truncate the file at the current position as the FatFs implementation does */
+
+    fflush(file);
+
+    long position = ftell(file);
+
+    applyFileLatency(AM_STUB_TRUNCATE, 0, position);
+
+    return ftruncate(fileno(file), position) == 0;
+
+}
+
+bool AudioMoth_closeFile() {
+
+    if (file == NULL) return false;
+
+    applyFileLatency(AM_STUB_CLOSE, 0, fileSize);
+
+    bool success = fclose(file) == 0;
+
+    file = NULL;
+
+    return success;
+
+}
+
+bool AudioMoth_renameFile(char *originalFilename, char *newFilename) {
+
+    static char originalPath[MAXIMUM_PATH_LENGTH];
+
+    strcpy(originalPath, getPath(originalFilename));
+
+    return rename(originalPath, getPath(newFilename)) == 0;
+
+}
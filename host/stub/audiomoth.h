@@ -0,0 +1,192 @@
+/****************************************************************************
+ * audiomoth.h
+ * openacousticdevices.info
+ * October 2026
+ *****************************************************************************/
+
+/* Host stub of the AudioMoth-Project HAL interface used by this firmware. Memory mapped regions are backed by host arrays and time is simulated by audiomoth.c */
+
+#ifndef __AUDIOMOTH_H
+#define __AUDIOMOTH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Memory mapped regions */
+
+extern uint32_t AudioMothStub_backupDomain[];
+
+extern uint32_t AudioMothStub_flashUserData[];
+
+extern uint8_t AudioMothStub_uniqueID[];
+
+extern int16_t AudioMothStub_externalSRAM[];
+
+#define AM_BACKUP_DOMAIN_START_ADDRESS          ((uintptr_t)AudioMothStub_backupDomain)
+#define AM_BACKUP_DOMAIN_SIZE_IN_BYTES          512
+
+#define AM_FLASH_USER_DATA_ADDRESS              ((uintptr_t)AudioMothStub_flashUserData)
+#define AM_FLASH_USER_DATA_SIZE_IN_BYTES        2048
+
+#define AM_UNIQUE_ID_START_ADDRESS              ((uintptr_t)AudioMothStub_uniqueID)
+#define AM_UNIQUE_ID_SIZE_IN_BYTES              8
+
+#define AM_EXTERNAL_SRAM_START_ADDRESS          ((uintptr_t)AudioMothStub_externalSRAM)
+#define AM_EXTERNAL_SRAM_SIZE_IN_BYTES          (256 * 1024)
+
+/* Firmware identification constants */
+
+#define AM_FIRMWARE_VERSION_LENGTH              3
+#define AM_FIRMWARE_DESCRIPTION_LENGTH          32
+
+/* Battery state constants */
+
+#define AM_BATTERY_STATE_INCREMENT              100
+#define AM_EXT_BAT_STATE_OFFSET                 2400
+
+/* Enumerations */
+
+typedef enum {AM_SWITCH_CUSTOM, AM_SWITCH_DEFAULT, AM_SWITCH_USB, AM_SWITCH_NONE} AM_switchPosition_t;
+
+typedef enum {AM_GAIN_LOW, AM_GAIN_LOW_MEDIUM, AM_GAIN_MEDIUM, AM_GAIN_MEDIUM_HIGH, AM_GAIN_HIGH} AM_gainSetting_t;
+
+typedef enum {AM_NORMAL_GAIN_RANGE, AM_LOW_GAIN_RANGE} AM_gainRange_t;
+
+typedef enum {AM_HF_CLK_DIV1, AM_HF_CLK_DIV2, AM_HF_CLK_DIV4, AM_HF_CLK_DIV8, AM_HF_CLK_DIV16} AM_clockDivider_t;
+
+typedef enum {AM_SD_CARD_NORMAL_SPEED, AM_SD_CARD_HIGH_SPEED} AM_sdCardSpeed_t;
+
+typedef enum {AM_BATTERY_LOW, AM_BATTERY_3V6, AM_BATTERY_3V7, AM_BATTERY_3V8, AM_BATTERY_3V9, AM_BATTERY_4V0, AM_BATTERY_4V1, AM_BATTERY_4V2, AM_BATTERY_4V3, AM_BATTERY_4V4, AM_BATTERY_4V5, AM_BATTERY_4V6, AM_BATTERY_4V7, AM_BATTERY_4V8, AM_BATTERY_4V9, AM_BATTERY_FULL} AM_batteryState_t;
+
+typedef enum {AM_EXT_BAT_LOW, AM_EXT_BAT_2V5, AM_EXT_BAT_2V6, AM_EXT_BAT_2V7, AM_EXT_BAT_2V8, AM_EXT_BAT_2V9, AM_EXT_BAT_3V0, AM_EXT_BAT_3V1, AM_EXT_BAT_3V2, AM_EXT_BAT_3V3, AM_EXT_BAT_3V4, AM_EXT_BAT_3V5, AM_EXT_BAT_3V6, AM_EXT_BAT_3V7, AM_EXT_BAT_3V8, AM_EXT_BAT_3V9, AM_EXT_BAT_4V0, AM_EXT_BAT_4V1, AM_EXT_BAT_4V2, AM_EXT_BAT_4V3, AM_EXT_BAT_4V4, AM_EXT_BAT_4V5, AM_EXT_BAT_4V6, AM_EXT_BAT_4V7, AM_EXT_BAT_4V8, AM_EXT_BAT_4V9, AM_EXT_BAT_FULL} AM_extendedBatteryState_t;
+
+/* Interrupt and USB handlers implemented by the firmware */
+
+extern void AudioMoth_handleSwitchInterrupt(void);
+
+extern void AudioMoth_handleMicrophoneChangeInterrupt(void);
+
+extern void AudioMoth_handleMicrophoneInterrupt(int16_t sample);
+
+extern void AudioMoth_handleDirectMemoryAccessInterrupt(bool isPrimaryBuffer, int16_t **nextBuffer);
+
+extern void AudioMoth_timezoneRequested(int32_t *timezoneHours, int32_t *timezoneMinutes);
+
+extern void AudioMoth_usbFirmwareVersionRequested(uint8_t **firmwareVersionPtr);
+
+extern void AudioMoth_usbFirmwareDescriptionRequested(uint8_t **firmwareDescriptionPtr);
+
+extern void AudioMoth_usbApplicationPacketRequested(uint32_t messageType, uint8_t *transmitBuffer, uint32_t size);
+
+extern void AudioMoth_usbApplicationPacketReceived(uint32_t messageType, uint8_t *receiveBuffer, uint8_t *transmitBuffer, uint32_t size);
+
+/* Initialisation and power */
+
+void AudioMoth_initialise(void);
+
+bool AudioMoth_isInitialPowerUp(void);
+
+void AudioMoth_handleUSB(void);
+
+void AudioMoth_blinkDuringUSB(uint32_t blinkDuration);
+
+void AudioMoth_setClockDivider(AM_clockDivider_t divider);
+
+uint32_t AudioMoth_getClockFrequency(void);
+
+void AudioMoth_sleep(void);
+
+void AudioMoth_deepSleep(void);
+
+void AudioMoth_delay(uint32_t milliseconds);
+
+void AudioMoth_powerDownAndWakeMilliseconds(uint32_t milliseconds);
+
+bool AudioMoth_writeToFlashUserDataPage(uint8_t *data, uint32_t numberOfBytes);
+
+/* Switch, LEDs and sensors */
+
+AM_switchPosition_t AudioMoth_getSwitchPosition(void);
+
+void AudioMoth_setRedLED(bool state);
+
+void AudioMoth_setGreenLED(bool state);
+
+void AudioMoth_setBothLED(bool state);
+
+void AudioMoth_enableTemperature(void);
+
+void AudioMoth_disableTemperature(void);
+
+int32_t AudioMoth_getTemperature(void);
+
+void AudioMoth_enableSupplyMonitor(void);
+
+void AudioMoth_disableSupplyMonitor(void);
+
+void AudioMoth_setSupplyMonitorThreshold(uint32_t supplyVoltage);
+
+bool AudioMoth_isSupplyAboveThreshold(void);
+
+uint32_t AudioMoth_getSupplyVoltage(void);
+
+AM_batteryState_t AudioMoth_getBatteryState(uint32_t supplyVoltage);
+
+AM_extendedBatteryState_t AudioMoth_getExtendedBatteryState(uint32_t supplyVoltage);
+
+/* Time */
+
+void AudioMoth_startRealTimeClock(uint32_t seconds);
+
+void AudioMoth_checkAndHandleTimeOverflow(void);
+
+bool AudioMoth_hasTimeBeenSet(void);
+
+void AudioMoth_setTime(uint32_t time, uint32_t milliseconds);
+
+void AudioMoth_getTime(uint32_t *time, uint32_t *milliseconds);
+
+/* Microphone and direct memory access */
+
+void AudioMoth_enableExternalSRAM(void);
+
+bool AudioMoth_enableMicrophone(AM_gainRange_t gainRange, AM_gainSetting_t gain, uint32_t clockDivider, uint32_t acquisitionCycles, uint32_t oversampleRate);
+
+void AudioMoth_disableMicrophone(void);
+
+void AudioMoth_initialiseMicrophoneInterrupts(void);
+
+void AudioMoth_initialiseDirectMemoryAccess(int16_t *primaryBuffer, int16_t *secondaryBuffer, uint16_t numberOfSamples);
+
+void AudioMoth_startMicrophoneSamples(uint32_t sampleRate);
+
+bool AudioMoth_hasInvertedOutput(void);
+
+/* File system */
+
+bool AudioMoth_enableFileSystem(AM_sdCardSpeed_t speed);
+
+void AudioMoth_disableFileSystem(void);
+
+bool AudioMoth_doesDirectoryExist(char *directory);
+
+bool AudioMoth_makeDirectory(char *directory);
+
+bool AudioMoth_openFile(char *filename);
+
+bool AudioMoth_appendFile(char *filename);
+
+bool AudioMoth_writeToFile(void *bytes, uint16_t bytesToWrite);
+
+bool AudioMoth_seekInFile(uint32_t position);
+
+bool AudioMoth_syncFile(void);
+
+bool AudioMoth_truncateFile(void);
+
+bool AudioMoth_closeFile(void);
+
+bool AudioMoth_renameFile(char *originalFilename, char *newFilename);
+
+#endif /* __AUDIOMOTH_H */
@@ -0,0 +1,63 @@
+/****************************************************************************
+ * audiomothstub.h
+ * openacousticdevices.info
+ * October 2026
+ *****************************************************************************/
+
+/* Control interface of the host HAL stub used by the benchmark, simulator and tests */
+
+#ifndef __AUDIOMOTHSTUB_H
+#define __AUDIOMOTHSTUB_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "audiomoth.h"
+
+/* File operations passed to the latency model */
+
+typedef enum {AM_STUB_WRITE, AM_STUB_SEEK, AM_STUB_SYNC, AM_STUB_TRUNCATE, AM_STUB_CLOSE} AM_stubFileOperation_t;
+
+/* Fill a completed DMA transfer with raw samples. Return false once the input is exhausted */
+
+typedef bool (*AudioMothStub_sampleSource_t)(int16_t *buffer, uint32_t numberOfSamples);
+
+/* Return the simulated duration of a file operation in microseconds, given the number of bytes written and the size of the file before and after the operation. DMA transfers complete during the operation */
+
+typedef uint32_t (*AudioMothStub_fileLatency_t)(AM_stubFileOperation_t operation, uint32_t numberOfBytes, uint32_t previousFileSize, uint32_t fileSize);
+
+/* Called after each DMA interrupt handler returns */
+
+typedef void (*AudioMothStub_interruptObserver_t)(void);
+
+/* Configure the simulation */
+
+void AudioMothStub_setSwitchPosition(AM_switchPosition_t switchPosition);
+
+void AudioMothStub_setOutputDirectory(char *directory);
+
+void AudioMothStub_setSampleSource(AudioMothStub_sampleSource_t source);
+
+void AudioMothStub_setFileLatency(AudioMothStub_fileLatency_t latency);
+
+void AudioMothStub_setInterruptObserver(AudioMothStub_interruptObserver_t observer);
+
+/* Run the firmware entry point, restarting it after each power down as the device would, until the simulation is stopped. The input being exhausted moves the switch to USB which stops the simulation on the next restart */
+
+void AudioMothStub_run(int (*entryPoint)(void));
+
+void AudioMothStub_stop(void);
+
+/* Simulated time since the start of the simulation */
+
+uint64_t AudioMothStub_getMicroseconds(void);
+
+/* Whether DMA transfers are completing */
+
+bool AudioMothStub_isMicrophoneRunning(void);
+
+/* Number of bytes written by AudioMoth_writeToFile */
+
+uint64_t AudioMothStub_getNumberOfBytesWritten(void);
+
+#endif /* __AUDIOMOTHSTUB_H */
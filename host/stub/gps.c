@@ -0,0 +1,35 @@
+/****************************************************************************
+ * gps.c
+ * openacousticdevices.info
+ * October 2026
+ *****************************************************************************/
+
+/* Host stub of the GPS interface. There is no receiver so time setting always times out */
+
+#include "gps.h"
+
+void GPS_powerUpGPS() { }
+
+void GPS_powerDownGPS() { }
+
+void GPS_enableGPSInterface() { }
+
+void GPS_disableGPSInterface() { }
+
+void GPS_enableMagneticSwitch() { }
+
+void GPS_disableMagneticSwitch() { }
+
+bool GPS_isMagneticSwitchClosed() {
+
+    return false;
+
+}
+
+GPS_fixResult_t GPS_setTimeFromGPS(uint32_t timeout) {
+
+    return GPS_TIMEOUT;
+
+}
+
+void GPS_cancelTimeSetting(GPS_fixCancellationReason_t reason) { }
@@ -0,0 +1,24 @@
+/****************************************************************************
+ * sunrise.c
+ * openacousticdevices.info
+ * October 2026
+ *****************************************************************************/
+
+#include "sunrise.h"
+
+/* Stub constants */
+
+#define SUNRISE_MINUTES                 (6 * 60)
+#define SUNSET_MINUTES                  (18 * 60)
+
+void Sunrise_calculateFromUnix(SR_event_t event, uint32_t unixTime, float latitude, float longitude, SR_solution_t *solution, SR_trend_t *trend, uint32_t *sunriseMinutes, uint32_t *sunsetMinutes) {
+
+    *solution = SR_NORMAL_SOLUTION;
+
+    *trend = SR_DAY_EQUAL_TO_NIGHT;
+
+    *sunriseMinutes = SUNRISE_MINUTES;
+
+    *sunsetMinutes = SUNSET_MINUTES;
+
+}
@@ -0,0 +1,24 @@
+/****************************************************************************
+ * sunrise.h
+ * openacousticdevices.info
+ * October 2026
+ *****************************************************************************/
+
+/* Host stub of the AudioMoth-Project sunrise and sunset interface */
+
+#ifndef __SUNRISE_H
+#define __SUNRISE_H
+
+#include <stdint.h>
+
+typedef enum {SR_SUNRISE_AND_SUNSET, SR_CIVIL_DAWN_AND_DUSK, SR_NAUTICAL_DAWN_AND_DUSK, SR_ASTRONOMICAL_DAWN_AND_DUSK} SR_event_t;
+
+typedef enum {SR_NORMAL_SOLUTION, SR_ONLY_SUNRISE, SR_ONLY_SUNSET, SR_NO_SUNRISE_OR_SUNSET} SR_solution_t;
+
+typedef enum {SR_DAY_LONGER_THAN_NIGHT, SR_DAY_SHORTER_THAN_NIGHT, SR_DAY_EQUAL_TO_NIGHT} SR_trend_t;
+
+/* The stub reports sunrise at 06:00 UTC and sunset at 18:00 UTC on every day */
+
+void Sunrise_calculateFromUnix(SR_event_t event, uint32_t unixTime, float latitude, float longitude, SR_solution_t *solution, SR_trend_t *trend, uint32_t *sunriseMinutes, uint32_t *sunsetMinutes);
+
+#endif /* __SUNRISE_H */
@@ -0,0 +1,290 @@
+/****************************************************************************
+ * test_adpcm.c
+ * openacousticdevices.info
+ * October 2026
+ *****************************************************************************/
+
+/* Round-trip SRAM buffers through the IMA-ADPCM encoder as makeRecording writes them, including untriggered buffers, and decode them with a separate decoder written from the format specification */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "adpcm.h"
+
+/* Buffer constants matching main.c */
+
+#define NUMBER_OF_SAMPLES_IN_BUFFER             16384
+
+/* Test constants */
+
+#define SAMPLE_RATE                             48000
+#define NUMBER_OF_BUFFERS_IN_RECORDING          40
+#define MAXIMUM_NUMBER_OF_SAMPLES               (NUMBER_OF_BUFFERS_IN_RECORDING * NUMBER_OF_SAMPLES_IN_BUFFER)
+#define MAXIMUM_NUMBER_OF_BLOCKS                (MAXIMUM_NUMBER_OF_SAMPLES / ADPCM_SAMPLES_PER_BLOCK + 1)
+
+#define TEST_TONE_FREQUENCY                     3000
+#define TEST_TONE_AMPLITUDE                     8000
+#define NOISE_AMPLITUDE                         1000
+
+/* IMA-ADPCM tracks a tone in noise to about 30 dB. Silence following loud audio decays to within a few LSB, as the smallest step cannot correct the remaining prediction, until the next block header resets the predictor */
+
+#define MINIMUM_SIGNAL_TO_NOISE_RATIO           25.0
+#define MAXIMUM_SILENCE_AMPLITUDE               8
+#define SILENCE_SETTLING_SAMPLES                128
+
+/* Test cases */
+
+typedef struct {
+    char *name;
+    uint32_t numberOfSamples;
+    uint32_t triggerPattern;
+} testCase_t;
+
+/* Each bit of the trigger pattern marks whether the corresponding buffer is written or replaced by silence as an untriggered buffer. The lengths give a final partial block with an odd and an even number of samples */
+
+static const testCase_t testCases[] = {
+    {"Continuous", MAXIMUM_NUMBER_OF_SAMPLES, 0xFFFFFFFF},
+    {"Alternate buffers", MAXIMUM_NUMBER_OF_SAMPLES - 1000, 0xAAAAAAAA},
+    {"Single events", MAXIMUM_NUMBER_OF_SAMPLES - 777, 0x00100401},
+    {"Untriggered", MAXIMUM_NUMBER_OF_SAMPLES - 5, 0x00000000}
+};
+
+#define NUMBER_OF_TEST_CASES                    (sizeof(testCases) / sizeof(testCase_t))
+
+/* Sample and stream buffers */
+
+static int16_t source[MAXIMUM_NUMBER_OF_SAMPLES];
+
+static int16_t decoded[MAXIMUM_NUMBER_OF_SAMPLES];
+
+static uint8_t stream[MAXIMUM_NUMBER_OF_BLOCKS * ADPCM_BLOCK_SIZE];
+
+/* Useful macros */
+
+#define MIN(a, b)                               ((a) < (b) ? (a) : (b))
+#define MAX(a, b)                               ((a) > (b) ? (a) : (b))
+
+/* IMA-ADPCM tables from the specification */
+
+static const int32_t stepSizes[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+    337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+    2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+static const int32_t indexAdjustments[16] = {-1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8};
+
+/* Determine whether the buffer containing a sample is written */
+
+static bool isTriggered(const testCase_t *testCase, uint32_t sampleIndex) {
+
+    return testCase->triggerPattern & (1u << (sampleIndex / NUMBER_OF_SAMPLES_IN_BUFFER % 32));
+
+}
+
+/* Generate a tone in noise, with the untriggered buffers decoded as zero */
+
+static void generateSamples(const testCase_t *testCase) {
+
+    srand(1);
+
+    for (uint32_t i = 0; i < testCase->numberOfSamples; i += 1) {
+
+        double noise = NOISE_AMPLITUDE * ((double)rand() / (double)RAND_MAX - 0.5);
+
+        double tone = TEST_TONE_AMPLITUDE * sin(2.0 * M_PI * TEST_TONE_FREQUENCY * (double)i / SAMPLE_RATE);
+
+        source[i] = isTriggered(testCase, i) ? (int16_t)round(tone + noise) : 0;
+
+    }
+
+}
+
+/* Encode each SRAM buffer as makeRecording does, passing NULL for untriggered buffers. Returns the size of the stream */
+
+static uint32_t encodeStream(const testCase_t *testCase) {
+
+    uint32_t streamSize = 0;
+
+    ADPCM_initialise();
+
+    for (uint32_t i = 0; i < testCase->numberOfSamples; i += NUMBER_OF_SAMPLES_IN_BUFFER) {
+
+        uint32_t numberOfSamplesToWrite = MIN(NUMBER_OF_SAMPLES_IN_BUFFER, testCase->numberOfSamples - i);
+
+        uint32_t numberOfSamplesEncoded = 0;
+
+        while (numberOfSamplesEncoded < numberOfSamplesToWrite) {
+
+            uint8_t *block;
+
+            numberOfSamplesEncoded += ADPCM_encode(isTriggered(testCase, i) ? source + i + numberOfSamplesEncoded : NULL, numberOfSamplesToWrite - numberOfSamplesEncoded, &block);
+
+            if (block) {
+
+                memcpy(stream + streamSize, block, ADPCM_BLOCK_SIZE);
+
+                streamSize += ADPCM_BLOCK_SIZE;
+
+            }
+
+        }
+
+    }
+
+    uint32_t blockSize;
+
+    uint8_t *block = ADPCM_flush(&blockSize);
+
+    if (block) {
+
+        memcpy(stream + streamSize, block, blockSize);
+
+        streamSize += blockSize;
+
+    }
+
+    return streamSize;
+
+}
+
+/* Decoder failure reporting */
+
+#define CHECK(condition, ...) if (!(condition)) { printf("\n    "); printf(__VA_ARGS__); printf("\n"); return false; }
+
+/* Decode the stream block by block, given the sample count from the fact chunk */
+
+static bool decodeStream(uint32_t streamSize, uint32_t numberOfSamples) {
+
+    uint32_t expectedBlocks = (numberOfSamples + ADPCM_SAMPLES_PER_BLOCK - 1) / ADPCM_SAMPLES_PER_BLOCK;
+
+    uint32_t finalSamples = numberOfSamples - (expectedBlocks - 1) * ADPCM_SAMPLES_PER_BLOCK;
+
+    uint32_t finalBlockSize = 4 + finalSamples / 2;
+
+    finalBlockSize += finalBlockSize & 1;
+
+    CHECK(streamSize == (expectedBlocks - 1) * ADPCM_BLOCK_SIZE + finalBlockSize, "Stream is %u bytes for %u samples", streamSize, numberOfSamples);
+
+    uint32_t sampleIndex = 0;
+
+    for (uint32_t i = 0; i < expectedBlocks; i += 1) {
+
+        uint8_t *block = stream + i * ADPCM_BLOCK_SIZE;
+
+        int32_t predictor = (int16_t)(block[0] | block[1] << 8);
+
+        int32_t index = block[2];
+
+        CHECK(index <= 88 && block[3] == 0, "Block %u header", i);
+
+        decoded[sampleIndex++] = predictor;
+
+        uint32_t numberOfSamplesInBlock = i == expectedBlocks - 1 ? finalSamples : ADPCM_SAMPLES_PER_BLOCK;
+
+        for (uint32_t j = 1; j < numberOfSamplesInBlock; j += 1) {
+
+            uint8_t byte = block[4 + (j - 1) / 2];
+
+            uint32_t code = (j - 1) & 1 ? byte >> 4 : byte & 0x0F;
+
+            int32_t step = stepSizes[index];
+
+            int32_t difference = step >> 3;
+
+            if (code & 4) difference += step;
+
+            if (code & 2) difference += step >> 1;
+
+            if (code & 1) difference += step >> 2;
+
+            predictor += code & 8 ? -difference : difference;
+
+            predictor = MAX(INT16_MIN, MIN(INT16_MAX, predictor));
+
+            index = MAX(0, MIN(88, index + indexAdjustments[code]));
+
+            decoded[sampleIndex++] = predictor;
+
+        }
+
+    }
+
+    return true;
+
+}
+
+/* Compare the decoded stream with the source */
+
+static bool compareStream(const testCase_t *testCase, double *signalToNoiseRatio, int32_t *maximumSilence) {
+
+    double signalEnergy = 0.0, noiseEnergy = 0.0;
+
+    *maximumSilence = 0;
+
+    uint32_t silentSamples = 0;
+
+    for (uint32_t i = 0; i < testCase->numberOfSamples; i += 1) {
+
+        if (isTriggered(testCase, i)) {
+
+            silentSamples = 0;
+
+            signalEnergy += (double)source[i] * (double)source[i];
+
+            noiseEnergy += ((double)decoded[i] - (double)source[i]) * ((double)decoded[i] - (double)source[i]);
+
+        } else {
+
+            silentSamples += 1;
+
+            if (silentSamples > SILENCE_SETTLING_SAMPLES) *maximumSilence = MAX(*maximumSilence, abs(decoded[i]));
+
+        }
+
+    }
+
+    *signalToNoiseRatio = signalEnergy > 0.0 ? 10.0 * log10(signalEnergy / noiseEnergy) : INFINITY;
+
+    return *signalToNoiseRatio >= MINIMUM_SIGNAL_TO_NOISE_RATIO && *maximumSilence <= MAXIMUM_SILENCE_AMPLITUDE;
+
+}
+
+int main(int argc, char **argv) {
+
+    uint32_t failures = 0;
+
+    printf("%-20s %10s %10s %10s %10s\n", "Case", "Samples", "Bytes", "SNR dB", "Silence");
+
+    for (uint32_t i = 0; i < NUMBER_OF_TEST_CASES; i += 1) {
+
+        const testCase_t *testCase = testCases + i;
+
+        generateSamples(testCase);
+
+        uint32_t streamSize = encodeStream(testCase);
+
+        printf("%-20s %10u %10u", testCase->name, testCase->numberOfSamples, streamSize);
+
+        double signalToNoiseRatio = 0.0;
+
+        int32_t maximumSilence = 0;
+
+        bool passed = decodeStream(streamSize, testCase->numberOfSamples) && compareStream(testCase, &signalToNoiseRatio, &maximumSilence);
+
+        printf(" %10.1f %10d%s\n", signalToNoiseRatio, maximumSilence, passed ? "" : " FAIL");
+
+        if (passed == false) failures += 1;
+
+    }
+
+    printf("\n%s\n", failures == 0 ? "PASS" : "FAIL");
+
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+
+}
@@ -0,0 +1,165 @@
+/****************************************************************************
+ * test_crc.c
+ * openacousticdevices.info
+ * October 2026
+ *****************************************************************************/
+
+/* Check the table-driven acoustic configuration CRC, updated two bytes behind as each byte arrives, against the original bitwise implementation on random packets */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "audiomothstub.h"
+
+/* The CRC functions are private to the acoustic configuration receiver */
+
+#include "../src/audioconfig.c"
+
+/* Test constants */
+
+#define NUMBER_OF_PACKETS                       1000000
+
+/* Handlers required by the stub and the acoustic configuration receiver */
+
+void AudioMoth_handleSwitchInterrupt() { }
+
+void AudioMoth_handleDirectMemoryAccessInterrupt(bool isPrimaryBuffer, int16_t **nextBuffer) {
+
+    AudioConfig_handleDirectMemoryAccessInterrupt(isPrimaryBuffer, nextBuffer);
+
+}
+
+void AudioConfig_handleAudioConfigurationEvent(AC_audioConfigurationEvent_t event) { }
+
+void AudioConfig_handleAudioConfigurationPacket(uint8_t *receiveBuffer, uint32_t size) { }
+
+/* Original bitwise CRC functions */
+
+static inline uint16_t updateBitwiseCRC(uint16_t crc_in, int incr) {
+
+    uint16_t xor = crc_in >> 15;
+    uint16_t out = crc_in << 1;
+
+    if (incr) {
+        out++;
+    }
+
+    if (xor) {
+        out ^= CRC_POLY;
+    }
+
+    return out;
+
+}
+
+static inline uint16_t calculateBitwiseCRC(const uint8_t *data, uint32_t size) {
+
+    uint16_t crc, i;
+
+    for (crc = 0; size > 0; size--, data++) {
+        for (i = 0x80; i; i >>= 1) {
+            crc = updateBitwiseCRC(crc, *data & i);
+        }
+    }
+
+    for (i = 0; i < 16; i++) {
+        crc = updateBitwiseCRC(crc, 0);
+    }
+
+    return crc;
+
+}
+
+static inline bool checkBitwiseCRC(const uint8_t *data, uint32_t size) {
+
+    uint16_t crc = calculateBitwiseCRC(data, size - CRC_SIZE_IN_BYTES);
+
+    uint8_t low = crc & 0xFF;
+    uint8_t high = crc >> 8;
+
+    return (low == data[size - 2] && high == data[size - 1]);
+
+}
+
+/* Update the CRC as each byte arrives, as the receiver does, and check it once the whole packet has been received */
+
+static bool receivePacket(const uint8_t *packet, uint32_t size, uint16_t *crc) {
+
+    *crc = 0;
+
+    for (uint32_t byteCount = 1; byteCount <= size; byteCount += 1) {
+
+        if (byteCount > CRC_SIZE_IN_BYTES) *crc = updateCRC(*crc, packet[byteCount - CRC_SIZE_IN_BYTES - 1]);
+
+    }
+
+    return checkCRC(*crc, packet, size);
+
+}
+
+int main(int argc, char **argv) {
+
+    uint8_t packet[MAXIMUM_NUMBER_OF_BYTES];
+
+    uint32_t crcMismatches = 0, validRejected = 0, corruptAccepted = 0, decisionMismatches = 0;
+
+    srand(1);
+
+    for (uint32_t i = 0; i < NUMBER_OF_PACKETS; i += 1) {
+
+        /* Random packets from one payload byte to the maximum length */
+
+        uint32_t size = CRC_SIZE_IN_BYTES + 1 + rand() % (MAXIMUM_NUMBER_OF_BYTES - CRC_SIZE_IN_BYTES);
+
+        for (uint32_t j = 0; j < size; j += 1) packet[j] = rand();
+
+        /* Random trailing bytes must give the same decision as the original check */
+
+        uint16_t crc;
+
+        if (receivePacket(packet, size, &crc) != checkBitwiseCRC(packet, size)) decisionMismatches += 1;
+
+        /* The running CRC must match the original calculation over the payload */
+
+        uint16_t expectedCRC = calculateBitwiseCRC(packet, size - CRC_SIZE_IN_BYTES);
+
+        if (crc != expectedCRC) crcMismatches += 1;
+
+        /* A packet carrying the original CRC must be accepted */
+
+        packet[size - 2] = expectedCRC & 0xFF;
+
+        packet[size - 1] = expectedCRC >> 8;
+
+        if (receivePacket(packet, size, &crc) == false) validRejected += 1;
+
+        /* A single bit error anywhere in the packet must be rejected */
+
+        uint32_t bit = rand() % (8 * size);
+
+        packet[bit / 8] ^= 1 << (bit % 8);
+
+        if (receivePacket(packet, size, &crc)) corruptAccepted += 1;
+
+        if (checkBitwiseCRC(packet, size)) corruptAccepted += 1;
+
+    }
+
+    bool passed = crcMismatches == 0 && validRejected == 0 && corruptAccepted == 0 && decisionMismatches == 0;
+
+    printf("%u random packets of 3 to %u bytes\n\n", NUMBER_OF_PACKETS, MAXIMUM_NUMBER_OF_BYTES);
+
+    printf("CRC mismatches             %u\n", crcMismatches);
+
+    printf("Decision mismatches        %u\n", decisionMismatches);
+
+    printf("Valid packets rejected     %u\n", validRejected);
+
+    printf("Corrupt packets accepted   %u\n", corruptAccepted);
+
+    printf("\n%s\n", passed ? "PASS" : "FAIL");
+
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+
+}
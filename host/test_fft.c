@@ -0,0 +1,287 @@
+/****************************************************************************
+ * test_fft.c
+ * openacousticdevices.info
+ * October 2026
+ *****************************************************************************/
+
+/* Check the real FFT against a double precision DFT and the decisions of the spectral trigger against the band energy ratio calculated from that DFT for tones in broadband noise */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "fft.h"
+#include "digitalfilter.h"
+
+/* Buffer constants matching main.c */
+
+#define NUMBER_OF_SAMPLES_IN_BUFFER             16384
+
+/* Test constants */
+
+#define MAXIMUM_TRANSFORM_LENGTH                1024
+
+#define SAMPLE_RATE                             48000
+#define SPECTRAL_WINDOW_LENGTH                  1024
+#define BAND_LOWER_FREQUENCY                    4000
+#define BAND_HIGHER_FREQUENCY                   8000
+#define RATIO_THRESHOLD                         6.0
+
+#define NOISE_AMPLITUDE                         2000
+
+/* The transform error is relative to the largest bin of the reference. Single precision gives a few parts in 1e7 at 1024 points, which leaves a wide margin for the twiddle factor recurrences */
+
+#define MAXIMUM_TRANSFORM_ERROR                 1e-5
+
+/* Decisions are only checked for windows whose reference ratio is clear of the threshold by more than the single precision error */
+
+#define RATIO_DECISION_MARGIN                   0.1
+
+/* Test parameters */
+
+static const uint32_t transformLengths[] = {16, 64, 256, 1024};
+
+static const double toneFrequencies[] = {1000.0, 4000.0, 6100.0, 7900.0, 12000.0};
+
+static const double toneAmplitudes[] = {0.0, 200.0, 400.0, 600.0, 800.0, 1000.0, 1200.0, 2000.0};
+
+#define NUMBER_OF_TRANSFORM_LENGTHS             (sizeof(transformLengths) / sizeof(uint32_t))
+#define NUMBER_OF_TONE_FREQUENCIES              (sizeof(toneFrequencies) / sizeof(double))
+#define NUMBER_OF_TONE_AMPLITUDES               (sizeof(toneAmplitudes) / sizeof(double))
+
+/* Sample buffers */
+
+static float data[MAXIMUM_TRANSFORM_LENGTH];
+
+static double input[MAXIMUM_TRANSFORM_LENGTH];
+
+static double referenceReal[MAXIMUM_TRANSFORM_LENGTH / 2 + 1];
+
+static double referenceImag[MAXIMUM_TRANSFORM_LENGTH / 2 + 1];
+
+static double cosines[MAXIMUM_TRANSFORM_LENGTH];
+
+static double sines[MAXIMUM_TRANSFORM_LENGTH];
+
+static int16_t buffer[NUMBER_OF_SAMPLES_IN_BUFFER];
+
+/* Useful macros */
+
+#define MIN(a, b)                               ((a) < (b) ? (a) : (b))
+#define MAX(a, b)                               ((a) > (b) ? (a) : (b))
+
+/* Double precision DFT of the first half of the spectrum */
+
+static void referenceTransform(const double *x, uint32_t length) {
+
+    for (uint32_t n = 0; n < length; n += 1) {
+
+        cosines[n] = cos(2.0 * M_PI * (double)n / (double)length);
+
+        sines[n] = sin(2.0 * M_PI * (double)n / (double)length);
+
+    }
+
+    for (uint32_t k = 0; k <= length / 2; k += 1) {
+
+        double real = 0.0, imag = 0.0;
+
+        for (uint32_t n = 0; n < length; n += 1) {
+
+            uint32_t index = k * n % length;
+
+            real += x[n] * cosines[index];
+
+            imag -= x[n] * sines[index];
+
+        }
+
+        referenceReal[k] = real;
+
+        referenceImag[k] = imag;
+
+    }
+
+}
+
+/* Compare the packed output of the real FFT with the reference. Returns the largest error relative to the largest reference bin */
+
+static double checkTransform(uint32_t length) {
+
+    for (uint32_t n = 0; n < length; n += 1) {
+
+        input[n] = 32768.0 * ((double)rand() / (double)RAND_MAX - 0.5);
+
+        data[n] = (float)input[n];
+
+    }
+
+    FFT_realTransform(data, length);
+
+    referenceTransform(input, length);
+
+    double maximumMagnitude = 0.0, maximumError = 0.0;
+
+    for (uint32_t k = 0; k <= length / 2; k += 1) {
+
+        maximumMagnitude = MAX(maximumMagnitude, hypot(referenceReal[k], referenceImag[k]));
+
+    }
+
+    maximumError = MAX(maximumError, fabs(data[0] - referenceReal[0]));
+
+    maximumError = MAX(maximumError, fabs(data[1] - referenceReal[length / 2]));
+
+    for (uint32_t k = 1; k < length / 2; k += 1) {
+
+        maximumError = MAX(maximumError, hypot(data[2 * k] - referenceReal[k], data[2 * k + 1] - referenceImag[k]));
+
+    }
+
+    return maximumError / maximumMagnitude;
+
+}
+
+/* Generate a buffer of a tone in white noise */
+
+static void generateBuffer(double frequency, double amplitude) {
+
+    for (uint32_t i = 0; i < NUMBER_OF_SAMPLES_IN_BUFFER; i += 1) {
+
+        double noise = 2.0 * NOISE_AMPLITUDE * ((double)rand() / (double)RAND_MAX - 0.5);
+
+        double tone = amplitude * sin(2.0 * M_PI * frequency * (double)i / SAMPLE_RATE);
+
+        buffer[i] = (int16_t)round(noise + tone);
+
+    }
+
+}
+
+/* Calculate the largest ratio in dB of the mean energy per bin inside the band to that of the other bins, excluding DC and Nyquist, over the windows of the buffer */
+
+static double referenceBandRatio() {
+
+    uint32_t maximumBin = SPECTRAL_WINDOW_LENGTH / 2 - 1;
+
+    uint32_t lowerBin = (uint32_t)round((double)BAND_LOWER_FREQUENCY * SPECTRAL_WINDOW_LENGTH / SAMPLE_RATE);
+
+    uint32_t higherBin = (uint32_t)round((double)BAND_HIGHER_FREQUENCY * SPECTRAL_WINDOW_LENGTH / SAMPLE_RATE);
+
+    double maximumRatio = -INFINITY;
+
+    for (uint32_t i = 0; i < NUMBER_OF_SAMPLES_IN_BUFFER / SPECTRAL_WINDOW_LENGTH; i += 1) {
+
+        for (uint32_t n = 0; n < SPECTRAL_WINDOW_LENGTH; n += 1) {
+
+            double window = 0.54 - 0.46 * cos(2.0 * M_PI * (double)n / (double)(SPECTRAL_WINDOW_LENGTH - 1));
+
+            input[n] = window * buffer[i * SPECTRAL_WINDOW_LENGTH + n];
+
+        }
+
+        referenceTransform(input, SPECTRAL_WINDOW_LENGTH);
+
+        double bandEnergy = 0.0, otherEnergy = 0.0;
+
+        for (uint32_t k = 1; k <= maximumBin; k += 1) {
+
+            double energy = referenceReal[k] * referenceReal[k] + referenceImag[k] * referenceImag[k];
+
+            if (k >= lowerBin && k <= higherBin) {
+
+                bandEnergy += energy;
+
+            } else {
+
+                otherEnergy += energy;
+
+            }
+
+        }
+
+        uint32_t numberOfBandBins = higherBin - lowerBin + 1;
+
+        double ratio = 10.0 * log10((bandEnergy / numberOfBandBins) / (otherEnergy / (maximumBin - numberOfBandBins)));
+
+        maximumRatio = MAX(maximumRatio, ratio);
+
+    }
+
+    return maximumRatio;
+
+}
+
+int main(int argc, char **argv) {
+
+    uint32_t failures = 0;
+
+    srand(1);
+
+    /* Compare the transform with the reference DFT */
+
+    printf("%-10s %14s\n", "Length", "Max error");
+
+    for (uint32_t i = 0; i < NUMBER_OF_TRANSFORM_LENGTHS; i += 1) {
+
+        double maximumError = checkTransform(transformLengths[i]);
+
+        bool passed = maximumError <= MAXIMUM_TRANSFORM_ERROR;
+
+        printf("%-10u %14.2e%s\n", transformLengths[i], maximumError, passed ? "" : " FAIL");
+
+        if (passed == false) failures += 1;
+
+    }
+
+    /* Compare the spectral trigger decisions with the reference band ratio */
+
+    DigitalFilter_setSpectralTrigger(SPECTRAL_WINDOW_LENGTH, SAMPLE_RATE, BAND_LOWER_FREQUENCY, BAND_HIGHER_FREQUENCY, RATIO_THRESHOLD);
+
+    printf("\n%d to %d Hz band with a %.1f dB threshold in noise of amplitude %d\n\n", BAND_LOWER_FREQUENCY, BAND_HIGHER_FREQUENCY, RATIO_THRESHOLD, NOISE_AMPLITUDE);
+
+    printf("%-10s %10s %12s %10s\n", "Tone Hz", "Amplitude", "Ratio dB", "Trigger");
+
+    uint32_t numberOfTriggers = 0, numberOfChecks = 0;
+
+    for (uint32_t i = 0; i < NUMBER_OF_TONE_FREQUENCIES; i += 1) {
+
+        for (uint32_t j = 0; j < NUMBER_OF_TONE_AMPLITUDES; j += 1) {
+
+            generateBuffer(toneFrequencies[i], toneAmplitudes[j]);
+
+            bool triggered = DigitalFilter_applySpectralTrigger(buffer, NUMBER_OF_SAMPLES_IN_BUFFER);
+
+            double ratio = referenceBandRatio();
+
+            bool checked = fabs(ratio - RATIO_THRESHOLD) > RATIO_DECISION_MARGIN;
+
+            bool passed = checked == false || triggered == (ratio > RATIO_THRESHOLD);
+
+            printf("%-10.0f %10.0f %12.2f %10s%s\n", toneFrequencies[i], toneAmplitudes[j], ratio, triggered ? "Yes" : "No", passed ? "" : " FAIL");
+
+            if (passed == false) failures += 1;
+
+            if (checked) numberOfChecks += 1;
+
+            if (triggered) numberOfTriggers += 1;
+
+        }
+
+    }
+
+    /* The tone amplitudes must take the in-band tones through the threshold */
+
+    bool decisionsTested = numberOfTriggers > 0 && numberOfTriggers < numberOfChecks;
+
+    if (decisionsTested == false) failures += 1;
+
+    printf("\n%u of %u checked buffers triggered%s\n", numberOfTriggers, numberOfChecks, decisionsTested ? "" : " FAIL");
+
+    printf("\n%s\n", failures == 0 ? "PASS" : "FAIL");
+
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+
+}
@@ -0,0 +1,291 @@
+/****************************************************************************
+ * test_filterresponse.c
+ * openacousticdevices.info
+ * October 2026
+ *****************************************************************************/
+
+/* Check the measured response of the user filters at each order against the Butterworth design and the alias rejection of the decimation filters */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* The decimation stage is private to the digital filter */
+
+#include "../src/digitalfilter.c"
+
+/* Test constants */
+
+#define SAMPLES_IN_TRANSFER                     1024
+#define TEST_TONE_AMPLITUDE                     16000
+
+#define HIGH_PASS_FREQUENCY                     1000
+#define BAND_PASS_LOWER_FREQUENCY               1000
+#define BAND_PASS_HIGHER_FREQUENCY              3000
+
+#define MAXIMUM_RESPONSE_ERROR                  0.5
+#define MAXIMUM_PASS_BAND_DEVIATION             0.5
+#define MINIMUM_ALIAS_REJECTION                 50.0
+
+/* Fractions of the output sample rate below which the decimation filter must be flat, and above which anything that aliases into the output band must be rejected */
+
+#define PASS_BAND_EDGE                          0.3
+#define STOP_BAND_EDGE                          0.75
+
+/* Test parameters */
+
+static const uint32_t sampleRates[] = {48000, 384000};
+
+static const uint32_t filterOrders[] = {0, 4, 6, 8};
+
+static const uint32_t sampleRateDividers[] = {2, 4, 6, 8, 12, 24, 48};
+
+static const double stopBandFrequencies[] = {STOP_BAND_EDGE, 1.0, 1.25, 1.75, 3.3, 7.7, 15.1};
+
+#define NUMBER_OF_SAMPLE_RATES                  (sizeof(sampleRates) / sizeof(uint32_t))
+#define NUMBER_OF_FILTER_ORDERS                 (sizeof(filterOrders) / sizeof(uint32_t))
+#define NUMBER_OF_SAMPLE_RATE_DIVIDERS          (sizeof(sampleRateDividers) / sizeof(uint32_t))
+#define NUMBER_OF_STOP_BAND_FREQUENCIES         (sizeof(stopBandFrequencies) / sizeof(double))
+
+/* Sample buffers */
+
+static int16_t source[SAMPLES_IN_TRANSFER];
+
+static int16_t destination[SAMPLES_IN_TRANSFER];
+
+/* Generate the next transfer of a test tone */
+
+static void generateTone(int16_t *buffer, uint32_t numberOfSamples, double frequency, uint32_t sampleRate, uint32_t *phase) {
+
+    for (uint32_t i = 0; i < numberOfSamples; i += 1) {
+
+        buffer[i] = (int16_t)round(TEST_TONE_AMPLITUDE * sin(2.0 * M_PI * frequency * (double)*phase / (double)sampleRate));
+
+        *phase += 1;
+
+    }
+
+}
+
+/* Measure the gain in decibels of the designed filter for a tone, discarding the first half second while the filter settles */
+
+static double measureFilterGain(DF_filterType_t type, uint32_t filterOrder, uint32_t sampleRate, double frequency) {
+
+    DigitalFilter_reset();
+
+    DigitalFilter_setFixedPointArithmetic(false);
+
+    DigitalFilter_setDecimationFilter(1);
+
+    DigitalFilter_setFilterOrder(filterOrder);
+
+    if (type == DF_HIGH_PASS_FILTER) {
+
+        DigitalFilter_designHighPassFilter(sampleRate, HIGH_PASS_FREQUENCY);
+
+    } else {
+
+        DigitalFilter_designBandPassFilter(sampleRate, BAND_PASS_LOWER_FREQUENCY, BAND_PASS_HIGHER_FREQUENCY);
+
+    }
+
+    uint32_t phase = 0;
+
+    double energy = 0.0;
+
+    uint32_t numberOfTransfers = sampleRate / SAMPLES_IN_TRANSFER;
+
+    for (uint32_t i = 0; i < numberOfTransfers; i += 1) {
+
+        generateTone(source, SAMPLES_IN_TRANSFER, frequency, sampleRate, &phase);
+
+        DigitalFilter_applyFilter(source, destination, 1, SAMPLES_IN_TRANSFER);
+
+        if (i < numberOfTransfers / 2) continue;
+
+        for (uint32_t j = 0; j < SAMPLES_IN_TRANSFER; j += 1) energy += (double)destination[j] * (double)destination[j];
+
+    }
+
+    double meanSquare = energy / (double)((numberOfTransfers - numberOfTransfers / 2) * SAMPLES_IN_TRANSFER);
+
+    return 10.0 * log10(meanSquare / (0.5 * TEST_TONE_AMPLITUDE * TEST_TONE_AMPLITUDE));
+
+}
+
+/* Digital Butterworth response after the bilinear transform, with N prototype poles */
+
+static double butterworthGain(DF_filterType_t type, uint32_t numberOfPrototypePoles, uint32_t sampleRate, double frequency) {
+
+    double omega = tan(M_PI * frequency / (double)sampleRate);
+
+    double x;
+
+    if (type == DF_HIGH_PASS_FILTER) {
+
+        x = tan(M_PI * HIGH_PASS_FREQUENCY / (double)sampleRate) / omega;
+
+    } else {
+
+        double omega1 = tan(M_PI * BAND_PASS_LOWER_FREQUENCY / (double)sampleRate);
+
+        double omega2 = tan(M_PI * BAND_PASS_HIGHER_FREQUENCY / (double)sampleRate);
+
+        x = (omega * omega - omega1 * omega2) / (omega * (omega2 - omega1));
+
+    }
+
+    return -10.0 * log10(1.0 + pow(x * x, numberOfPrototypePoles));
+
+}
+
+/* Measure the gain in decibels of the decimation stage for a tone at the raw sample rate, relative to the ideal gain of the divider */
+
+static double measureDecimationGain(uint32_t sampleRateDivider, double frequency) {
+
+    static const uint32_t rawSampleRate = 384000;
+
+    DigitalFilter_setDecimationFilter(sampleRateDivider);
+
+    uint32_t phase = 0;
+
+    uint32_t historyIndex = 0;
+
+    double energy = 0.0;
+
+    uint32_t numberOfOutputSamples = 0;
+
+    uint32_t numberOfTransfers = rawSampleRate / SAMPLES_IN_TRANSFER;
+
+    uint32_t numberOfRawSamples = SAMPLES_IN_TRANSFER / sampleRateDivider * sampleRateDivider;
+
+    for (uint32_t i = 0; i < numberOfTransfers; i += 1) {
+
+        generateTone(source, numberOfRawSamples, frequency, rawSampleRate, &phase);
+
+        for (uint32_t j = 0; j < numberOfRawSamples; j += sampleRateDivider) {
+
+            double sample = (double)decimate(source + j, sampleRateDivider, &historyIndex) / (double)sampleRateDivider;
+
+            if (i < numberOfTransfers / 4) continue;
+
+            energy += sample * sample;
+
+            numberOfOutputSamples += 1;
+
+        }
+
+    }
+
+    return 10.0 * log10(energy / (double)numberOfOutputSamples / (0.5 * TEST_TONE_AMPLITUDE * TEST_TONE_AMPLITUDE));
+
+}
+
+/* Compare measured and designed responses at the edges, an octave outside them and in the pass band */
+
+static uint32_t testFilterResponse(DF_filterType_t type, uint32_t filterOrder, uint32_t sampleRate) {
+
+    uint32_t failures = 0;
+
+    uint32_t numberOfPrototypePoles = filterOrder == 0 ? 1 : type == DF_HIGH_PASS_FILTER ? filterOrder : filterOrder / 2;
+
+    double highPassFrequencies[] = {HIGH_PASS_FREQUENCY / 2.0, HIGH_PASS_FREQUENCY, 2.0 * HIGH_PASS_FREQUENCY, 8.0 * HIGH_PASS_FREQUENCY};
+
+    double bandPassFrequencies[] = {BAND_PASS_LOWER_FREQUENCY / 2.0, BAND_PASS_LOWER_FREQUENCY, sqrt(BAND_PASS_LOWER_FREQUENCY * BAND_PASS_HIGHER_FREQUENCY), BAND_PASS_HIGHER_FREQUENCY, 2.0 * BAND_PASS_HIGHER_FREQUENCY};
+
+    double *frequencies = type == DF_HIGH_PASS_FILTER ? highPassFrequencies : bandPassFrequencies;
+
+    uint32_t numberOfFrequencies = type == DF_HIGH_PASS_FILTER ? sizeof(highPassFrequencies) / sizeof(double) : sizeof(bandPassFrequencies) / sizeof(double);
+
+    printf("%7u  %-10s %5u ", sampleRate, type == DF_HIGH_PASS_FILTER ? "High-pass" : "Band-pass", filterOrder);
+
+    for (uint32_t i = 0; i < numberOfFrequencies; i += 1) {
+
+        double measured = measureFilterGain(type, filterOrder, sampleRate, frequencies[i]);
+
+        double expected = butterworthGain(type, numberOfPrototypePoles, sampleRate, frequencies[i]);
+
+        bool passed = fabs(measured - expected) <= MAXIMUM_RESPONSE_ERROR;
+
+        printf(" %6.0fHz %7.2f (%7.2f)%s", frequencies[i], measured, expected, passed ? "" : " FAIL");
+
+        if (passed == false) failures += 1;
+
+    }
+
+    printf("\n");
+
+    return failures;
+
+}
+
+/* Check the decimation filter pass band and the rejection of every frequency which aliases into the output band */
+
+static uint32_t testDecimationResponse(uint32_t sampleRateDivider) {
+
+    uint32_t failures = 0;
+
+    double outputSampleRate = 384000.0 / (double)sampleRateDivider;
+
+    double passBandGain = measureDecimationGain(sampleRateDivider, PASS_BAND_EDGE * outputSampleRate);
+
+    bool passed = fabs(passBandGain) <= MAXIMUM_PASS_BAND_DEVIATION;
+
+    printf("%7.0f  %6.2f%s", outputSampleRate, passBandGain, passed ? "" : " FAIL");
+
+    if (passed == false) failures += 1;
+
+    for (uint32_t i = 0; i < NUMBER_OF_STOP_BAND_FREQUENCIES; i += 1) {
+
+        double frequency = stopBandFrequencies[i] * outputSampleRate;
+
+        if (frequency >= 192000.0) break;
+
+        double gain = measureDecimationGain(sampleRateDivider, frequency);
+
+        passed = gain <= -MINIMUM_ALIAS_REJECTION;
+
+        printf(" %8.0fHz %6.1f%s", frequency, gain, passed ? "" : " FAIL");
+
+        if (passed == false) failures += 1;
+
+    }
+
+    printf("\n");
+
+    return failures;
+
+}
+
+int main(int argc, char **argv) {
+
+    uint32_t failures = 0;
+
+    printf("Filter gain in dB at each frequency, with the Butterworth design in brackets\n\n");
+
+    for (uint32_t i = 0; i < NUMBER_OF_SAMPLE_RATES; i += 1) {
+
+        for (uint32_t j = 0; j < NUMBER_OF_FILTER_ORDERS; j += 1) {
+
+            failures += testFilterResponse(DF_HIGH_PASS_FILTER, filterOrders[j], sampleRates[i]);
+
+            failures += testFilterResponse(DF_BAND_PASS_FILTER, filterOrders[j], sampleRates[i]);
+
+        }
+
+    }
+
+    printf("\nDecimation gain in dB at %.2f of the output rate, then at frequencies which alias into the output band\n\n", PASS_BAND_EDGE);
+
+    for (uint32_t i = 0; i < NUMBER_OF_SAMPLE_RATE_DIVIDERS; i += 1) {
+
+        failures += testDecimationResponse(sampleRateDividers[i]);
+
+    }
+
+    printf("\n%s\n", failures == 0 ? "PASS" : "FAIL");
+
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+
+}
@@ -0,0 +1,285 @@
+/****************************************************************************
+ * test_fixedpoint.c
+ * openacousticdevices.info
+ * October 2026
+ *****************************************************************************/
+
+/* Check that the fixed-point filter and trigger path matches the floating-point path at each supported sample rate */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* The filter state and decimation stage are private to the digital filter */
+
+#include "../src/digitalfilter.c"
+
+/* Buffer constants matching main.c */
+
+#define MAXIMUM_SAMPLES_IN_DMA_TRANSFER         1024
+#define NUMBER_OF_SAMPLES_IN_BUFFER             16384
+
+/* Test constants */
+
+#define NUMBER_OF_TRANSFERS                     512
+#define NOISE_AMPLITUDE                         200
+#define RAW_SAMPLE_LIMIT                        2047
+
+#define BAND_PASS_LOWER_FREQUENCY               1000
+#define BAND_PASS_HIGHER_FREQUENCY              3000
+#define DC_BLOCKING_FREQUENCY                   48
+#define TEST_TONE_FREQUENCY                     2000
+
+#define AMPLITUDE_THRESHOLD                     4000
+#define FREQUENCY_TRIGGER_WINDOW_LENGTH         64
+#define FREQUENCY_TRIGGER_BLOCK_SIZE            256
+#define FREQUENCY_TRIGGER_THRESHOLD             10.0f
+
+/* The fixed-point output is rounded so it must lie within one LSB of the exact filter output, while the floating-point output is truncated */
+
+#define MAXIMUM_FIXED_POINT_ERROR               1.0
+#define MAXIMUM_TRIGGER_MISMATCH_PERCENTAGE     2.0
+
+/* Supported sample rates as configured by the configuration app */
+
+typedef struct {
+    uint32_t sampleRate;
+    uint32_t sampleRateDivider;
+} sampleRate_t;
+
+static const sampleRate_t sampleRates[] = {
+    {384000, 48},
+    {384000, 24},
+    {384000, 12},
+    {384000, 8},
+    {384000, 4},
+    {384000, 2},
+    {250000, 1},
+    {384000, 1}
+};
+
+#define NUMBER_OF_SAMPLE_RATES                  (sizeof(sampleRates) / sizeof(sampleRate_t))
+
+/* Test cases */
+
+typedef enum {AMPLITUDE_TRIGGER, FREQUENCY_TRIGGER} trigger_t;
+
+typedef struct {
+    char *name;
+    DF_filterType_t filter;
+    trigger_t trigger;
+    uint32_t peakAmplitude;
+} testCase_t;
+
+static const testCase_t testCases[] = {
+    {"High-pass + amplitude", DF_HIGH_PASS_FILTER, AMPLITUDE_TRIGGER, 500},
+    {"Band-pass + amplitude", DF_BAND_PASS_FILTER, AMPLITUDE_TRIGGER, 500},
+    {"Band-pass + Goertzel", DF_BAND_PASS_FILTER, FREQUENCY_TRIGGER, 500},
+    {"High-pass clipping", DF_HIGH_PASS_FILTER, AMPLITUDE_TRIGGER, RAW_SAMPLE_LIMIT},
+    {"Band-pass clipping", DF_BAND_PASS_FILTER, AMPLITUDE_TRIGGER, RAW_SAMPLE_LIMIT}
+};
+
+#define NUMBER_OF_TEST_CASES                    (sizeof(testCases) / sizeof(testCase_t))
+
+/* Sample buffers */
+
+static int16_t source[NUMBER_OF_TRANSFERS * MAXIMUM_SAMPLES_IN_DMA_TRANSFER];
+
+static int16_t floatOutput[NUMBER_OF_TRANSFERS * MAXIMUM_SAMPLES_IN_DMA_TRANSFER];
+
+static int16_t fixedOutput[NUMBER_OF_TRANSFERS * MAXIMUM_SAMPLES_IN_DMA_TRANSFER];
+
+static double referenceOutput[NUMBER_OF_TRANSFERS * MAXIMUM_SAMPLES_IN_DMA_TRANSFER];
+
+static bool floatTriggers[NUMBER_OF_TRANSFERS * MAXIMUM_SAMPLES_IN_DMA_TRANSFER / FREQUENCY_TRIGGER_BLOCK_SIZE];
+
+static bool fixedTriggers[NUMBER_OF_TRANSFERS * MAXIMUM_SAMPLES_IN_DMA_TRANSFER / FREQUENCY_TRIGGER_BLOCK_SIZE];
+
+/* Generate a tone at the raw ADC scale which ramps from silence to the peak amplitude and back, so the trigger opens and closes */
+
+static void generateSamples(uint32_t numberOfSamples, uint32_t sampleRate, uint32_t peakAmplitude) {
+
+    srand(1);
+
+    for (uint32_t i = 0; i < numberOfSamples; i += 1) {
+
+        float envelope = sinf((float)M_PI * (float)i / (float)numberOfSamples);
+
+        float tone = (float)peakAmplitude * envelope * sinf(2.0f * (float)M_PI * (float)TEST_TONE_FREQUENCY * (float)i / (float)sampleRate);
+
+        float noise = NOISE_AMPLITUDE * ((float)rand() / (float)RAND_MAX - 0.5f);
+
+        source[i] = (int16_t)MAX(-RAW_SAMPLE_LIMIT - 1, MIN(RAW_SAMPLE_LIMIT, tone + noise));
+
+    }
+
+}
+
+/* Configure the digital filter as makeRecording does and process the source one DMA transfer at a time. Returns the number of trigger decisions */
+
+static uint32_t runPath(const testCase_t *testCase, bool fixedPoint, uint32_t sampleRate, uint32_t sampleRateDivider, uint32_t numberOfRawSamples, int16_t *output, bool *triggers) {
+
+    uint32_t effectiveSampleRate = sampleRate / sampleRateDivider;
+
+    DigitalFilter_reset();
+
+    DigitalFilter_setFixedPointArithmetic(fixedPoint);
+
+    DigitalFilter_setDecimationFilter(sampleRateDivider);
+
+    DigitalFilter_setFilterOrder(0);
+
+    if (testCase->filter == DF_HIGH_PASS_FILTER) {
+
+        DigitalFilter_designHighPassFilter(effectiveSampleRate, DC_BLOCKING_FREQUENCY);
+
+    } else {
+
+        DigitalFilter_designBandPassFilter(effectiveSampleRate, BAND_PASS_LOWER_FREQUENCY, BAND_PASS_HIGHER_FREQUENCY);
+
+    }
+
+    DigitalFilter_setAdditionalGain(16.0f / (float)sampleRateDivider);
+
+    if (testCase->trigger == AMPLITUDE_TRIGGER) DigitalFilter_setAmplitudeThreshold(AMPLITUDE_THRESHOLD);
+
+    if (testCase->trigger == FREQUENCY_TRIGGER) DigitalFilter_setFrequencyTrigger(FREQUENCY_TRIGGER_WINDOW_LENGTH, effectiveSampleRate, TEST_TONE_FREQUENCY, FREQUENCY_TRIGGER_THRESHOLD);
+
+    DigitalFilter_setTriggerActive(false);
+
+    uint32_t numberOfOutputSamples = numberOfRawSamples / sampleRateDivider;
+
+    for (uint32_t i = 0; i < NUMBER_OF_TRANSFERS; i += 1) {
+
+        triggers[i] = DigitalFilter_applyFilter(source + i * numberOfRawSamples, output + i * numberOfOutputSamples, sampleRateDivider, numberOfRawSamples);
+
+    }
+
+    if (testCase->trigger == AMPLITUDE_TRIGGER || sampleRateDivider == 1) return NUMBER_OF_TRANSFERS;
+
+    /* With decimation the Goertzel trigger runs on the filtered output in the main loop */
+
+    uint32_t numberOfBlocks = NUMBER_OF_TRANSFERS * numberOfOutputSamples / FREQUENCY_TRIGGER_BLOCK_SIZE;
+
+    for (uint32_t i = 0; i < numberOfBlocks; i += 1) {
+
+        triggers[i] = DigitalFilter_applyFrequencyTrigger(output + i * FREQUENCY_TRIGGER_BLOCK_SIZE, FREQUENCY_TRIGGER_BLOCK_SIZE);
+
+    }
+
+    return numberOfBlocks;
+
+}
+
+/* Apply the designed floating-point coefficients in double precision to the shared decimation stage output */
+
+static void runReference(const testCase_t *testCase, uint32_t sampleRateDivider, uint32_t numberOfSamples, double *output) {
+
+    double s1 = 0.0, s2 = 0.0;
+
+    uint32_t historyIndex = 0;
+
+    DigitalFilter_setDecimationFilter(sampleRateDivider);
+
+    for (uint32_t i = 0; i < numberOfSamples; i += sampleRateDivider) {
+
+        double x = (double)gain * (double)decimate(source + i, sampleRateDivider, &historyIndex);
+
+        double y = x + s1;
+
+        if (testCase->filter == DF_HIGH_PASS_FILTER) {
+
+            s1 = (double)yc0 * y - x;
+
+        } else {
+
+            s1 = (double)yc1 * y + s2;
+
+            s2 = (double)yc0 * y - x;
+
+        }
+
+        *output++ = MAX(-INT16_MAX, MIN(INT16_MAX, y));
+
+    }
+
+}
+
+int main(int argc, char **argv) {
+
+    uint32_t failures = 0;
+
+    printf("%7s  %-24s %11s %11s %11s %9s %9s\n", "Rate", "Case", "Float err", "Fixed err", "Difference", "Triggers", "Mismatch");
+
+    for (uint32_t i = 0; i < NUMBER_OF_SAMPLE_RATES; i += 1) {
+
+        uint32_t sampleRate = sampleRates[i].sampleRate;
+
+        uint32_t sampleRateDivider = sampleRates[i].sampleRateDivider;
+
+        /* Match the DMA transfer size calculation in makeRecording */
+
+        uint32_t numberOfRawSamples = MAXIMUM_SAMPLES_IN_DMA_TRANSFER / sampleRateDivider;
+
+        while (numberOfRawSamples & (numberOfRawSamples - 1)) numberOfRawSamples = numberOfRawSamples & (numberOfRawSamples - 1);
+
+        numberOfRawSamples *= sampleRateDivider;
+
+        uint32_t numberOfOutputSamples = NUMBER_OF_TRANSFERS * numberOfRawSamples / sampleRateDivider;
+
+        for (uint32_t j = 0; j < NUMBER_OF_TEST_CASES; j += 1) {
+
+            const testCase_t *testCase = testCases + j;
+
+            generateSamples(NUMBER_OF_TRANSFERS * numberOfRawSamples, sampleRate, testCase->peakAmplitude);
+
+            uint32_t numberOfDecisions = runPath(testCase, false, sampleRate, sampleRateDivider, numberOfRawSamples, floatOutput, floatTriggers);
+
+            runReference(testCase, sampleRateDivider, NUMBER_OF_TRANSFERS * numberOfRawSamples, referenceOutput);
+
+            runPath(testCase, true, sampleRate, sampleRateDivider, numberOfRawSamples, fixedOutput, fixedTriggers);
+
+            double floatError = 0.0, fixedError = 0.0;
+
+            int32_t maximumDifference = 0;
+
+            for (uint32_t k = 0; k < numberOfOutputSamples; k += 1) {
+
+                floatError = MAX(floatError, fabs((double)floatOutput[k] - referenceOutput[k]));
+
+                fixedError = MAX(fixedError, fabs((double)fixedOutput[k] - referenceOutput[k]));
+
+                maximumDifference = MAX(maximumDifference, abs((int32_t)floatOutput[k] - (int32_t)fixedOutput[k]));
+
+            }
+
+            /* Decisions can only differ where the peak or band energy lies within the output error of the threshold */
+
+            uint32_t numberOfTriggers = 0;
+
+            uint32_t numberOfMismatches = 0;
+
+            for (uint32_t k = 0; k < numberOfDecisions; k += 1) {
+
+                if (floatTriggers[k]) numberOfTriggers += 1;
+
+                if (floatTriggers[k] != fixedTriggers[k]) numberOfMismatches += 1;
+
+            }
+
+            bool passed = fixedError <= MAXIMUM_FIXED_POINT_ERROR && numberOfTriggers > 0 && numberOfTriggers < numberOfDecisions && 100.0 * numberOfMismatches <= MAXIMUM_TRIGGER_MISMATCH_PERCENTAGE * numberOfDecisions;
+
+            printf("%7u  %-24s %11.3f %11.3f %11d %9u %9u %s\n", sampleRate / sampleRateDivider, testCase->name, floatError, fixedError, maximumDifference, numberOfTriggers, numberOfMismatches, passed ? "" : "FAIL");
+
+            if (passed == false) failures += 1;
+
+        }
+
+    }
+
+    printf("\n%s\n", failures == 0 ? "PASS" : "FAIL");
+
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+
+}
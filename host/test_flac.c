@@ -0,0 +1,652 @@
+/****************************************************************************
+ * test_flac.c
+ * openacousticdevices.info
+ * October 2026
+ *****************************************************************************/
+
+/* Round-trip test signals through the FLAC encoder and a separate decoder written from the format specification, and report the encoding cost and compression ratio */
+
+#include <math.h>
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "flac.h"
+
+/* Test constants */
+
+#define SAMPLE_RATE                             48000
+#define NUMBER_OF_FRAMES                        2100
+#define MAXIMUM_NUMBER_OF_SAMPLES               (NUMBER_OF_FRAMES * FLAC_BLOCK_SIZE)
+#define MAXIMUM_STREAM_SIZE                     (FLAC_HEADER_SIZE + NUMBER_OF_FRAMES * (2 * FLAC_BLOCK_SIZE + 32))
+
+#define TEST_TONE_FREQUENCY                     3000
+#define TEST_TONE_AMPLITUDE                     8000
+#define NOISE_AMPLITUDE                         1000
+
+#define SILENT_FRAME_INTERVAL                   3
+
+#define NANOSECONDS_IN_SECOND                   1000000000.0
+
+#define TEST_ARTIST                             "AudioMoth 0123456789ABCDEF"
+#define TEST_COMMENT                            "Recorded at 12:00:00 01/01/2026 (UTC) by AudioMoth 0123456789ABCDEF at medium gain while battery was 4.2V."
+
+/* Test signals */
+
+typedef enum {SILENCE, LOW_PASS_NOISE, TONE_IN_NOISE, WHITE_NOISE, CLICKS, SILENT_FRAMES} signal_t;
+
+typedef struct {
+    char *name;
+    signal_t signal;
+    uint32_t numberOfSamples;
+} testCase_t;
+
+/* The clicks give residuals with Rice quotients longer than a single write. The lengths cover final frames of one sample, fewer samples than the maximum predictor order, an odd length and a full block */
+
+static const testCase_t testCases[] = {
+    {"Silence", SILENCE, 600 * FLAC_BLOCK_SIZE + 1},
+    {"Low-pass noise", LOW_PASS_NOISE, MAXIMUM_NUMBER_OF_SAMPLES},
+    {"Tone in noise", TONE_IN_NOISE, 600 * FLAC_BLOCK_SIZE + 333},
+    {"White noise", WHITE_NOISE, 600 * FLAC_BLOCK_SIZE + 3},
+    {"Tone with full-scale clicks", CLICKS, 600 * FLAC_BLOCK_SIZE + 4},
+    {"Tone with silent frames", SILENT_FRAMES, 600 * FLAC_BLOCK_SIZE + 1000}
+};
+
+#define NUMBER_OF_TEST_CASES                    (sizeof(testCases) / sizeof(testCase_t))
+
+/* Sample and stream buffers */
+
+static int16_t source[MAXIMUM_NUMBER_OF_SAMPLES];
+
+static int16_t decoded[MAXIMUM_NUMBER_OF_SAMPLES];
+
+static uint8_t stream[MAXIMUM_STREAM_SIZE];
+
+/* Useful macros */
+
+#define MIN(a, b)                               ((a) < (b) ? (a) : (b))
+#define MAX(a, b)                               ((a) > (b) ? (a) : (b))
+
+/* Timing functions */
+
+static double getSeconds() {
+
+    struct timespec time;
+
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    return (double)time.tv_sec + (double)time.tv_nsec / NANOSECONDS_IN_SECOND;
+
+}
+
+static uint64_t getCycles() {
+
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+
+}
+
+/* Encode some frames as silent frames, as makeRecording does for buffers which are not triggered */
+
+static bool isSilentFrame(const testCase_t *testCase, uint32_t frame) {
+
+    return testCase->signal == SILENT_FRAMES && frame % SILENT_FRAME_INTERVAL == 1;
+
+}
+
+/* Generate the test signal */
+
+static void generateSamples(const testCase_t *testCase) {
+
+    srand(1);
+
+    double state = 0.0;
+
+    for (uint32_t i = 0; i < testCase->numberOfSamples; i += 1) {
+
+        double noise = (double)rand() / (double)RAND_MAX - 0.5;
+
+        double tone = TEST_TONE_AMPLITUDE * sin(2.0 * M_PI * TEST_TONE_FREQUENCY * (double)i / SAMPLE_RATE);
+
+        double sample = 0.0;
+
+        switch (testCase->signal) {
+
+            case SILENCE:
+                break;
+
+            case LOW_PASS_NOISE:
+                state = 0.95 * state + 0.05 * 20.0 * NOISE_AMPLITUDE * noise;
+                sample = state;
+                break;
+
+            case TONE_IN_NOISE:
+            case SILENT_FRAMES:
+                sample = tone + NOISE_AMPLITUDE * noise;
+                break;
+
+            case WHITE_NOISE:
+                sample = 65535.0 * noise;
+                break;
+
+            case CLICKS:
+                sample = tone / 64.0;
+                if (i % 997 == 0) sample = i % 2 ? INT16_MAX : INT16_MIN;
+                break;
+
+        }
+
+        source[i] = (int16_t)MAX(INT16_MIN, MIN(INT16_MAX, round(sample)));
+
+    }
+
+    /* Silent frames are decoded as zero */
+
+    for (uint32_t i = 0; i < testCase->numberOfSamples; i += 1) {
+
+        if (isSilentFrame(testCase, i / FLAC_BLOCK_SIZE)) source[i] = 0;
+
+    }
+
+}
+
+/* Encode the signal as makeRecording does, with the header written last. Returns the size of the stream */
+
+static uint32_t encodeStream(const testCase_t *testCase, double *seconds, uint64_t *cycles) {
+
+    uint32_t streamSize = FLAC_HEADER_SIZE;
+
+    FLAC_initialise(SAMPLE_RATE);
+
+    double startTime = getSeconds();
+
+    uint64_t startCycles = getCycles();
+
+    for (uint32_t i = 0; i < testCase->numberOfSamples; i += FLAC_BLOCK_SIZE) {
+
+        uint32_t frameSize;
+
+        uint32_t numberOfSamples = MIN(FLAC_BLOCK_SIZE, testCase->numberOfSamples - i);
+
+        uint8_t *frame = isSilentFrame(testCase, i / FLAC_BLOCK_SIZE) ? FLAC_encodeSilentFrame(numberOfSamples, &frameSize) : FLAC_encodeFrame(source + i, numberOfSamples, &frameSize);
+
+        memcpy(stream + streamSize, frame, frameSize);
+
+        streamSize += frameSize;
+
+    }
+
+    *cycles = getCycles() - startCycles;
+
+    *seconds = getSeconds() - startTime;
+
+    memcpy(stream, FLAC_encodeHeader(TEST_ARTIST, TEST_COMMENT), FLAC_HEADER_SIZE);
+
+    return streamSize;
+
+}
+
+/* Bit reader */
+
+static uint8_t *readPointer;
+
+static uint32_t readBitOffset;
+
+static uint32_t readBits(uint32_t numberOfBits) {
+
+    uint32_t value = 0;
+
+    for (uint32_t i = 0; i < numberOfBits; i += 1) {
+
+        value = (value << 1) | ((readPointer[readBitOffset / 8] >> (7 - readBitOffset % 8)) & 1);
+
+        readBitOffset += 1;
+
+    }
+
+    return value;
+
+}
+
+static int32_t readSignedBits(uint32_t numberOfBits) {
+
+    if (numberOfBits == 0) return 0;
+
+    uint32_t value = readBits(numberOfBits);
+
+    return value & (1u << (numberOfBits - 1)) ? (int32_t)value - (int32_t)(1u << numberOfBits) : (int32_t)value;
+
+}
+
+static int32_t readRiceCode(uint32_t parameter) {
+
+    uint32_t quotient = 0;
+
+    while (readBits(1) == 0) quotient += 1;
+
+    uint32_t foldedValue = (quotient << parameter) | readBits(parameter);
+
+    return foldedValue & 1 ? -(int32_t)(foldedValue >> 1) - 1 : (int32_t)(foldedValue >> 1);
+
+}
+
+static uint32_t readLittleEndian() {
+
+    uint32_t value = 0;
+
+    for (uint32_t i = 0; i < 4; i += 1) value |= readBits(8) << (8 * i);
+
+    return value;
+
+}
+
+/* Bitwise CRC calculations from the specification, independent of the encoder's tables */
+
+static uint32_t calculateCRC(uint8_t *data, uint32_t length, uint32_t polynomial, uint32_t width) {
+
+    uint32_t crc = 0;
+
+    uint32_t topBit = 1u << (width - 1);
+
+    uint32_t mask = (1u << width) - 1;
+
+    for (uint32_t i = 0; i < length; i += 1) {
+
+        crc ^= (uint32_t)data[i] << (width - 8);
+
+        for (uint32_t j = 0; j < 8; j += 1) crc = crc & topBit ? ((crc << 1) ^ polynomial) & mask : (crc << 1) & mask;
+
+    }
+
+    return crc;
+
+}
+
+/* Decoder failure reporting */
+
+#define CHECK(condition, ...) if (!(condition)) { printf("\n    "); printf(__VA_ARGS__); printf("\n"); return false; }
+
+/* Parse the stream marker and metadata blocks */
+
+static bool decodeHeader(uint32_t numberOfSamples, uint32_t *minimumFrameSize, uint32_t *maximumFrameSize) {
+
+    readPointer = stream;
+
+    readBitOffset = 0;
+
+    CHECK(memcmp(stream, "fLaC", 4) == 0, "Missing stream marker");
+
+    readBitOffset = 32;
+
+    bool lastBlock = false;
+
+    bool foundStreamInfo = false;
+
+    bool foundComment = false;
+
+    while (lastBlock == false) {
+
+        lastBlock = readBits(1);
+
+        uint32_t blockType = readBits(7);
+
+        uint32_t blockLength = readBits(24);
+
+        uint32_t blockEnd = readBitOffset / 8 + blockLength;
+
+        CHECK(blockEnd <= FLAC_HEADER_SIZE, "Metadata block %u overruns the header", blockType);
+
+        if (blockType == 0) {
+
+            CHECK(blockLength == 34, "STREAMINFO length %u", blockLength);
+
+            uint32_t minimumBlockSize = readBits(16);
+
+            uint32_t maximumBlockSize = readBits(16);
+
+            CHECK(minimumBlockSize == FLAC_BLOCK_SIZE && maximumBlockSize == FLAC_BLOCK_SIZE, "Block sizes %u and %u", minimumBlockSize, maximumBlockSize);
+
+            *minimumFrameSize = readBits(24);
+
+            *maximumFrameSize = readBits(24);
+
+            uint32_t sampleRate = readBits(20);
+
+            uint32_t numberOfChannels = readBits(3) + 1;
+
+            uint32_t bitsPerSample = readBits(5) + 1;
+
+            uint64_t totalNumberOfSamples = (uint64_t)readBits(4) << 32;
+
+            totalNumberOfSamples |= readBits(32);
+
+            CHECK(sampleRate == SAMPLE_RATE && numberOfChannels == 1 && bitsPerSample == 16, "Stream format %u Hz %u channels %u bits", sampleRate, numberOfChannels, bitsPerSample);
+
+            CHECK(totalNumberOfSamples == numberOfSamples, "Total samples %llu", (unsigned long long)totalNumberOfSamples);
+
+            foundStreamInfo = true;
+
+        } else if (blockType == 4) {
+
+            uint32_t vendorLength = readLittleEndian();
+
+            readBitOffset += 8 * vendorLength;
+
+            uint32_t numberOfComments = readLittleEndian();
+
+            CHECK(numberOfComments == 2, "%u Vorbis comments", numberOfComments);
+
+            char *expected[] = {"ARTIST=" TEST_ARTIST, "COMMENT=" TEST_COMMENT};
+
+            for (uint32_t i = 0; i < numberOfComments; i += 1) {
+
+                uint32_t length = readLittleEndian();
+
+                CHECK(length == strlen(expected[i]) && memcmp(readPointer + readBitOffset / 8, expected[i], length) == 0, "Vorbis comment %u does not match", i);
+
+                readBitOffset += 8 * length;
+
+            }
+
+            foundComment = true;
+
+        } else {
+
+            CHECK(blockType == 1, "Unexpected metadata block %u", blockType);
+
+        }
+
+        CHECK(readBitOffset <= 8 * blockEnd, "Metadata block %u contents overrun its length", blockType);
+
+        readBitOffset = 8 * blockEnd;
+
+    }
+
+    CHECK(foundStreamInfo && foundComment, "Missing STREAMINFO or VORBIS_COMMENT");
+
+    CHECK(readBitOffset == 8 * FLAC_HEADER_SIZE, "Header is %u bytes", readBitOffset / 8);
+
+    return true;
+
+}
+
+/* Decode the residual of a fixed predictor subframe */
+
+static bool decodeResidual(int32_t *residual, uint32_t numberOfSamples, uint32_t order) {
+
+    uint32_t codingMethod = readBits(2);
+
+    CHECK(codingMethod <= 1, "Residual coding method %u", codingMethod);
+
+    uint32_t parameterBits = codingMethod == 0 ? 4 : 5;
+
+    uint32_t escapeCode = (1u << parameterBits) - 1;
+
+    uint32_t partitionOrder = readBits(4);
+
+    uint32_t numberOfPartitions = 1u << partitionOrder;
+
+    CHECK((numberOfSamples >> partitionOrder) << partitionOrder == numberOfSamples && (numberOfSamples >> partitionOrder) > order, "Partition order %u for %u samples", partitionOrder, numberOfSamples);
+
+    uint32_t index = order;
+
+    for (uint32_t j = 0; j < numberOfPartitions; j += 1) {
+
+        uint32_t parameter = readBits(parameterBits);
+
+        uint32_t end = (j + 1) * (numberOfSamples >> partitionOrder);
+
+        if (parameter == escapeCode) {
+
+            uint32_t numberOfBits = readBits(5);
+
+            for (; index < end; index += 1) residual[index] = readSignedBits(numberOfBits);
+
+        } else {
+
+            for (; index < end; index += 1) residual[index] = readRiceCode(parameter);
+
+        }
+
+    }
+
+    return true;
+
+}
+
+/* Decode one frame, checking both CRCs and the frame number */
+
+static bool decodeFrame(uint32_t frameNumber, int16_t *output, uint32_t *numberOfSamples) {
+
+    uint32_t frameStart = readBitOffset / 8;
+
+    CHECK(readBits(14) == 0x3FFE, "Frame %u sync code", frameNumber);
+
+    CHECK(readBits(1) == 0, "Frame %u reserved bit", frameNumber);
+
+    CHECK(readBits(1) == 0, "Frame %u is not fixed block size", frameNumber);
+
+    uint32_t blockSizeCode = readBits(4);
+
+    uint32_t sampleRateCode = readBits(4);
+
+    uint32_t channelAssignment = readBits(4);
+
+    uint32_t sampleSizeCode = readBits(3);
+
+    CHECK(readBits(1) == 0, "Frame %u reserved bit", frameNumber);
+
+    CHECK(sampleRateCode == 0 && channelAssignment == 0 && sampleSizeCode == 4, "Frame %u format codes", frameNumber);
+
+    /* Decode the UTF-8 style frame number */
+
+    uint32_t firstByte = readBits(8);
+
+    uint32_t numberOfExtraBytes = 0;
+
+    while (firstByte & (0x80 >> numberOfExtraBytes)) numberOfExtraBytes += 1;
+
+    CHECK(numberOfExtraBytes != 1 && numberOfExtraBytes <= 6, "Frame %u number coding", frameNumber);
+
+    if (numberOfExtraBytes > 0) numberOfExtraBytes -= 1;
+
+    uint32_t codedFrameNumber = firstByte & (0x7F >> (numberOfExtraBytes + (numberOfExtraBytes > 0)));
+
+    for (uint32_t i = 0; i < numberOfExtraBytes; i += 1) {
+
+        uint32_t byte = readBits(8);
+
+        CHECK((byte & 0xC0) == 0x80, "Frame %u number continuation byte", frameNumber);
+
+        codedFrameNumber = (codedFrameNumber << 6) | (byte & 0x3F);
+
+    }
+
+    CHECK(codedFrameNumber == frameNumber, "Frame %u coded as %u", frameNumber, codedFrameNumber);
+
+    if (blockSizeCode >= 8) {
+
+        *numberOfSamples = 256 << (blockSizeCode - 8);
+
+    } else if (blockSizeCode == 6) {
+
+        *numberOfSamples = readBits(8) + 1;
+
+    } else if (blockSizeCode == 7) {
+
+        *numberOfSamples = readBits(16) + 1;
+
+    } else {
+
+        CHECK(false, "Frame %u block size code %u", frameNumber, blockSizeCode);
+
+    }
+
+    uint32_t crc8 = calculateCRC(stream + frameStart, readBitOffset / 8 - frameStart, 0x07, 8);
+
+    CHECK(readBits(8) == crc8, "Frame %u CRC-8", frameNumber);
+
+    /* Decode the subframe */
+
+    CHECK(readBits(1) == 0, "Frame %u subframe padding bit", frameNumber);
+
+    uint32_t subframeType = readBits(6);
+
+    CHECK(readBits(1) == 0, "Frame %u wasted bits", frameNumber);
+
+    static int32_t residual[FLAC_BLOCK_SIZE];
+
+    if (subframeType == 0) {
+
+        int32_t value = readSignedBits(16);
+
+        for (uint32_t i = 0; i < *numberOfSamples; i += 1) output[i] = value;
+
+    } else if (subframeType == 1) {
+
+        for (uint32_t i = 0; i < *numberOfSamples; i += 1) output[i] = readSignedBits(16);
+
+    } else if (subframeType >= 8 && subframeType <= 12) {
+
+        uint32_t order = subframeType - 8;
+
+        for (uint32_t i = 0; i < order; i += 1) residual[i] = readSignedBits(16);
+
+        if (decodeResidual(residual, *numberOfSamples, order) == false) return false;
+
+        static const int32_t coefficients[5][4] = {{0}, {1}, {2, -1}, {3, -3, 1}, {4, -6, 4, -1}};
+
+        int32_t x[FLAC_BLOCK_SIZE];
+
+        for (uint32_t i = 0; i < *numberOfSamples; i += 1) {
+
+            int32_t prediction = 0;
+
+            for (uint32_t k = 0; k < order && i >= order; k += 1) prediction += coefficients[order][k] * x[i - k - 1];
+
+            x[i] = residual[i] + prediction;
+
+            CHECK(x[i] >= INT16_MIN && x[i] <= INT16_MAX, "Frame %u sample %u out of range", frameNumber, i);
+
+            output[i] = x[i];
+
+        }
+
+    } else {
+
+        CHECK(false, "Frame %u subframe type %u", frameNumber, subframeType);
+
+    }
+
+    /* Check the byte alignment padding and the frame CRC */
+
+    while (readBitOffset % 8) CHECK(readBits(1) == 0, "Frame %u alignment padding", frameNumber);
+
+    uint32_t crc16 = calculateCRC(stream + frameStart, readBitOffset / 8 - frameStart, 0x8005, 16);
+
+    CHECK(readBits(16) == crc16, "Frame %u CRC-16", frameNumber);
+
+    return true;
+
+}
+
+/* Decode the whole stream and compare it with the source */
+
+static bool decodeStream(const testCase_t *testCase, uint32_t streamSize) {
+
+    uint32_t minimumFrameSize = 0, maximumFrameSize = 0;
+
+    if (decodeHeader(testCase->numberOfSamples, &minimumFrameSize, &maximumFrameSize) == false) return false;
+
+    uint32_t frameNumber = 0;
+
+    uint32_t sampleIndex = 0;
+
+    uint32_t smallestFrame = UINT32_MAX, largestFrame = 0;
+
+    while (readBitOffset / 8 < streamSize) {
+
+        uint32_t frameStart = readBitOffset / 8;
+
+        uint32_t numberOfSamples;
+
+        CHECK(sampleIndex < testCase->numberOfSamples, "Stream continues past the last sample");
+
+        if (decodeFrame(frameNumber, decoded + sampleIndex, &numberOfSamples) == false) return false;
+
+        CHECK(numberOfSamples == MIN(FLAC_BLOCK_SIZE, testCase->numberOfSamples - sampleIndex), "Frame %u has %u samples", frameNumber, numberOfSamples);
+
+        uint32_t frameSize = readBitOffset / 8 - frameStart;
+
+        smallestFrame = MIN(smallestFrame, frameSize);
+
+        largestFrame = MAX(largestFrame, frameSize);
+
+        sampleIndex += numberOfSamples;
+
+        frameNumber += 1;
+
+    }
+
+    CHECK(readBitOffset / 8 == streamSize, "Stream overruns by %u bytes", readBitOffset / 8 - streamSize);
+
+    CHECK(sampleIndex == testCase->numberOfSamples, "Decoded %u of %u samples", sampleIndex, testCase->numberOfSamples);
+
+    CHECK(smallestFrame == minimumFrameSize && largestFrame == maximumFrameSize, "Frame sizes %u to %u reported as %u to %u", smallestFrame, largestFrame, minimumFrameSize, maximumFrameSize);
+
+    for (uint32_t i = 0; i < testCase->numberOfSamples; i += 1) {
+
+        CHECK(decoded[i] == source[i], "Sample %u decoded as %d instead of %d", i, decoded[i], source[i]);
+
+    }
+
+    return true;
+
+}
+
+int main(int argc, char **argv) {
+
+    uint32_t failures = 0;
+
+    printf("Host encoding cost and compressed size relative to 16-bit PCM. The cost is measured on this host and does not represent the device\n\n");
+
+    printf("%-28s %10s %13s %10s %8s\n", "Signal", "Samples", "Cycles/sample", "ns/sample", "Ratio");
+
+    for (uint32_t i = 0; i < NUMBER_OF_TEST_CASES; i += 1) {
+
+        const testCase_t *testCase = testCases + i;
+
+        generateSamples(testCase);
+
+        double seconds;
+
+        uint64_t cycles;
+
+        uint32_t streamSize = encodeStream(testCase, &seconds, &cycles);
+
+        double ratio = (double)(streamSize - FLAC_HEADER_SIZE) / (double)(2 * testCase->numberOfSamples);
+
+        printf("%-28s %10u %13.1f %10.2f %8.3f", testCase->name, testCase->numberOfSamples, (double)cycles / (double)testCase->numberOfSamples, seconds * NANOSECONDS_IN_SECOND / (double)testCase->numberOfSamples, ratio);
+
+        bool passed = decodeStream(testCase, streamSize);
+
+        printf("%s\n", passed ? "" : " FAIL");
+
+        if (passed == false) failures += 1;
+
+    }
+
+    printf("\n%s\n", failures == 0 ? "PASS" : "FAIL");
+
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+
+}
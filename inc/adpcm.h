@@ -0,0 +1,30 @@
+/****************************************************************************
+ * adpcm.h
+ * openacousticdevices.info
+ * October 2026
+ *****************************************************************************/
+
+#ifndef __ADPCM_H
+#define __ADPCM_H
+
+#include <stdint.h>
+
+/* IMA-ADPCM block constants */
+
+#define ADPCM_BLOCK_SIZE                512
+
+#define ADPCM_SAMPLES_PER_BLOCK         (1 + 2 * (ADPCM_BLOCK_SIZE - 4))
+
+/* Start a new mono stream */
+
+void ADPCM_initialise();
+
+/* Encode samples until the current block is complete or the source is exhausted. A NULL source encodes silence. Returns the number of samples consumed and sets block to the completed block, or NULL if the block is still incomplete */
+
+uint32_t ADPCM_encode(int16_t *source, uint32_t numberOfSamples, uint8_t **block);
+
+/* Complete any partial block at the end of the stream. Returns NULL if there is no partial block */
+
+uint8_t* ADPCM_flush(uint32_t *blockSize);
+
+#endif /* __ADPCM_H */
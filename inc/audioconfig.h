@@ -7,6 +7,9 @@
 #ifndef __AUDIOCONFIG_H
 #define __AUDIOCONFIG_H
 
+#include <stdint.h>
+#include <stdbool.h>
+
 typedef enum {AC_EVENT_PULSE, AC_EVENT_START, AC_EVENT_BYTE, AC_EVENT_BIT_ERROR, AC_EVENT_CRC_ERROR} AC_audioConfigurationEvent_t;
 
 extern void AudioConfig_handleAudioConfigurationEvent(AC_audioConfigurationEvent_t event);
@@ -23,4 +26,6 @@ bool AudioConfig_listenForAudioConfigurationPackets(bool timeout, uint32_t milli
 
 void AudioConfig_cancelAudioConfiguration(void);
 
+bool AudioConfig_handleDirectMemoryAccessInterrupt(bool isPrimaryBuffer, int16_t **nextBuffer);
+
 #endif /* __AUDIOCONFIG_H */
@@ -22,8 +22,12 @@ bool DigitalFilter_applyFilter(int16_t *source, int16_t *dest, uint32_t sampleRa
 
 bool DigitalFilter_applyFrequencyTrigger(int16_t *source, uint32_t size);
 
+bool DigitalFilter_applySpectralTrigger(int16_t *source, uint32_t size);
+
 /* Design filters */
 
+void DigitalFilter_setFilterOrder(uint32_t order);
+
 void DigitalFilter_designHighPassFilter(uint32_t sampleRate, uint32_t freq);
 
 void DigitalFilter_designBandPassFilter(uint32_t sampleRate, uint32_t freq1, uint32_t freq2);
@@ -32,12 +36,28 @@ void DigitalFilter_designBandPassFilter(uint32_t sampleRate, uint32_t freq1, uin
 
 void DigitalFilter_setAdditionalGain(float gain);
 
+void DigitalFilter_setFixedPointArithmetic(bool enabled);
+
+void DigitalFilter_setDecimationFilter(uint32_t sampleRateDivider);
+
 void DigitalFilter_setAmplitudeThreshold(uint16_t amplitudeThreshold);
 
+void DigitalFilter_setAdaptiveAmplitudeThreshold(uint32_t blocksPerSecond, float marginDecibels);
+
 void DigitalFilter_setFrequencyTrigger(uint32_t windowLength, uint32_t sampleRate, uint32_t frequency, float percentageThreshold);
 
+void DigitalFilter_addFrequencyTrigger(uint32_t sampleRate, uint32_t frequency, float percentageThreshold);
+
+void DigitalFilter_setTriggerHysteresis(float decibels);
+
+void DigitalFilter_setTriggerActive(bool active);
+
+void DigitalFilter_setSpectralTrigger(uint32_t windowLength, uint32_t sampleRate, uint32_t lowerFrequency, uint32_t higherFrequency, float ratioDecibels);
+
 /* Read back filter setting */
 
+uint32_t DigitalFilter_getDecimationFilterLength(uint32_t sampleRateDivider);
+
 void DigitalFilter_readSettings(float *gain, float *yc0, float *yc1, DF_filterType_t *filterType);
 
 #endif /* __DIGITAL_FILTER_H */
@@ -0,0 +1,16 @@
+/****************************************************************************
+ * fft.h
+ * openacousticdevices.info
+ * October 2026
+ *****************************************************************************/
+
+#ifndef __FFT_H
+#define __FFT_H
+
+#include <stdint.h>
+
+/* In-place forward transform of a real sequence whose length is a power of two. On return data[0] holds the DC term, data[1] the Nyquist term and data[2k] and data[2k + 1] the real and imaginary parts of bin k */
+
+void FFT_realTransform(float *data, uint32_t length);
+
+#endif /* __FFT_H */
@@ -0,0 +1,32 @@
+/****************************************************************************
+ * flac.h
+ * openacousticdevices.info
+ * October 2026
+ *****************************************************************************/
+
+#ifndef __FLAC_H
+#define __FLAC_H
+
+#include <stdint.h>
+
+/* FLAC stream constants */
+
+#define FLAC_BLOCK_SIZE                 1024
+
+#define FLAC_HEADER_SIZE                1024
+
+/* Start a new mono 16-bit stream */
+
+void FLAC_initialise(uint32_t sampleRate);
+
+/* Encode up to FLAC_BLOCK_SIZE samples as a single frame. Only the last frame of the stream may be shorter. The frame is returned in a static buffer which is valid until the next call */
+
+uint8_t* FLAC_encodeFrame(int16_t *source, uint32_t numberOfSamples, uint32_t *frameSize);
+
+uint8_t* FLAC_encodeSilentFrame(uint32_t numberOfSamples, uint32_t *frameSize);
+
+/* Generate the stream marker and metadata blocks padded to FLAC_HEADER_SIZE bytes using the current stream statistics */
+
+uint8_t* FLAC_encodeHeader(char *artist, char *comment);
+
+#endif /* __FLAC_H */
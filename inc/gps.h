@@ -7,6 +7,7 @@
 #ifndef __GPS_H
 #define __GPS_H
 
+#include <stdint.h>
 #include <stdbool.h>
 
 /* GPS constant */
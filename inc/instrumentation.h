@@ -0,0 +1,50 @@
+/****************************************************************************
+ * instrumentation.h
+ * openacousticdevices.info
+ * October 2026
+ *****************************************************************************/
+
+#ifndef __INSTRUMENTATION_H
+#define __INSTRUMENTATION_H
+
+#include <stdint.h>
+
+/* Instrumented sections. All are measured in processor cycles except sleep, which is measured in milliseconds as the cycle counter halts while the core sleeps */
+
+typedef enum {INSTRUMENTATION_DMA_INTERRUPT, INSTRUMENTATION_FILTER, INSTRUMENTATION_TRIGGER, INSTRUMENTATION_SD_WRITE, INSTRUMENTATION_SLEEP, NUMBER_OF_INSTRUMENTATION_SECTIONS} AM_instrumentationSection_t;
+
+/* Instrumentation is compiled out unless ENABLE_INSTRUMENTATION is defined */
+
+#ifdef ENABLE_INSTRUMENTATION
+
+/* Enable the cycle counter and clear the counters for every section */
+
+void Instrumentation_reset();
+
+/* Read the cycle counter */
+
+uint32_t Instrumentation_getCycles();
+
+/* Add a single measurement to a section */
+
+void Instrumentation_addMeasurement(AM_instrumentationSection_t section, uint32_t value);
+
+/* Write the minimum, mean and maximum for each section as text and return the number of characters written */
+
+uint32_t Instrumentation_writeSummary(char *buffer, char *separator);
+
+/* Macros to time a section of code */
+
+#define INSTRUMENTATION_START(start)                 uint32_t start = Instrumentation_getCycles()
+
+#define INSTRUMENTATION_STOP(section, start)         Instrumentation_addMeasurement(section, Instrumentation_getCycles() - start)
+
+#else
+
+#define INSTRUMENTATION_START(start)
+
+#define INSTRUMENTATION_STOP(section, start)
+
+#endif
+
+#endif /* __INSTRUMENTATION_H */
@@ -0,0 +1,209 @@
+/****************************************************************************
+ * adpcm.c
+ * openacousticdevices.info
+ * October 2026
+ *****************************************************************************/
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "adpcm.h"
+
+/* Block header constant */
+
+#define BLOCK_HEADER_SIZE               4
+
+/* Useful macros */
+
+#define MIN(a, b)                       ((a) < (b) ? (a) : (b))
+
+/* IMA-ADPCM tables */
+
+static const int16_t stepSizeTable[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17,
+    19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118,
+    130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+    337, 371, 408, 449, 494, 544, 598, 658, 724, 796,
+    876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+    2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358,
+    5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+static const int8_t indexTable[8] = {-1, -1, -1, -1, 2, 4, 6, 8};
+
+/* Encoder state */
+
+static int32_t predictedSample;
+
+static int32_t stepIndex;
+
+/* Block variables */
+
+static uint8_t blockBuffer[ADPCM_BLOCK_SIZE];
+
+static uint32_t numberOfSamplesInBlock;
+
+/* Encode a single sample as a four bit code and update the predictor */
+
+static inline uint8_t encodeSample(int32_t sample) {
+
+    int32_t step = stepSizeTable[stepIndex];
+
+    int32_t difference = sample - predictedSample;
+
+    uint8_t code = 0;
+
+    if (difference < 0) {
+
+        code = 8;
+
+        difference = -difference;
+
+    }
+
+    /* Quantise the difference and reconstruct it exactly as the decoder will */
+
+    int32_t reconstructedDifference = step >> 3;
+
+    if (difference >= step) {
+
+        code |= 4;
+
+        difference -= step;
+
+        reconstructedDifference += step;
+
+    }
+
+    step >>= 1;
+
+    if (difference >= step) {
+
+        code |= 2;
+
+        difference -= step;
+
+        reconstructedDifference += step;
+
+    }
+
+    step >>= 1;
+
+    if (difference >= step) {
+
+        code |= 1;
+
+        reconstructedDifference += step;
+
+    }
+
+    predictedSample += code & 8 ? -reconstructedDifference : reconstructedDifference;
+
+    if (predictedSample > INT16_MAX) predictedSample = INT16_MAX;
+
+    if (predictedSample < INT16_MIN) predictedSample = INT16_MIN;
+
+    stepIndex += indexTable[code & 7];
+
+    if (stepIndex < 0) stepIndex = 0;
+
+    if (stepIndex > 88) stepIndex = 88;
+
+    return code;
+
+}
+
+/* Public functions */
+
+void ADPCM_initialise() {
+
+    predictedSample = 0;
+
+    stepIndex = 0;
+
+    numberOfSamplesInBlock = 0;
+
+}
+
+uint32_t ADPCM_encode(int16_t *source, uint32_t numberOfSamples, uint8_t **block) {
+
+    uint32_t index = 0;
+
+    *block = NULL;
+
+    if (numberOfSamples == 0) return 0;
+
+    /* Start a new block with the first sample and current step index in the header */
+
+    if (numberOfSamplesInBlock == 0) {
+
+        predictedSample = source ? source[0] : 0;
+
+        blockBuffer[0] = predictedSample & 0xFF;
+        blockBuffer[1] = (predictedSample >> 8) & 0xFF;
+        blockBuffer[2] = stepIndex;
+        blockBuffer[3] = 0;
+
+        numberOfSamplesInBlock = 1;
+
+        index = 1;
+
+    }
+
+    /* Encode pairs of samples into bytes with the earlier sample in the low nibble */
+
+    uint32_t numberOfSamplesToEncode = MIN(numberOfSamples - index, ADPCM_SAMPLES_PER_BLOCK - numberOfSamplesInBlock);
+
+    uint8_t *destination = blockBuffer + BLOCK_HEADER_SIZE + (numberOfSamplesInBlock - 1) / 2;
+
+    for (uint32_t i = 0; i < numberOfSamplesToEncode; i += 1) {
+
+        uint8_t code = encodeSample(source ? source[index + i] : 0);
+
+        if ((numberOfSamplesInBlock + i) & 1) {
+
+            *destination = code;
+
+        } else {
+
+            *destination++ |= code << 4;
+
+        }
+
+    }
+
+    numberOfSamplesInBlock += numberOfSamplesToEncode;
+
+    if (numberOfSamplesInBlock == ADPCM_SAMPLES_PER_BLOCK) {
+
+        numberOfSamplesInBlock = 0;
+
+        *block = blockBuffer;
+
+    }
+
+    return index + numberOfSamplesToEncode;
+
+}
+
+uint8_t* ADPCM_flush(uint32_t *blockSize) {
+
+    if (numberOfSamplesInBlock == 0) return NULL;
+
+    /* Round up to an even number of bytes to keep the RIFF chunk aligned */
+
+    uint32_t numberOfBytes = BLOCK_HEADER_SIZE + numberOfSamplesInBlock / 2;
+
+    numberOfBytes += numberOfBytes & 1;
+
+    for (uint32_t i = BLOCK_HEADER_SIZE + numberOfSamplesInBlock / 2; i < numberOfBytes; i += 1) blockBuffer[i] = 0;
+
+    numberOfSamplesInBlock = 0;
+
+    *blockSize = numberOfBytes;
+
+    return blockBuffer;
+
+}
@@ -26,6 +26,9 @@
 
 #define PULSE_INTERVAL                      4096
 
+#define CONFIG_DMA_BLOCK_SIZE               256
+#define CONFIG_NUMBER_OF_DMA_BUFFERS        4
+
 #define MAXIMUM_NUMBER_OF_BYTES             23
 #define RECEIVE_BUFFER_SIZE_IN_BYTES        23
 
@@ -162,9 +165,15 @@ static float omegaT = 0.0f;
 
 static volatile bool cancel;
 
-static volatile int16_t configSample;
+/* DMA variables. The difference between the completed and processed counts is the number of blocks waiting to be demodulated */
+
+static volatile bool listening;
+
+static int16_t dmaBuffers[CONFIG_NUMBER_OF_DMA_BUFFERS][CONFIG_DMA_BLOCK_SIZE];
+
+static volatile uint32_t numberOfCompletedBlocks;
 
-static volatile bool configSampleReady;
+static uint32_t numberOfProcessedBlocks;
 
 STATIC_UBUF(receivedBytes, RECEIVE_BUFFER_SIZE_IN_BYTES);
 
@@ -174,46 +183,51 @@ typedef enum {IDLE, START_BITS, DATA_BITS, DATA_OR_STOP_BITS} state_t;
 
 typedef enum {NONE, HIGH_BIT, LOW_BIT} receivedBit_t;
 
-/* CRC functions */
-
-static inline uint16_t updateCRC(uint16_t crc_in, int incr) {
-
-    uint16_t xor = crc_in >> 15;
-    uint16_t out = crc_in << 1;
-
-    if (incr) {
-        out++;
-    }
-
-    if (xor) {
-        out ^= CRC_POLY;
-    }
-
-    return out;
-
-}
-
-static inline uint16_t calculateCRC(const uint8_t *data, uint32_t size) {
-
-    uint16_t crc, i;
-
-    for (crc = 0; size > 0; size--, data++) {
-        for (i = 0x80; i; i >>= 1) {
-            crc = updateCRC(crc, *data & i);
-        }
-    }
-
-    for (i = 0; i < 16; i++) {
-        crc = updateCRC(crc, 0);
-    }
-
-    return crc;
+/* CRC-16 table for polynomial CRC_POLY */
+
+static const uint16_t crcTable[256] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+    0x1231, 0x0210, 0x3273, 0x2252, 0x52B5, 0x4294, 0x72F7, 0x62D6,
+    0x9339, 0x8318, 0xB37B, 0xA35A, 0xD3BD, 0xC39C, 0xF3FF, 0xE3DE,
+    0x2462, 0x3443, 0x0420, 0x1401, 0x64E6, 0x74C7, 0x44A4, 0x5485,
+    0xA56A, 0xB54B, 0x8528, 0x9509, 0xE5EE, 0xF5CF, 0xC5AC, 0xD58D,
+    0x3653, 0x2672, 0x1611, 0x0630, 0x76D7, 0x66F6, 0x5695, 0x46B4,
+    0xB75B, 0xA77A, 0x9719, 0x8738, 0xF7DF, 0xE7FE, 0xD79D, 0xC7BC,
+    0x48C4, 0x58E5, 0x6886, 0x78A7, 0x0840, 0x1861, 0x2802, 0x3823,
+    0xC9CC, 0xD9ED, 0xE98E, 0xF9AF, 0x8948, 0x9969, 0xA90A, 0xB92B,
+    0x5AF5, 0x4AD4, 0x7AB7, 0x6A96, 0x1A71, 0x0A50, 0x3A33, 0x2A12,
+    0xDBFD, 0xCBDC, 0xFBBF, 0xEB9E, 0x9B79, 0x8B58, 0xBB3B, 0xAB1A,
+    0x6CA6, 0x7C87, 0x4CE4, 0x5CC5, 0x2C22, 0x3C03, 0x0C60, 0x1C41,
+    0xEDAE, 0xFD8F, 0xCDEC, 0xDDCD, 0xAD2A, 0xBD0B, 0x8D68, 0x9D49,
+    0x7E97, 0x6EB6, 0x5ED5, 0x4EF4, 0x3E13, 0x2E32, 0x1E51, 0x0E70,
+    0xFF9F, 0xEFBE, 0xDFDD, 0xCFFC, 0xBF1B, 0xAF3A, 0x9F59, 0x8F78,
+    0x9188, 0x81A9, 0xB1CA, 0xA1EB, 0xD10C, 0xC12D, 0xF14E, 0xE16F,
+    0x1080, 0x00A1, 0x30C2, 0x20E3, 0x5004, 0x4025, 0x7046, 0x6067,
+    0x83B9, 0x9398, 0xA3FB, 0xB3DA, 0xC33D, 0xD31C, 0xE37F, 0xF35E,
+    0x02B1, 0x1290, 0x22F3, 0x32D2, 0x4235, 0x5214, 0x6277, 0x7256,
+    0xB5EA, 0xA5CB, 0x95A8, 0x8589, 0xF56E, 0xE54F, 0xD52C, 0xC50D,
+    0x34E2, 0x24C3, 0x14A0, 0x0481, 0x7466, 0x6447, 0x5424, 0x4405,
+    0xA7DB, 0xB7FA, 0x8799, 0x97B8, 0xE75F, 0xF77E, 0xC71D, 0xD73C,
+    0x26D3, 0x36F2, 0x0691, 0x16B0, 0x6657, 0x7676, 0x4615, 0x5634,
+    0xD94C, 0xC96D, 0xF90E, 0xE92F, 0x99C8, 0x89E9, 0xB98A, 0xA9AB,
+    0x5844, 0x4865, 0x7806, 0x6827, 0x18C0, 0x08E1, 0x3882, 0x28A3,
+    0xCB7D, 0xDB5C, 0xEB3F, 0xFB1E, 0x8BF9, 0x9BD8, 0xABBB, 0xBB9A,
+    0x4A75, 0x5A54, 0x6A37, 0x7A16, 0x0AF1, 0x1AD0, 0x2AB3, 0x3A92,
+    0xFD2E, 0xED0F, 0xDD6C, 0xCD4D, 0xBDAA, 0xAD8B, 0x9DE8, 0x8DC9,
+    0x7C26, 0x6C07, 0x5C64, 0x4C45, 0x3CA2, 0x2C83, 0x1CE0, 0x0CC1,
+    0xEF1F, 0xFF3E, 0xCF5D, 0xDF7C, 0xAF9B, 0xBFBA, 0x8FD9, 0x9FF8,
+    0x6E17, 0x7E36, 0x4E55, 0x5E74, 0x2E93, 0x3EB2, 0x0ED1, 0x1EF0};
+
+/* CRC functions. The CRC is updated as each byte arrives but runs two bytes behind so that it always excludes the final two CRC bytes */
+
+static inline uint16_t updateCRC(uint16_t crc, uint8_t byte) {
+
+    return (crc << 8) ^ crcTable[(crc >> 8) ^ byte];
 
 }
 
-static inline bool checkCRC(const uint8_t *data, uint32_t size) {
-
-    uint16_t crc = calculateCRC(data, size - CRC_SIZE_IN_BYTES);
+static inline bool checkCRC(uint16_t crc, const uint8_t *data, uint32_t size) {
 
     uint8_t low = crc & 0xFF;
     uint8_t high = crc >> 8;
@@ -270,13 +284,53 @@ static inline float updateCostasLoop(float sample) {
 
 }
 
-/* Handle AudioMoth microphone interrupt */
+/* Handle AudioMoth microphone interrupt. Samples now arrive in blocks by DMA */
+
+inline void AudioMoth_handleMicrophoneInterrupt(int16_t sample) { }
+
+/* Handle DMA transfers while listening */
 
-inline void AudioMoth_handleMicrophoneInterrupt(int16_t sample) {
+bool AudioConfig_handleDirectMemoryAccessInterrupt(bool isPrimaryBuffer, int16_t **nextBuffer) {
 
-    configSampleReady = true;
+    if (listening == false) return false;
 
-    configSample = sample;
+    /* The ping-pong descriptor which has just completed is reloaded with the buffer two ahead in the ring */
+
+    *nextBuffer = dmaBuffers[(numberOfCompletedBlocks + 2) & (CONFIG_NUMBER_OF_DMA_BUFFERS - 1)];
+
+    numberOfCompletedBlocks += 1;
+
+    return true;
+
+}
+
+/* Sleep until the next block of samples is ready, returning NULL if cancelled */
+
+static int16_t* waitForNextBlock() {
+
+    while (cancel == false) {
+
+        uint32_t numberOfWaitingBlocks = numberOfCompletedBlocks - numberOfProcessedBlocks;
+
+        if (numberOfWaitingBlocks > 0) {
+
+            /* Skip any blocks which the DMA has already started to overwrite */
+
+            if (numberOfWaitingBlocks > CONFIG_NUMBER_OF_DMA_BUFFERS - 2) numberOfProcessedBlocks = numberOfCompletedBlocks - (CONFIG_NUMBER_OF_DMA_BUFFERS - 2);
+
+            int16_t *block = dmaBuffers[numberOfProcessedBlocks & (CONFIG_NUMBER_OF_DMA_BUFFERS - 1)];
+
+            numberOfProcessedBlocks += 1;
+
+            return block;
+
+        }
+
+        AudioMoth_sleep();
+
+    }
+
+    return NULL;
 
 }
 
@@ -288,7 +342,13 @@ void AudioConfig_enableAudioConfiguration() {
 
     AudioMoth_enableMicrophone(CONFIG_GAIN_RANGE, CONFIG_GAIN, CONFIG_CLOCK_DIVIDER, CONFIG_ACQUISITION_CYCLES, CONFIG_OVERSAMPLE_RATE);
 
-    AudioMoth_initialiseMicrophoneInterrupts();
+    numberOfCompletedBlocks = 0;
+
+    numberOfProcessedBlocks = 0;
+
+    listening = true;
+
+    AudioMoth_initialiseDirectMemoryAccess(dmaBuffers[0], dmaBuffers[1], CONFIG_DMA_BLOCK_SIZE);
 
     /* Design filters */
 
@@ -318,6 +378,8 @@ void AudioConfig_disableAudioConfiguration() {
 
     AudioMoth_disableMicrophone();
 
+    listening = false;
+
 }
 
 bool AudioConfig_listenForAudioConfigurationTone(uint32_t milliseconds) {
@@ -326,8 +388,6 @@ bool AudioConfig_listenForAudioConfigurationTone(uint32_t milliseconds) {
 
     cancel = false;
 
-    configSampleReady = false;
-
     /* Zero crossing variables */
 
     float lastValue = 0.0f;
@@ -350,11 +410,17 @@ bool AudioConfig_listenForAudioConfigurationTone(uint32_t milliseconds) {
 
     while (cancel == false && counter < maximumCounter) {
 
-        if (configSampleReady) {
+        /* Wait for the next block of samples */
+
+        int16_t *block = waitForNextBlock();
+
+        if (block == NULL) break;
+
+        for (uint32_t i = 0; i < CONFIG_DMA_BLOCK_SIZE; i += 1) {
 
             /* Update the Costas loop with new sample */
 
-            float sample = (float)configSample;
+            float sample = (float)block[i];
 
             if (hasInvertedOutput) sample = -sample;
 
@@ -390,8 +456,6 @@ bool AudioConfig_listenForAudioConfigurationTone(uint32_t milliseconds) {
 
             lastValue = costasLoopOutput;
 
-            configSampleReady = false;
-
             counter += 1;
 
         }
@@ -408,8 +472,6 @@ bool AudioConfig_listenForAudioConfigurationPackets(bool timeout, uint32_t milli
 
     cancel = false;
 
-    configSampleReady = false;
-
     /* Zero crossing variables */
 
     float lastValue = 0.0f;
@@ -422,6 +484,8 @@ bool AudioConfig_listenForAudioConfigurationPackets(bool timeout, uint32_t milli
 
     uint32_t byteCount = 0;
 
+    uint16_t crc = 0;
+
     uint8_t receivedByte = 0;
 
     state_t state = IDLE;
@@ -436,7 +500,13 @@ bool AudioConfig_listenForAudioConfigurationPackets(bool timeout, uint32_t milli
 
     while (cancel == false && (timeout == false || counter < maximumCounter)) {
 
-        if (configSampleReady) {
+        /* Wait for the next block of samples */
+
+        int16_t *block = waitForNextBlock();
+
+        if (block == NULL) break;
+
+        for (uint32_t i = 0; i < CONFIG_DMA_BLOCK_SIZE; i += 1) {
 
             /* Call pulse handler */
 
@@ -444,7 +514,7 @@ bool AudioConfig_listenForAudioConfigurationPackets(bool timeout, uint32_t milli
 
             /* Update the Costas loop with new sample */
 
-            float costasLoopOutput = updateCostasLoop((float)configSample);
+            float costasLoopOutput = updateCostasLoop((float)block[i]);
 
             /* Check thresholds */
 
@@ -484,6 +554,8 @@ bool AudioConfig_listenForAudioConfigurationPackets(bool timeout, uint32_t milli
 
                             byteCount = 0;
 
+                            crc = 0;
+
                             bitCount = 0;
 
                         } else {
@@ -538,7 +610,7 @@ bool AudioConfig_listenForAudioConfigurationPackets(bool timeout, uint32_t milli
 
                         if (bitCount == MIN_NUMBER_OF_START_STOP_PERIODS && state == DATA_OR_STOP_BITS && byteCount > CRC_SIZE_IN_BYTES) {
 
-                            if (checkCRC(receivedBytes, byteCount)) {
+                            if (checkCRC(crc, receivedBytes, byteCount)) {
 
                                 AudioConfig_handleAudioConfigurationPacket(receivedBytes, byteCount - CRC_SIZE_IN_BYTES);
 
@@ -572,11 +644,15 @@ bool AudioConfig_listenForAudioConfigurationPackets(bool timeout, uint32_t milli
 
                             byteCount += 1;
 
+                            /* Update the CRC with the byte received two bytes earlier */
+
+                            if (byteCount > CRC_SIZE_IN_BYTES) crc = updateCRC(crc, receivedBytes[byteCount - CRC_SIZE_IN_BYTES - 1]);
+
                             /* Check the CRC if all bytes have been received */
 
                             if (byteCount == MAXIMUM_NUMBER_OF_BYTES) {
 
-                                if (checkCRC(receivedBytes, MAXIMUM_NUMBER_OF_BYTES)) {
+                                if (checkCRC(crc, receivedBytes, MAXIMUM_NUMBER_OF_BYTES)) {
 
                                     AudioConfig_handleAudioConfigurationPacket(receivedBytes, MAXIMUM_NUMBER_OF_BYTES - CRC_SIZE_IN_BYTES);
 
@@ -624,8 +700,6 @@ bool AudioConfig_listenForAudioConfigurationPackets(bool timeout, uint32_t milli
 
             lastValue = costasLoopOutput;
 
-            configSampleReady = false;
-
             counter += 1;
 
         }
@@ -6,11 +6,13 @@
 
 #include <math.h>
 #include <float.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
 #include <complex.h>
 
 #include "digitalfilter.h"
+#include "fft.h"
 
 /* Filter design constants */
 
@@ -24,14 +26,47 @@
 
 #define MAX_POLES                               2
 
+#define MAXIMUM_NUMBER_OF_SECTIONS              4
+
 /* Goertzel filter constants */
 
 #define MAXIMUM_HAMMING_WINDOW_LENGTH           1024
 
+#define MAXIMUM_NUMBER_OF_GOERTZEL_FILTERS      8
+
 #define MINIMUM_NUMBER_OF_ITERATIONS            16
 
+/* Adaptive amplitude threshold constants */
+
+#define NOISE_FLOOR_ATTACK_TIME                 10.0f
+
+#define NOISE_FLOOR_RELEASE_TIME                0.5f
+
+#define MINIMUM_NOISE_FLOOR                     1.0f
+
+/* Fixed-point constants */
+
+#define FIXED_POINT_GAIN_SHIFT                  26
+
+#define FIXED_POINT_SIGNAL_SHIFT                14
+
+#define FIXED_POINT_COEFFICIENT_SHIFT           30
+
+#define FIXED_POINT_WINDOW_SHIFT                15
+
+/* Decimation filter constants */
+
+#define DECIMATION_FILTER_TAPS_PER_PHASE        8
+
+#define MAXIMUM_DECIMATION_FILTER_DIVIDER       48
+
+#define MAXIMUM_DECIMATION_FILTER_LENGTH        (DECIMATION_FILTER_TAPS_PER_PHASE * MAXIMUM_DECIMATION_FILTER_DIVIDER)
+
+#define DECIMATION_FILTER_COEFFICIENT_SHIFT     15
+
 /* Useful macros */
 
+#define ABS(a)                                  ((a) < (0) ? (-(a)) : (a))
 #define MIN(a, b)                               ((a) < (b) ? (a) : (b))
 #define MAX(a, b)                               ((a) > (b) ? (a) : (b))
 
@@ -39,476 +74,1377 @@
 
 static float gain;
 
-static float yc0, yc1;
+static float yc0, yc1;
+
+static float state1, state2;
+
+DF_filterType_t filterType;
+
+/* Fixed-point filter variables */
+
+static bool fixedPointArithmetic;
+
+static int32_t fixedPointGain;
+
+static int32_t fixedPointYc0, fixedPointYc1;
+
+static int32_t fixedPointState1, fixedPointState2;
+
+/* Cascaded filter variables */
+
+typedef struct {
+    float b0, b1, b2;
+    float a1, a2;
+} DF_filterSection_t;
+
+static uint32_t filterOrder;
+
+static uint32_t numberOfSections;
+
+static DF_filterSection_t sections[MAXIMUM_NUMBER_OF_SECTIONS];
+
+static float sectionState1[MAXIMUM_NUMBER_OF_SECTIONS];
+
+static float sectionState2[MAXIMUM_NUMBER_OF_SECTIONS];
+
+/* Filter design variables */
+
+static complex float spoles[MAX_POLES];
+static complex float szeros[MAX_POLES];
+
+static complex float zpoles[MAX_POLES];
+static complex float zzeros[MAX_POLES];
+
+static complex float topcoeffs[MAX_POLES + 1];
+static complex float botcoeffs[MAX_POLES + 1];
+
+/* Amplitude threshold variable */
+
+static uint16_t amplitudeThreshold;
+
+/* Adaptive amplitude threshold variables */
+
+static bool adaptiveAmplitudeThreshold;
+
+static float noiseFloor;
+
+static float noiseFloorMargin;
+
+static float noiseFloorAttack;
+
+static float noiseFloorRelease;
+
+/* Trigger hysteresis variables */
+
+static float releaseThresholdScale = 1.0f;
+
+static float triggerThresholdScale = 1.0f;
+
+static float squaredTriggerThresholdScale = 1.0f;
+
+/* Goertzel filter variables */
+
+static union {
+    float floatingPoint[MAXIMUM_HAMMING_WINDOW_LENGTH];
+    int16_t fixedPoint[MAXIMUM_HAMMING_WINDOW_LENGTH];
+} hammingWindow;
+
+static uint32_t goertzelFilterWindowLength;
+
+static float goertzelFilterFullScaleMagnitude;
+
+static uint32_t numberOfGoertzelFilters;
+
+static float goertzelFilterThresholds[MAXIMUM_NUMBER_OF_GOERTZEL_FILTERS];
+
+static float goertzelFilterConstants[MAXIMUM_NUMBER_OF_GOERTZEL_FILTERS];
+
+static int32_t fixedPointGoertzelFilterConstants[MAXIMUM_NUMBER_OF_GOERTZEL_FILTERS];
+
+/* Spectral trigger variables */
+
+static float spectralTriggerBuffer[MAXIMUM_HAMMING_WINDOW_LENGTH];
+
+static uint32_t spectralTriggerWindowLength;
+
+static uint32_t spectralTriggerLowerBin;
+
+static uint32_t spectralTriggerHigherBin;
+
+static float spectralTriggerRatio;
+
+/* Decimation filter coefficients for each sample rate divider. Kaiser windowed sinc (beta 5.0) with cutoff at 0.45 of the output sample rate, in Q15 with a DC gain equal to the divider to match the boxcar sum */
+
+static const int16_t decimationFilter2[16] = {
+    -94, 90, 940, 151, -3470, -2473, 10824, 26800, 26800, 10824, -2473, -3470, 151, 940, 90, -94
+};
+
+static const int16_t decimationFilter4[32] = {
+    -99, -151, -42, 320, 835, 1135, 730, -646, -2658, -4228, -3850, -300, 6568, 15417, 23731, 28774,
+    28774, 23731, 15417, 6568, -300, -3850, -4228, -2658, -646, 730, 1135, 835, 320, -42, -151, -99
+};
+
+static const int16_t decimationFilter6[48] = {
+    -97, -150, -160, -82, 113, 421, 780, 1076, 1159, 883, 163, -972, -2346, -3627, -4378, -4137,
+    -2526, 634, 5245, 10902, 16934, 22515, 26810, 29144, 29144, 26810, 22515, 16934, 10902, 5245, 634, -2526,
+    -4137, -4378, -3627, -2346, -972, 163, 883, 1159, 1076, 780, 421, 113, -82, -160, -150, -97
+};
+
+static const int16_t decimationFilter8[64] = {
+    -96, -140, -168, -162, -101, 26, 223, 474, 749, 998, 1157, 1161, 952, 491, -222, -1145,
+    -2185, -3201, -4015, -4429, -4250, -3317, -1528, 1138, 4606, 8704, 13172, 17682, 21877, 25401, 27944, 29276,
+    29276, 27944, 25401, 21877, 17682, 13172, 8704, 4606, 1138, -1528, -3317, -4250, -4429, -4015, -3201, -2185,
+    -1145, -222, 491, 952, 1161, 1157, 998, 749, 474, 223, 26, -101, -162, -168, -140, -96
+};
+
+static const int16_t decimationFilter12[96] = {
+    -95, -126, -154, -173, -178, -162, -120, -48, 56, 190, 351, 530, 717, 895, 1048, 1156,
+    1198, 1156, 1015, 762, 393, -87, -667, -1323, -2022, -2723, -3374, -3921, -4303, -4462, -4343, -3897,
+    -3088, -1891, -302, 1667, 3984, 6599, 9440, 12424, 15452, 18421, 21221, 23748, 25902, 27600, 28771, 29371,
+    29371, 28771, 27600, 25902, 23748, 21221, 18421, 15452, 12424, 9440, 6599, 3984, 1667, -302, -1891, -3088,
+    -3897, -4343, -4462, -4303, -3921, -3374, -2723, -2022, -1323, -667, -87, 393, 762, 1015, 1156, 1198,
+    1156, 1048, 895, 717, 530, 351, 190, 56, -48, -120, -162, -178, -173, -154, -126, -95
+};
+
+static const int16_t decimationFilter24[192] = {
+    -93, -109, -125, -141, -155, -167, -177, -183, -185, -182, -174, -159, -137, -108, -71, -26,
+    28, 89, 157, 233, 315, 403, 494, 588, 683, 777, 867, 952, 1030, 1097, 1151, 1190,
+    1211, 1212, 1190, 1144, 1072, 973, 844, 687, 501, 286, 43, -226, -518, -831, -1162, -1505,
+    -1858, -2213, -2565, -2909, -3236, -3541, -3815, -4052, -4244, -4384, -4464, -4477, -4417, -4278, -4054, -3741,
+    -3335, -2832, -2233, -1534, -738, 155, 1142, 2219, 3380, 4619, 5928, 7299, 8721, 10185, 11679, 13190,
+    14705, 16213, 17698, 19148, 20549, 21888, 23152, 24329, 25406, 26375, 27224, 27945, 28531, 28975, 29275, 29423,
+    29423, 29275, 28975, 28531, 27945, 27224, 26375, 25406, 24329, 23152, 21888, 20549, 19148, 17698, 16213, 14705,
+    13190, 11679, 10185, 8721, 7299, 5928, 4619, 3380, 2219, 1142, 155, -738, -1534, -2233, -2832, -3335,
+    -3741, -4054, -4278, -4417, -4477, -4464, -4384, -4244, -4052, -3815, -3541, -3236, -2909, -2565, -2213, -1858,
+    -1505, -1162, -831, -518, -226, 43, 286, 501, 687, 844, 973, 1072, 1144, 1190, 1212, 1211,
+    1190, 1151, 1097, 1030, 952, 867, 777, 683, 588, 494, 403, 315, 233, 157, 89, 28,
+    -26, -71, -108, -137, -159, -174, -182, -185, -183, -177, -167, -155, -141, -125, -109, -93
+};
+
+static const int16_t decimationFilter48[384] = {
+    -92, -100, -108, -117, -125, -133, -141, -148, -155, -162, -168, -174, -179, -183, -186, -188,
+    -189, -188, -187, -184, -180, -174, -166, -157, -145, -132, -118, -101, -82, -61, -38, -13,
+    14, 43, 74, 106, 141, 178, 216, 256, 298, 340, 384, 430, 476, 523, 570, 618,
+    665, 713, 760, 807, 852, 897, 939, 980, 1019, 1056, 1089, 1120, 1147, 1170, 1190, 1205,
+    1215, 1221, 1221, 1216, 1205, 1188, 1165, 1135, 1099, 1056, 1005, 948, 884, 812, 733, 646,
+    553, 452, 344, 229, 107, -22, -157, -298, -445, -597, -754, -916, -1082, -1251, -1423, -1598,
+    -1775, -1953, -2131, -2308, -2485, -2660, -2832, -3000, -3165, -3323, -3476, -3622, -3759, -3888, -4006, -4114,
+    -4210, -4294, -4363, -4419, -4459, -4482, -4489, -4477, -4447, -4397, -4327, -4237, -4124, -3990, -3833, -3653,
+    -3450, -3222, -2971, -2695, -2395, -2070, -1720, -1346, -947, -524, -77, 394, 888, 1404, 1943, 2503,
+    3084, 3685, 4305, 4943, 5598, 6269, 6954, 7654, 8365, 9088, 9820, 10561, 11308, 12060, 12815, 13573,
+    14331, 15088, 15842, 16591, 17333, 18068, 18793, 19507, 20207, 20893, 21563, 22214, 22846, 23457, 24045, 24610,
+    25148, 25661, 26145, 26599, 27024, 27417, 27777, 28104, 28397, 28655, 28878, 29064, 29213, 29326, 29401, 29443,
+    29443, 29401, 29326, 29213, 29064, 28878, 28655, 28397, 28104, 27777, 27417, 27024, 26599, 26145, 25661, 25148,
+    24610, 24045, 23457, 22846, 22214, 21563, 20893, 20207, 19507, 18793, 18068, 17333, 16591, 15842, 15088, 14331,
+    13573, 12815, 12060, 11308, 10561, 9820, 9088, 8365, 7654, 6954, 6269, 5598, 4943, 4305, 3685, 3084,
+    2503, 1943, 1404, 888, 394, -77, -524, -947, -1346, -1720, -2070, -2395, -2695, -2971, -3222, -3450,
+    -3653, -3833, -3990, -4124, -4237, -4327, -4397, -4447, -4477, -4489, -4482, -4459, -4419, -4363, -4294, -4210,
+    -4114, -4006, -3888, -3759, -3622, -3476, -3323, -3165, -3000, -2832, -2660, -2485, -2308, -2131, -1953, -1775,
+    -1598, -1423, -1251, -1082, -916, -754, -597, -445, -298, -157, -22, 107, 229, 344, 452, 553,
+    646, 733, 812, 884, 948, 1005, 1056, 1099, 1135, 1165, 1188, 1205, 1216, 1221, 1221, 1215,
+    1205, 1190, 1170, 1147, 1120, 1089, 1056, 1019, 980, 939, 897, 852, 807, 760, 713, 665,
+    618, 570, 523, 476, 430, 384, 340, 298, 256, 216, 178, 141, 106, 74, 43, 14,
+    -13, -38, -61, -82, -101, -118, -132, -145, -157, -166, -174, -180, -184, -187, -188, -189,
+    -188, -186, -183, -179, -174, -168, -162, -155, -148, -141, -133, -125, -117, -108, -100, -92
+};
+
+/* Decimation filter variables */
+
+static const int16_t *decimationFilter;
+
+static uint32_t decimationFilterLength;
+
+static uint32_t decimationHistoryIndex;
+
+static int16_t decimationHistory[2 * MAXIMUM_DECIMATION_FILTER_LENGTH];
+
+/* Static filter design functions */
+
+static complex float blt(complex float pz) {
+
+    return (2.0f + pz) / (2.0f - pz);
+
+}
+
+static void expand(complex float pz[], uint32_t npz, complex float coeffs[]) {
+
+    coeffs[0] = 1.0f;
+
+    for (uint32_t i=0; i < npz; i += 1) {
+
+        coeffs[i + 1] = 0.0f;
+
+    }
+
+    for (uint32_t i=0; i < npz; i += 1) {
+
+        complex float nw = -pz[i];
+
+        for (uint32_t i = npz; i >= 1; i -= 1) {
+
+            coeffs[i] = (nw * coeffs[i]) + coeffs[i-1];
+
+        }
+
+        coeffs[0] = nw * coeffs[0];
+
+    }
+
+}
+
+static complex float eval(complex float coeffs[], int npz, complex float z) {
+
+   complex float sum = 0.0f;
+
+   for (int32_t i = npz; i >= 0; i -= 1) {
+
+       sum = (sum * z) + coeffs[i];
+
+   }
+
+   return sum;
+
+}
+
+static complex float evaluate(complex float topco[], int nz, complex float botco[], int np, complex float z) {
+
+    return eval(topco, nz, z) / eval(botco, np, z);
+
+}
+
+/* Static filter functions operating on filter state held in local variables */
+
+static inline float applyHighPassFilter(float sample, float g, float c0, float *s1) {
+
+    float x = g * sample;
+
+    float y = x + *s1;
+
+    *s1 = c0 * y - x;
+
+    return y;
+
+}
+
+static inline float applyBandPassFilter(float sample, float g, float c0, float c1, float *s1, float *s2) {
+
+    float x = g * sample;
+
+    float y = x + *s1;
+
+    *s1 = c1 * y + *s2;
+
+    *s2 = c0 * y - x;
+
+    return y;
+
+}
+
+static inline float applyOutputRangeLimits(float filterOutput) {
+
+    if (filterOutput > INT16_MAX) return INT16_MAX;
+
+    if (filterOutput < -INT16_MAX) return -INT16_MAX;
+
+    return filterOutput;
+
+}
+
+/* Goertzel filter bank functions which share each windowed sample between all target frequencies */
+
+static inline void updateGoertzelFilters(float windowedSample, float *d1, float *d2) {
+
+    for (uint32_t k = 0; k < numberOfGoertzelFilters; k += 1) {
+
+        float y = windowedSample + goertzelFilterConstants[k] * d1[k] - d2[k];
+
+        d2[k] = d1[k];
+
+        d1[k] = y;
+
+    }
+
+}
+
+static inline bool goertzelFiltersThresholdExceeded(float *d1, float *d2) {
+
+    bool exceededThreshold = false;
+
+    for (uint32_t k = 0; k < numberOfGoertzelFilters; k += 1) {
+
+        float squaredMagnitude = d1[k] * d1[k] + d2[k] * d2[k] - goertzelFilterConstants[k] * d1[k] * d2[k];
+
+        if (squaredMagnitude > squaredTriggerThresholdScale * goertzelFilterThresholds[k]) exceededThreshold = true;
+
+        d1[k] = 0.0f;
+
+        d2[k] = 0.0f;
+
+    }
+
+    return exceededThreshold;
+
+}
+
+/* Amplitude threshold function which also updates the adaptive noise floor from the peak of each DMA block */
+
+static inline bool amplitudeThresholdExceeded(float peak) {
+
+    float threshold = triggerThresholdScale * (float)amplitudeThreshold;
+
+    if (adaptiveAmplitudeThreshold == false) return peak >= threshold;
+
+    if (noiseFloor < 0.0f) noiseFloor = MAX(MINIMUM_NOISE_FLOOR, peak);
+
+    bool exceededThreshold = peak >= threshold && peak > triggerThresholdScale * noiseFloorMargin * noiseFloor;
+
+    /* Rise slowly so that events do not lift the floor and fall quickly when the background drops */
+
+    noiseFloor += (peak - noiseFloor) * (peak > noiseFloor ? noiseFloorAttack : noiseFloorRelease);
+
+    noiseFloor = MAX(MINIMUM_NOISE_FLOOR, noiseFloor);
+
+    return exceededThreshold;
+
+}
+
+/* Decimation function which only calculates output rate samples and keeps each input sample twice in a circular history so the filter window is always contiguous */
+
+static inline int32_t decimate(int16_t *source, uint32_t sampleRateDivider, uint32_t *historyIndex) {
+
+    int32_t sample = 0;
+
+    if (decimationFilter == NULL) {
+
+        for (uint32_t j = 0; j < sampleRateDivider; j += 1) {
+
+            sample += source[j];
+
+        }
+
+        return sample;
+
+    }
+
+    uint32_t index = *historyIndex;
+
+    for (uint32_t j = 0; j < sampleRateDivider; j += 1) {
+
+        decimationHistory[index] = source[j];
+
+        decimationHistory[index + decimationFilterLength] = source[j];
+
+        index += 1;
+
+        if (index == decimationFilterLength) index = 0;
+
+    }
+
+    *historyIndex = index;
+
+    int16_t *history = decimationHistory + index;
+
+    int64_t accumulator = 0;
+
+    for (uint32_t j = 0; j < decimationFilterLength; j += 1) {
+
+        accumulator += (int32_t)history[j] * decimationFilter[j];
+
+    }
+
+    return (int32_t)((accumulator + (1 << (DECIMATION_FILTER_COEFFICIENT_SHIFT - 1))) >> DECIMATION_FILTER_COEFFICIENT_SHIFT);
+
+}
+
+/* General filter routine */
+
+static bool filter(int16_t *source, int16_t *dest, uint32_t sampleRateDivider, uint32_t size) {
+
+    uint32_t index = 0;
+
+    float peak = 0.0f;
+
+    /* Load filter state and coefficients */
+
+    float s1 = state1;
+    float s2 = state2;
+
+    float g = gain;
+
+    float c0 = yc0;
+    float c1 = yc1;
+
+    uint32_t historyIndex = decimationHistoryIndex;
+
+    bool highPassFilter = filterType == DF_HIGH_PASS_FILTER;
+
+    for (uint32_t i = 0; i < size; i += sampleRateDivider) {
+
+        float sample = decimate(source + i, sampleRateDivider, &historyIndex);
+
+        float filterOutput = highPassFilter ? applyHighPassFilter(sample, g, c0, &s1) : applyBandPassFilter(sample, g, c0, c1, &s1, &s2);
+
+        filterOutput = applyOutputRangeLimits(filterOutput);
+
+        /* Track peak output for the amplitude threshold */
+
+        peak = MAX(peak, fabsf(filterOutput));
+
+        dest[index++] = (int16_t)filterOutput;
+
+    }
+
+    /* Store filter state */
+
+    state1 = s1;
+    state2 = s2;
+
+    decimationHistoryIndex = historyIndex;
+
+    return amplitudeThresholdExceeded(peak);
+
+}
+
+/* Fast filter routine for when 250kHz and 384kHz and sampleRateDivider is not needed */
+
+static bool fastFilterWithGoertzelFilterThreshold(int16_t *source, int16_t *dest, uint32_t size) {
+
+    uint32_t index = 0;
+
+    bool exceededThreshold = false;
+
+    /* Load filter state and coefficients */
+
+    float s1 = state1;
+    float s2 = state2;
+
+    float g = gain;
+
+    float c0 = yc0;
+    float c1 = yc1;
+
+    float d1[MAXIMUM_NUMBER_OF_GOERTZEL_FILTERS] = {0};
+    float d2[MAXIMUM_NUMBER_OF_GOERTZEL_FILTERS] = {0};
+
+    for (uint32_t i = 0; i < size / goertzelFilterWindowLength; i += 1) {
+
+        float *window = hammingWindow.floatingPoint;
+
+        if (filterType == DF_HIGH_PASS_FILTER) {
+
+            for (uint32_t j = 0; j < goertzelFilterWindowLength / MINIMUM_NUMBER_OF_ITERATIONS; j += 1) {
+
+                for (uint32_t n = 0; n < MINIMUM_NUMBER_OF_ITERATIONS; n += 1) {
+
+                    float filterOutput = applyOutputRangeLimits(applyHighPassFilter(source[index], g, c0, &s1));
+
+                    /* Update Goertzel filter bank */
+
+                    updateGoertzelFilters(*window++ * filterOutput, d1, d2);
+
+                    dest[index++] = (int16_t)filterOutput;
+
+                }
+
+            }
+
+        } else {
+
+            for (uint32_t j = 0; j < goertzelFilterWindowLength / MINIMUM_NUMBER_OF_ITERATIONS; j += 1) {
+
+                for (uint32_t n = 0; n < MINIMUM_NUMBER_OF_ITERATIONS; n += 1) {
+
+                    float filterOutput = applyOutputRangeLimits(applyBandPassFilter(source[index], g, c0, c1, &s1, &s2));
+
+                    /* Update Goertzel filter bank */
+
+                    updateGoertzelFilters(*window++ * filterOutput, d1, d2);
+
+                    dest[index++] = (int16_t)filterOutput;
+
+                }
+
+            }
+
+        }
+
+        if (goertzelFiltersThresholdExceeded(d1, d2)) exceededThreshold = true;
+
+    }
+
+    /* Store filter state */
+
+    state1 = s1;
+    state2 = s2;
+
+    return exceededThreshold;
+
+}
+
+static bool fastFilterWithAmplitudeThreshold(int16_t *source, int16_t *dest, uint32_t size) {
+
+    uint32_t index = 0;
+
+    float peak = 0.0f;
+
+    /* Load filter state and coefficients */
+
+    float s1 = state1;
+    float s2 = state2;
+
+    float g = gain;
+
+    float c0 = yc0;
+    float c1 = yc1;
+
+    if (filterType == DF_HIGH_PASS_FILTER) {
+
+        for (uint32_t i = 0; i < size / MINIMUM_NUMBER_OF_ITERATIONS; i += 1) {
+
+            for (uint32_t j = 0; j < MINIMUM_NUMBER_OF_ITERATIONS; j += 1) {
+
+                float filterOutput = applyOutputRangeLimits(applyHighPassFilter(source[index], g, c0, &s1));
+
+                /* Track peak output for the amplitude threshold */
+
+                peak = MAX(peak, fabsf(filterOutput));
+
+                dest[index++] = (int16_t)filterOutput;
+
+            }
+
+        }
+
+    } else {
+
+        for (uint32_t i = 0; i < size / MINIMUM_NUMBER_OF_ITERATIONS; i += 1) {
+
+            for (uint32_t j = 0; j < MINIMUM_NUMBER_OF_ITERATIONS; j += 1) {
+
+                float filterOutput = applyOutputRangeLimits(applyBandPassFilter(source[index], g, c0, c1, &s1, &s2));
+
+                /* Track peak output for the amplitude threshold */
+
+                peak = MAX(peak, fabsf(filterOutput));
+
+                dest[index++] = (int16_t)filterOutput;
+
+            }
+
+        }
+
+    }
+
+    /* Store filter state */
+
+    state1 = s1;
+    state2 = s2;
+
+    /* Check if amplitude threshold is exceeded */
+
+    return amplitudeThresholdExceeded(peak);
+
+}
+
+/* Cascaded filter routine for higher order filters */
+
+static bool cascadedFilter(int16_t *source, int16_t *dest, uint32_t sampleRateDivider, uint32_t size) {
+
+    uint32_t index = 0;
+
+    float peak = 0.0f;
+
+    bool exceededThreshold = false;
+
+    bool goertzelFilterEnabled = numberOfGoertzelFilters > 0 && sampleRateDivider == 1;
+
+    /* Load filter state */
+
+    float s1[MAXIMUM_NUMBER_OF_SECTIONS];
+    float s2[MAXIMUM_NUMBER_OF_SECTIONS];
+
+    for (uint32_t k = 0; k < numberOfSections; k += 1) {
+
+        s1[k] = sectionState1[k];
+        s2[k] = sectionState2[k];
+
+    }
+
+    uint32_t historyIndex = decimationHistoryIndex;
+
+    float d1[MAXIMUM_NUMBER_OF_GOERTZEL_FILTERS] = {0};
+    float d2[MAXIMUM_NUMBER_OF_GOERTZEL_FILTERS] = {0};
+
+    uint32_t hammingIndex = 0;
+
+    for (uint32_t i = 0; i < size; i += sampleRateDivider) {
+
+        float x = decimate(source + i, sampleRateDivider, &historyIndex);
+
+        /* Apply each second order section in turn */
+
+        for (uint32_t k = 0; k < numberOfSections; k += 1) {
+
+            DF_filterSection_t *section = sections + k;
+
+            float y = section->b0 * x + s1[k];
+
+            s1[k] = section->b1 * x - section->a1 * y + s2[k];
+
+            s2[k] = section->b2 * x - section->a2 * y;
+
+            x = y;
+
+        }
+
+        float filterOutput = applyOutputRangeLimits(x);
+
+        /* Track peak output for the amplitude threshold */
+
+        peak = MAX(peak, fabsf(filterOutput));
+
+        /* Update Goertzel filter bank */
+
+        if (goertzelFilterEnabled) {
+
+            updateGoertzelFilters(hammingWindow.floatingPoint[hammingIndex++] * filterOutput, d1, d2);
+
+            if (hammingIndex == goertzelFilterWindowLength) {
+
+                if (goertzelFiltersThresholdExceeded(d1, d2)) exceededThreshold = true;
+
+                hammingIndex = 0;
+
+            }
+
+        }
+
+        dest[index++] = (int16_t)filterOutput;
+
+    }
+
+    /* Store filter state */
+
+    for (uint32_t k = 0; k < numberOfSections; k += 1) {
+
+        sectionState1[k] = s1[k];
+        sectionState2[k] = s2[k];
+
+    }
+
+    decimationHistoryIndex = historyIndex;
+
+    return goertzelFilterEnabled ? exceededThreshold : amplitudeThresholdExceeded(peak);
+
+}
+
+/* Fixed-point arithmetic functions */
+
+static inline int32_t saturate(int64_t value) {
+
+    if (value > INT32_MAX) return INT32_MAX;
+
+    if (value < INT32_MIN) return INT32_MIN;
+
+    return (int32_t)value;
+
+}
+
+static int32_t convertToFixedPoint(float value, uint32_t shift) {
+
+    float scaledValue = roundf(value * (float)(1 << shift));
+
+    if (scaledValue >= (float)INT32_MAX) return INT32_MAX;
+
+    if (scaledValue <= (float)INT32_MIN) return INT32_MIN;
+
+    return (int32_t)scaledValue;
+
+}
+
+/* Static fixed-point filter functions with Q31 signal and state (two bits of headroom above the 16-bit output), Q5.26 gain and Q1.30 coefficients */
+
+static inline int32_t applyFixedPointHighPassFilter(int32_t sample, int32_t g, int32_t c0, int32_t *s1) {
+
+    int32_t x = saturate(((int64_t)g * sample) >> (FIXED_POINT_GAIN_SHIFT - FIXED_POINT_SIGNAL_SHIFT));
+
+    int32_t y = saturate((int64_t)x + *s1);
+
+    *s1 = saturate((((int64_t)c0 * y) >> FIXED_POINT_COEFFICIENT_SHIFT) - x);
+
+    return y;
+
+}
+
+static inline int32_t applyFixedPointBandPassFilter(int32_t sample, int32_t g, int32_t c0, int32_t c1, int32_t *s1, int32_t *s2) {
+
+    int32_t x = saturate(((int64_t)g * sample) >> (FIXED_POINT_GAIN_SHIFT - FIXED_POINT_SIGNAL_SHIFT));
+
+    int32_t y = saturate((int64_t)x + *s1);
+
+    *s1 = saturate((((int64_t)c1 * y) >> FIXED_POINT_COEFFICIENT_SHIFT) + *s2);
+
+    *s2 = saturate((((int64_t)c0 * y) >> FIXED_POINT_COEFFICIENT_SHIFT) - x);
+
+    return y;
+
+}
+
+static inline int32_t applyFixedPointOutputRangeLimits(int32_t filterOutput) {
+
+    int32_t output = (int32_t)(((int64_t)filterOutput + (1 << (FIXED_POINT_SIGNAL_SHIFT - 1))) >> FIXED_POINT_SIGNAL_SHIFT);
+
+    if (output > INT16_MAX) return INT16_MAX;
+
+    if (output < -INT16_MAX) return -INT16_MAX;
+
+    return output;
+
+}
+
+static inline void updateFixedPointGoertzelFilters(int32_t window, int32_t sample, int32_t *d1, int32_t *d2) {
+
+    int32_t windowedSample = ((int32_t)window * sample) >> FIXED_POINT_WINDOW_SHIFT;
+
+    for (uint32_t k = 0; k < numberOfGoertzelFilters; k += 1) {
+
+        int32_t y = saturate((int64_t)windowedSample + (((int64_t)fixedPointGoertzelFilterConstants[k] * d1[k]) >> FIXED_POINT_COEFFICIENT_SHIFT) - d2[k]);
+
+        d2[k] = d1[k];
+
+        d1[k] = y;
+
+    }
+
+}
+
+static inline bool fixedPointGoertzelFiltersThresholdExceeded(int32_t *d1, int32_t *d2) {
+
+    bool exceededThreshold = false;
+
+    for (uint32_t k = 0; k < numberOfGoertzelFilters; k += 1) {
+
+        float f1 = (float)d1[k];
+
+        float f2 = (float)d2[k];
+
+        float squaredMagnitude = f1 * f1 + f2 * f2 - goertzelFilterConstants[k] * f1 * f2;
+
+        if (squaredMagnitude > squaredTriggerThresholdScale * goertzelFilterThresholds[k]) exceededThreshold = true;
+
+        d1[k] = 0;
+
+        d2[k] = 0;
+
+    }
+
+    return exceededThreshold;
+
+}
+
+/* General fixed-point filter routine */
+
+static bool fixedPointFilter(int16_t *source, int16_t *dest, uint32_t sampleRateDivider, uint32_t size) {
+
+    uint32_t index = 0;
+
+    int32_t peak = 0;
+
+    /* Load filter state and coefficients */
+
+    int32_t s1 = fixedPointState1;
+    int32_t s2 = fixedPointState2;
+
+    int32_t g = fixedPointGain;
+
+    int32_t c0 = fixedPointYc0;
+    int32_t c1 = fixedPointYc1;
+
+    uint32_t historyIndex = decimationHistoryIndex;
+
+    bool highPassFilter = filterType == DF_HIGH_PASS_FILTER;
+
+    for (uint32_t i = 0; i < size; i += sampleRateDivider) {
+
+        int32_t sample = decimate(source + i, sampleRateDivider, &historyIndex);
+
+        int32_t filterOutput = highPassFilter ? applyFixedPointHighPassFilter(sample, g, c0, &s1) : applyFixedPointBandPassFilter(sample, g, c0, c1, &s1, &s2);
+
+        filterOutput = applyFixedPointOutputRangeLimits(filterOutput);
+
+        /* Track peak output for the amplitude threshold */
+
+        peak = MAX(peak, ABS(filterOutput));
+
+        dest[index++] = (int16_t)filterOutput;
+
+    }
+
+    /* Store filter state */
+
+    fixedPointState1 = s1;
+    fixedPointState2 = s2;
+
+    decimationHistoryIndex = historyIndex;
+
+    return amplitudeThresholdExceeded(peak);
+
+}
+
+/* Fast fixed-point filter routines for when sampleRateDivider is not needed */
+
+static bool fastFixedPointFilterWithGoertzelFilterThreshold(int16_t *source, int16_t *dest, uint32_t size) {
+
+    uint32_t index = 0;
+
+    bool exceededThreshold = false;
+
+    /* Load filter state and coefficients */
+
+    int32_t s1 = fixedPointState1;
+    int32_t s2 = fixedPointState2;
+
+    int32_t g = fixedPointGain;
+
+    int32_t c0 = fixedPointYc0;
+    int32_t c1 = fixedPointYc1;
+
+    int32_t d1[MAXIMUM_NUMBER_OF_GOERTZEL_FILTERS] = {0};
+    int32_t d2[MAXIMUM_NUMBER_OF_GOERTZEL_FILTERS] = {0};
+
+    for (uint32_t i = 0; i < size / goertzelFilterWindowLength; i += 1) {
+
+        int16_t *window = hammingWindow.fixedPoint;
+
+        if (filterType == DF_HIGH_PASS_FILTER) {
+
+            for (uint32_t j = 0; j < goertzelFilterWindowLength / MINIMUM_NUMBER_OF_ITERATIONS; j += 1) {
+
+                for (uint32_t n = 0; n < MINIMUM_NUMBER_OF_ITERATIONS; n += 1) {
+
+                    int32_t filterOutput = applyFixedPointOutputRangeLimits(applyFixedPointHighPassFilter(source[index], g, c0, &s1));
+
+                    /* Update Goertzel filter bank */
+
+                    updateFixedPointGoertzelFilters(*window++, filterOutput, d1, d2);
+
+                    dest[index++] = (int16_t)filterOutput;
+
+                }
+
+            }
+
+        } else {
+
+            for (uint32_t j = 0; j < goertzelFilterWindowLength / MINIMUM_NUMBER_OF_ITERATIONS; j += 1) {
+
+                for (uint32_t n = 0; n < MINIMUM_NUMBER_OF_ITERATIONS; n += 1) {
+
+                    int32_t filterOutput = applyFixedPointOutputRangeLimits(applyFixedPointBandPassFilter(source[index], g, c0, c1, &s1, &s2));
+
+                    /* Update Goertzel filter bank */
+
+                    updateFixedPointGoertzelFilters(*window++, filterOutput, d1, d2);
+
+                    dest[index++] = (int16_t)filterOutput;
+
+                }
+
+            }
+
+        }
+
+        if (fixedPointGoertzelFiltersThresholdExceeded(d1, d2)) exceededThreshold = true;
+
+    }
+
+    /* Store filter state */
+
+    fixedPointState1 = s1;
+    fixedPointState2 = s2;
+
+    return exceededThreshold;
+
+}
+
+static bool fastFixedPointFilterWithAmplitudeThreshold(int16_t *source, int16_t *dest, uint32_t size) {
 
-static float xv0, xv1, xv2;
-static float yv0, yv1, yv2;
+    uint32_t index = 0;
 
-DF_filterType_t filterType;
+    int32_t peak = 0;
 
-/* Filter design variables */
+    /* Load filter state and coefficients */
 
-static complex float spoles[MAX_POLES];
-static complex float szeros[MAX_POLES];
+    int32_t s1 = fixedPointState1;
+    int32_t s2 = fixedPointState2;
 
-static complex float zpoles[MAX_POLES];
-static complex float zzeros[MAX_POLES];
+    int32_t g = fixedPointGain;
 
-static complex float topcoeffs[MAX_POLES + 1];
-static complex float botcoeffs[MAX_POLES + 1];
+    int32_t c0 = fixedPointYc0;
+    int32_t c1 = fixedPointYc1;
 
-/* Amplitude threshold variable */
+    if (filterType == DF_HIGH_PASS_FILTER) {
 
-static uint16_t amplitudeThreshold;
+        for (uint32_t i = 0; i < size / MINIMUM_NUMBER_OF_ITERATIONS; i += 1) {
 
-/* Goertzel filter variables */
+            for (uint32_t j = 0; j < MINIMUM_NUMBER_OF_ITERATIONS; j += 1) {
 
-static float hammingWindow[MAXIMUM_HAMMING_WINDOW_LENGTH];
+                int32_t filterOutput = applyFixedPointOutputRangeLimits(applyFixedPointHighPassFilter(source[index], g, c0, &s1));
 
-static uint32_t goertzelFilterWindowLength;
+                /* Track peak output for the amplitude threshold */
 
-static float goertzelFilterThreshold;
+                peak = MAX(peak, ABS(filterOutput));
 
-static float goertzelFilterConstant;
+                dest[index++] = (int16_t)filterOutput;
 
-/* Static filter design functions */
+            }
 
-static complex float blt(complex float pz) {
+        }
 
-    return (2.0f + pz) / (2.0f - pz);
+    } else {
 
-}
+        for (uint32_t i = 0; i < size / MINIMUM_NUMBER_OF_ITERATIONS; i += 1) {
 
-static void expand(complex float pz[], uint32_t npz, complex float coeffs[]) {
+            for (uint32_t j = 0; j < MINIMUM_NUMBER_OF_ITERATIONS; j += 1) {
 
-    coeffs[0] = 1.0f;
+                int32_t filterOutput = applyFixedPointOutputRangeLimits(applyFixedPointBandPassFilter(source[index], g, c0, c1, &s1, &s2));
 
-    for (uint32_t i=0; i < npz; i += 1) {
+                /* Track peak output for the amplitude threshold */
 
-        coeffs[i + 1] = 0.0f;
+                peak = MAX(peak, ABS(filterOutput));
 
-    }
+                dest[index++] = (int16_t)filterOutput;
 
-    for (uint32_t i=0; i < npz; i += 1) {
+            }
 
-        complex float nw = -pz[i];
+        }
 
-        for (uint32_t i = npz; i >= 1; i -= 1) {
+    }
 
-            coeffs[i] = (nw * coeffs[i]) + coeffs[i-1];
+    /* Store filter state */
 
-        }
+    fixedPointState1 = s1;
+    fixedPointState2 = s2;
 
-        coeffs[0] = nw * coeffs[0];
+    /* Check if amplitude threshold is exceeded */
 
-    }
+    return amplitudeThresholdExceeded(peak);
 
 }
 
-static complex float eval(complex float coeffs[], int npz, complex float z) {
+/* Fixed-point arithmetic is only used with the single section filters */
 
-   complex float sum = 0.0f;
+static inline bool useFixedPointArithmetic() {
 
-   for (int32_t i = npz; i >= 0; i -= 1) {
+    return fixedPointArithmetic && numberOfSections == 0;
 
-       sum = (sum * z) + coeffs[i];
+}
 
-   }
+/* Update the fixed-point coefficients from the floating-point design */
 
-   return sum;
+static void updateFixedPointCoefficients() {
 
-}
+    fixedPointGain = convertToFixedPoint(gain, FIXED_POINT_GAIN_SHIFT);
 
-static complex float evaluate(complex float topco[], int nz, complex float botco[], int np, complex float z) {
+    fixedPointYc0 = convertToFixedPoint(yc0, FIXED_POINT_COEFFICIENT_SHIFT);
 
-    return eval(topco, nz, z) / eval(botco, np, z);
+    fixedPointYc1 = convertToFixedPoint(yc1, FIXED_POINT_COEFFICIENT_SHIFT);
 
 }
 
-/* Static filter function */
+/* Reset the filter */
 
-static inline float applyHighPassFilter(float sample) {
+void DigitalFilter_reset() {
 
-    xv0 = xv1;
-    xv1 = sample * gain;
+    state1 = 0.0f;
+    state2 = 0.0f;
 
-    yv0 = yv1;
-    yv1 = xv1 - xv0 + yc0 * yv0;
+    fixedPointState1 = 0;
+    fixedPointState2 = 0;
 
-    return yv1;
+    for (uint32_t k = 0; k < MAXIMUM_NUMBER_OF_SECTIONS; k += 1) {
 
-}
+        sectionState1[k] = 0.0f;
+        sectionState2[k] = 0.0f;
 
-static inline float applyBandPassFilter(float sample) {
+    }
 
-    xv0 = xv1;
-    xv1 = xv2;
-    xv2 = sample * gain;
+    amplitudeThreshold = 0;
 
-    yv0 = yv1;
-    yv1 = yv2;
-    yv2 = xv2 - xv0 + yc0 * yv0 + yc1 * yv1;
+    adaptiveAmplitudeThreshold = false;
 
-    return yv2;
+    numberOfGoertzelFilters = 0;
 
 }
 
-/* General filter routine */
-
-static bool filter(int16_t *source, int16_t *dest, uint32_t sampleRateDivider, uint32_t size) {
+/* Update filter gain */
 
-    uint32_t index = 0;
+void DigitalFilter_setAdditionalGain(float g) {
 
-    bool exceededThreshold = false;
+    gain *= g;
 
-    for (uint32_t i = 0; i < size; i += sampleRateDivider) {
+    if (numberOfSections > 0) {
 
-        float sample = 0.0f;
+        sections[0].b0 *= g;
+        sections[0].b1 *= g;
+        sections[0].b2 *= g;
 
-        for (uint32_t j = 0; j < sampleRateDivider; j += 1) {
+    }
 
-            sample += source[i + j];
+    updateFixedPointCoefficients();
 
-        }
+}
 
-        float filterOutput;
+/* Look up the decimation filter coefficients for a sample rate divider */
 
-        if (filterType == DF_HIGH_PASS_FILTER) {
+static const int16_t* getDecimationFilter(uint32_t sampleRateDivider) {
 
-            filterOutput = applyHighPassFilter(sample);
+    return sampleRateDivider == 2 ? decimationFilter2 :
+           sampleRateDivider == 4 ? decimationFilter4 :
+           sampleRateDivider == 6 ? decimationFilter6 :
+           sampleRateDivider == 8 ? decimationFilter8 :
+           sampleRateDivider == 12 ? decimationFilter12 :
+           sampleRateDivider == 24 ? decimationFilter24 :
+           sampleRateDivider == 48 ? decimationFilter48 :
+           NULL;
 
-        } else {
+}
 
-            filterOutput = applyBandPassFilter(sample);
+/* Select the decimation filter */
 
-        }
+void DigitalFilter_setDecimationFilter(uint32_t sampleRateDivider) {
 
-        /* Apply output range limits */
+    decimationFilter = getDecimationFilter(sampleRateDivider);
 
-        if (filterOutput > INT16_MAX) {
+    decimationFilterLength = DECIMATION_FILTER_TAPS_PER_PHASE * sampleRateDivider;
 
-            filterOutput = INT16_MAX;
+    decimationHistoryIndex = 0;
 
-        } else if (filterOutput < -INT16_MAX) {
+    for (uint32_t i = 0; i < 2 * MAXIMUM_DECIMATION_FILTER_LENGTH; i += 1) {
 
-            filterOutput = -INT16_MAX;
+        decimationHistory[i] = 0;
 
-        }
+    }
 
-        /* Check if amplitude threshold is exceeded */
+}
 
-        if (fabsf(filterOutput) >= amplitudeThreshold) {
+/* Select the order of subsequently designed filters */
 
-            exceededThreshold = true;
+void DigitalFilter_setFilterOrder(uint32_t order) {
 
-        }
+    filterOrder = MIN(2 * MAXIMUM_NUMBER_OF_SECTIONS, order & ~1);
 
-        /* Write the output value */
+}
 
-        dest[index++] = (int16_t)filterOutput;
+/* Select fixed-point arithmetic */
 
-    }
+void DigitalFilter_setFixedPointArithmetic(bool enabled) {
 
-    return exceededThreshold;
+    fixedPointArithmetic = enabled;
 
 }
 
-/* Fast filter routine for when 250kHz and 384kHz and sampleRateDivider is not needed */
+/* Apply digital filter */
 
-static bool fastFilterWithGoertzelFilterThreshold(int16_t *source, int16_t *dest, uint32_t size) {
+bool DigitalFilter_applyFilter(int16_t *source, int16_t *dest, uint32_t sampleRateDivider, uint32_t size) {
 
-    uint32_t index = 0;
+    if (numberOfSections > 0) {
 
-    bool exceededThreshold = false;
+        return cascadedFilter(source, dest, sampleRateDivider, size);
 
-    if (filterType == DF_HIGH_PASS_FILTER) {
+    }
 
-        for (uint32_t i = 0; i < size / goertzelFilterWindowLength; i += 1) {
+    if (fixedPointArithmetic) {
 
-            float d1 = 0.0f;
+        if (sampleRateDivider == 1) {
 
-            float d2 = 0.0f;
+            if (numberOfGoertzelFilters > 0) {
 
-            uint32_t hammingIndex = 0;
+                return fastFixedPointFilterWithGoertzelFilterThreshold(source, dest, size);
 
-            for (uint32_t j = 0; j < goertzelFilterWindowLength / MINIMUM_NUMBER_OF_ITERATIONS; j += 1) {
+            } else {
 
-                for (uint32_t k = 0; k < MINIMUM_NUMBER_OF_ITERATIONS; k += 1) {
+                return fastFixedPointFilterWithAmplitudeThreshold(source, dest, size);
 
-                    float sample = source[index];
+            }
 
-                    float filterOutput = applyHighPassFilter(sample);
+        } else {
 
-                    /* Apply output range limits */
+            return fixedPointFilter(source, dest, sampleRateDivider, size);
 
-                    if (filterOutput > INT16_MAX) {
+        }
 
-                        filterOutput = INT16_MAX;
+    }
 
-                    } else if (filterOutput < -INT16_MAX) {
+    if (sampleRateDivider == 1) {
 
-                        filterOutput = -INT16_MAX;
+        if (numberOfGoertzelFilters > 0) {
 
-                    }
+            return fastFilterWithGoertzelFilterThreshold(source, dest, size);
 
-                    /* Update Goertzel filter */
+        } else {
 
-                    float y = hammingWindow[hammingIndex++] * filterOutput + goertzelFilterConstant * d1 - d2;
+            return fastFilterWithAmplitudeThreshold(source, dest, size);
 
-                    d2 = d1;
+        }
 
-                    d1 = y;
+    } else {
 
-                    /* Write the output value */
+        return filter(source, dest, sampleRateDivider, size);
 
-                    dest[index++] = (int16_t)filterOutput;
-                    
-                }
+    }
 
-            }
+}
 
-            float squaredMagnitude = d1 * d1 + d2 * d2 - goertzelFilterConstant * d1 * d2;
+bool DigitalFilter_applyFrequencyTrigger(int16_t *source, uint32_t size) {
 
-            if (squaredMagnitude > goertzelFilterThreshold) exceededThreshold = true;
+    uint32_t index = 0;
 
-        }
+    if (useFixedPointArithmetic()) {
 
-    } else {
+        int32_t d1[MAXIMUM_NUMBER_OF_GOERTZEL_FILTERS] = {0};
+        int32_t d2[MAXIMUM_NUMBER_OF_GOERTZEL_FILTERS] = {0};
 
         for (uint32_t i = 0; i < size / goertzelFilterWindowLength; i += 1) {
 
-            float d1 = 0.0f;
-
-            float d2 = 0.0f;
-
-            uint32_t hammingIndex = 0;
+            int16_t *window = hammingWindow.fixedPoint;
 
             for (uint32_t j = 0; j < goertzelFilterWindowLength / MINIMUM_NUMBER_OF_ITERATIONS; j += 1) {
 
                 for (uint32_t k = 0; k < MINIMUM_NUMBER_OF_ITERATIONS; k += 1) {
 
-                    float sample = source[index];
-
-                    float filterOutput = applyBandPassFilter(sample);
+                    updateFixedPointGoertzelFilters(*window++, source[index++], d1, d2);
 
-                    /* Apply output range limits */
+                }
 
-                    if (filterOutput > INT16_MAX) {
+            }
 
-                        filterOutput = INT16_MAX;
+            if (fixedPointGoertzelFiltersThresholdExceeded(d1, d2)) return true;
 
-                    } else if (filterOutput < -INT16_MAX) {
+        }
 
-                        filterOutput = -INT16_MAX;
+        return false;
 
-                    }
-                
-                    /* Update Goertzel filter */
+    }
 
-                    float y = hammingWindow[hammingIndex++] * filterOutput + goertzelFilterConstant * d1 - d2;
+    float d1[MAXIMUM_NUMBER_OF_GOERTZEL_FILTERS] = {0};
+    float d2[MAXIMUM_NUMBER_OF_GOERTZEL_FILTERS] = {0};
 
-                    d2 = d1;
+    for (uint32_t i = 0; i < size / goertzelFilterWindowLength; i += 1) {
 
-                    d1 = y;
+        float *window = hammingWindow.floatingPoint;
 
-                    /* Write the output value */
+        for (uint32_t j = 0; j < goertzelFilterWindowLength / MINIMUM_NUMBER_OF_ITERATIONS; j += 1) {
 
-                    dest[index++] = (int16_t)filterOutput;
+            for (uint32_t k = 0; k < MINIMUM_NUMBER_OF_ITERATIONS; k += 1) {
 
-                }
+                updateGoertzelFilters(*window++ * (float)source[index++], d1, d2);
 
             }
 
-            float squaredMagnitude = d1 * d1 + d2 * d2 - goertzelFilterConstant * d1 * d2;
+        }
 
-            if (squaredMagnitude > goertzelFilterThreshold) exceededThreshold = true;
+        if (goertzelFiltersThresholdExceeded(d1, d2)) return true;
 
-        }
-    
     }
 
-    return exceededThreshold;
+    return false;
 
 }
 
-static bool fastFilterWithAmplitudeThreshold(int16_t *source, int16_t *dest, uint32_t size) {
+/* Compare the mean energy per bin inside the target band with that of the remaining bins, excluding DC and Nyquist, for each window of the buffer */
+
+bool DigitalFilter_applySpectralTrigger(int16_t *source, uint32_t size) {
 
     uint32_t index = 0;
 
-    bool exceededThreshold = false;
+    uint32_t numberOfBins = spectralTriggerWindowLength / 2 - 1;
 
-    if (filterType == DF_HIGH_PASS_FILTER) {
+    uint32_t numberOfBandBins = spectralTriggerHigherBin - spectralTriggerLowerBin + 1;
 
-        for (uint32_t i = 0; i < size / MINIMUM_NUMBER_OF_ITERATIONS; i += 1) {
+    uint32_t numberOfOtherBins = numberOfBins - numberOfBandBins;
 
-            for (uint32_t j = 0; j < MINIMUM_NUMBER_OF_ITERATIONS; j += 1) {
+    for (uint32_t i = 0; i < size / spectralTriggerWindowLength; i += 1) {
 
-                float sample = source[index];
+        /* Apply the window and transform */
 
-                float filterOutput = applyHighPassFilter(sample);
+        for (uint32_t j = 0; j < spectralTriggerWindowLength; j += 1) {
 
-                /* Apply output range limits */
+            spectralTriggerBuffer[j] = hammingWindow.floatingPoint[j] * (float)source[index++];
 
-                if (filterOutput > INT16_MAX) {
+        }
 
-                    filterOutput = INT16_MAX;
+        FFT_realTransform(spectralTriggerBuffer, spectralTriggerWindowLength);
 
-                } else if (filterOutput < -INT16_MAX) {
+        /* Sum the band and out-of-band energy */
 
-                    filterOutput = -INT16_MAX;
+        float bandEnergy = 0.0f;
 
-                }
+        float otherEnergy = 0.0f;
 
-                /* Check if amplitude threshold is exceeded */
+        for (uint32_t k = 1; k <= numberOfBins; k += 1) {
 
-                if (fabsf(filterOutput) >= amplitudeThreshold) {
+            float real = spectralTriggerBuffer[2 * k];
 
-                    exceededThreshold = true;
+            float imag = spectralTriggerBuffer[2 * k + 1];
 
-                }
+            float energy = real * real + imag * imag;
 
-                /* Write the output value */
+            if (k >= spectralTriggerLowerBin && k <= spectralTriggerHigherBin) {
 
-                dest[index++] = (int16_t)filterOutput;
+                bandEnergy += energy;
+
+            } else {
+
+                otherEnergy += energy;
 
             }
 
         }
 
-    } else {
+        /* Compare the ratio without division */
 
-        for (uint32_t i = 0; i < size / MINIMUM_NUMBER_OF_ITERATIONS; i += 1) {
+        if (bandEnergy * (float)numberOfOtherBins > squaredTriggerThresholdScale * spectralTriggerRatio * otherEnergy * (float)numberOfBandBins) return true;
 
-            for (uint32_t j = 0; j < MINIMUM_NUMBER_OF_ITERATIONS; j += 1) {
+    }
 
-                float sample = source[index];
+    return false;
 
-                float filterOutput = applyBandPassFilter(sample);
+}
 
-                /* Apply output range limits */
+/* Design higher order filters as cascaded second order sections */
 
-                if (filterOutput > INT16_MAX) {
+static void addSection(DF_filterType_t type, complex float pole1, complex float pole2, complex float z) {
 
-                    filterOutput = INT16_MAX;
+    DF_filterSection_t *section = sections + numberOfSections;
 
-                } else if (filterOutput < -INT16_MAX) {
+    /* Calculate Z plane poles and denominator coefficients */
 
-                    filterOutput = -INT16_MAX;
+    complex float zpole1 = blt(pole1);
+    complex float zpole2 = blt(pole2);
 
-                }
+    section->a1 = -crealf(zpole1 + zpole2);
+    section->a2 = crealf(zpole1 * zpole2);
 
-                /* Check if amplitude threshold is exceeded */
+    /* Set numerator coefficients with zeros at z = 1 and/or z = -1 */
 
-                if (fabsf(filterOutput) >= amplitudeThreshold) {
+    section->b0 = 1.0f;
+    section->b1 = type == DF_HIGH_PASS_FILTER ? -2.0f : 0.0f;
+    section->b2 = type == DF_HIGH_PASS_FILTER ? 1.0f : -1.0f;
 
-                    exceededThreshold = true;
+    /* Normalise the section gain at the reference frequency */
 
-                }
+    complex float zinv = 1.0f / z;
 
-                /* Write the output value */
+    complex float top = section->b0 + section->b1 * zinv + section->b2 * zinv * zinv;
 
-                dest[index++] = (int16_t)filterOutput;
+    complex float bot = 1.0f + section->a1 * zinv + section->a2 * zinv * zinv;
 
-            }
+    complex float sectionGain = top / bot;
 
-        }
+    float g = 1.0f / hypotf(crealf(sectionGain), cimagf(sectionGain));
 
-    }
+    section->b0 *= g;
+    section->b1 *= g;
+    section->b2 *= g;
 
-    return exceededThreshold;
+    numberOfSections += 1;
 
 }
 
-/* Reset the filter */
+static void designCascadedFilter(uint32_t sampleRate, DF_filterType_t type, uint32_t freq1, uint32_t freq2) {
 
-void DigitalFilter_reset() {
+    /* Set filter type */
 
-    xv0 = 0.0f;
-    xv1 = 0.0f;
-    xv2 = 0.0f;
+    filterType = type;
 
-    yv0 = 0.0f;
-    yv1 = 0.0f;
-    yv2 = 0.0f;
+    numberOfSections = 0;
 
-    amplitudeThreshold = 0;
+    /* Normalise frequencies */
 
-    goertzelFilterThreshold = 0.0f;
+    float alpha1 = (float)freq1 / (float)sampleRate;
+    float alpha2 = (float)freq2 / (float)sampleRate;
 
-}
+    float warped_alpha1 = tanf(M_PI * alpha1) / M_PI;
+    float warped_alpha2 = tanf(M_PI * alpha2) / M_PI;
 
-/* Update filter gain */
+    float w1 = M_TWOPI * warped_alpha1;
+    float w2 = M_TWOPI * warped_alpha2;
 
-void DigitalFilter_setAdditionalGain(float g) {
+    /* Each band-pass prototype pole maps to two poles */
 
-    gain *= g;
+    uint32_t numberOfPrototypePoles = type == DF_HIGH_PASS_FILTER ? filterOrder : filterOrder / 2;
 
-}
+    /* Reference frequency for gain normalisation */
 
-/* Apply digital filter */
+    float theta = M_TWOPI * 0.5f * (alpha1 + alpha2);
 
-bool DigitalFilter_applyFilter(int16_t *source, int16_t *dest, uint32_t sampleRateDivider, uint32_t size) {
+    complex float z = type == DF_HIGH_PASS_FILTER ? -1.0f : cosf(theta) + sinf(theta) * I;
 
-    if (sampleRateDivider == 1) {
+    /* Step through the Butterworth prototype poles in the upper half of the S plane */
 
-        if (goertzelFilterThreshold > 0.0f) {
+    for (uint32_t k = 0; 2 * k + 1 <= numberOfPrototypePoles; k += 1) {
 
-            return fastFilterWithGoertzelFilterThreshold(source, dest, size);
+        complex float spole = cexpf(I * M_PI * (float)(2 * k + numberOfPrototypePoles + 1) / (float)(2 * numberOfPrototypePoles));
 
-        } else {
+        bool realPole = 2 * k + 1 == numberOfPrototypePoles;
 
-            return fastFilterWithAmplitudeThreshold(source, dest, size);
+        if (type == DF_HIGH_PASS_FILTER) {
 
-        }
+            /* Normalise S plane - conjugate pole pair and two zeros at zero */
 
-    } else {
+            complex float pole = w1 / spole;
 
-        return filter(source, dest, sampleRateDivider, size);
+            addSection(type, pole, conjf(pole), z);
 
-    }
+        } else {
 
-}
+            /* Normalise S plane - each prototype pole gives two poles with one zero at zero and one at infinity */
 
-bool DigitalFilter_applyFrequencyTrigger(int16_t *source, uint32_t size) {
+            float w0 = sqrtf(w1 * w2);
+            float bw = w2 - w1;
 
-    uint32_t index = 0;
+            complex float hba = 0.5f * bw * spole;
 
-    for (uint32_t i = 0; i < size / goertzelFilterWindowLength; i += 1) {
+            complex float temp = csqrtf(1.0f - (w0 / hba) * (w0 / hba));
 
-        float d1 = 0.0f;
+            complex float pole1 = hba * (1.0f + temp);
+            complex float pole2 = hba * (1.0f - temp);
 
-        float d2 = 0.0f;
+            if (realPole) {
 
-        uint32_t hammingIndex = 0;
+                addSection(type, pole1, pole2, z);
 
-        for (uint32_t j = 0; j < goertzelFilterWindowLength / MINIMUM_NUMBER_OF_ITERATIONS; j += 1) {
+            } else {
 
-            for (uint32_t k = 0; k < MINIMUM_NUMBER_OF_ITERATIONS; k += 1) {
+                addSection(type, pole1, conjf(pole1), z);
 
-                float y = hammingWindow[hammingIndex++] * (float)source[index++] + goertzelFilterConstant * d1 - d2;
-    
-                d2 = d1;
-    
-                d1 = y;
+                addSection(type, pole2, conjf(pole2), z);
 
             }
 
         }
 
-        float squaredMagnitude = d1 * d1 + d2 * d2 - goertzelFilterConstant * d1 * d2;
-
-        if (squaredMagnitude > goertzelFilterThreshold) return true;
-
     }
 
-    return false;
-
 }
 
 /* Design filters */
 
 static void designFilter(uint32_t sampleRate, DF_filterType_t type, uint32_t freq1, uint32_t freq2) {
 
+    /* Use cascaded second order sections for higher order filters */
+
+    if (filterOrder > MAX_POLES) {
+
+        designCascadedFilter(sampleRate, type, freq1, freq2);
+
+        return;
+
+    }
+
+    numberOfSections = 0;
+
     /* Set filter type */
 
     filterType = type;
@@ -606,6 +1542,10 @@ static void designFilter(uint32_t sampleRate, DF_filterType_t type, uint32_t fre
 
     }
 
+    /* Calculate fixed-point coefficients */
+
+    updateFixedPointCoefficients();
+
 }
 
 /* Design filters */
@@ -631,6 +1571,10 @@ void DigitalFilter_designBandPassFilter(uint32_t sampleRate, uint32_t freq1, uin
 
         filterType = DF_HIGH_PASS_FILTER;
 
+        numberOfSections = 0;
+
+        updateFixedPointCoefficients();
+
     } else if (freq2 == sampleRate / 2) {
 
         designFilter(sampleRate, DF_HIGH_PASS_FILTER, freq1, 0);
@@ -651,25 +1595,113 @@ void DigitalFilter_setAmplitudeThreshold(uint16_t threshold) {
 
 }
 
+void DigitalFilter_setTriggerHysteresis(float decibels) {
+
+    releaseThresholdScale = powf(10.0f, -decibels / 20.0f);
+
+}
+
+void DigitalFilter_setTriggerActive(bool active) {
+
+    triggerThresholdScale = active ? releaseThresholdScale : 1.0f;
+
+    squaredTriggerThresholdScale = triggerThresholdScale * triggerThresholdScale;
+
+}
+
+void DigitalFilter_setAdaptiveAmplitudeThreshold(uint32_t blocksPerSecond, float marginDecibels) {
+
+    adaptiveAmplitudeThreshold = true;
+
+    noiseFloor = -1.0f;
+
+    noiseFloorMargin = powf(10.0f, marginDecibels / 20.0f);
+
+    noiseFloorAttack = 1.0f - expf(-1.0f / (NOISE_FLOOR_ATTACK_TIME * (float)blocksPerSecond));
+
+    noiseFloorRelease = 1.0f - expf(-1.0f / (NOISE_FLOOR_RELEASE_TIME * (float)blocksPerSecond));
+
+}
+
 void DigitalFilter_setFrequencyTrigger(uint32_t windowLength, uint32_t sampleRate, uint32_t frequency, float percentageThreshold) {
 
-    goertzelFilterThreshold = 0.0f;
+    goertzelFilterFullScaleMagnitude = 0.0f;
 
     goertzelFilterWindowLength = windowLength;
 
     for (uint32_t i = 0; i < goertzelFilterWindowLength; i += 1) {
 
-        hammingWindow[i] = 0.54f - 0.46f * cosf(M_TWOPI * (float)i / (float)(goertzelFilterWindowLength - 1));
+        float window = 0.54f - 0.46f * cosf(M_TWOPI * (float)i / (float)(goertzelFilterWindowLength - 1));
+
+        if (useFixedPointArithmetic()) {
+
+            hammingWindow.fixedPoint[i] = (int16_t)roundf(window * (float)INT16_MAX);
+
+        } else {
+
+            hammingWindow.floatingPoint[i] = window;
+
+        }
+
+        goertzelFilterFullScaleMagnitude += window;
+
+    }
+
+    goertzelFilterFullScaleMagnitude *= (float)INT16_MAX / 2.0f;
+
+    numberOfGoertzelFilters = 0;
+
+    DigitalFilter_addFrequencyTrigger(sampleRate, frequency, percentageThreshold);
+
+}
+
+void DigitalFilter_addFrequencyTrigger(uint32_t sampleRate, uint32_t frequency, float percentageThreshold) {
+
+    if (numberOfGoertzelFilters == MAXIMUM_NUMBER_OF_GOERTZEL_FILTERS) return;
+
+    float goertzelFilterConstant = 2.0f * cosf(M_TWOPI * (float)frequency / (float)sampleRate);
+
+    goertzelFilterConstants[numberOfGoertzelFilters] = goertzelFilterConstant;
+
+    fixedPointGoertzelFilterConstants[numberOfGoertzelFilters] = convertToFixedPoint(goertzelFilterConstant, FIXED_POINT_COEFFICIENT_SHIFT);
 
-        goertzelFilterThreshold += hammingWindow[i];
+    goertzelFilterThresholds[numberOfGoertzelFilters] = percentageThreshold >= 100.0f ? FLT_MAX : goertzelFilterFullScaleMagnitude * goertzelFilterFullScaleMagnitude * percentageThreshold / 100.0f * percentageThreshold / 100.0f;
+
+    numberOfGoertzelFilters += 1;
+
+}
+
+void DigitalFilter_setSpectralTrigger(uint32_t windowLength, uint32_t sampleRate, uint32_t lowerFrequency, uint32_t higherFrequency, float ratioDecibels) {
+
+    spectralTriggerWindowLength = windowLength;
+
+    for (uint32_t i = 0; i < spectralTriggerWindowLength; i += 1) {
+
+        hammingWindow.floatingPoint[i] = 0.54f - 0.46f * cosf(M_TWOPI * (float)i / (float)(spectralTriggerWindowLength - 1));
 
     }
 
-    goertzelFilterThreshold *= (float)INT16_MAX / 2.0f;
+    /* Convert the band edges to bins between DC and Nyquist */
+
+    uint32_t maximumBin = spectralTriggerWindowLength / 2 - 1;
+
+    spectralTriggerLowerBin = MIN(maximumBin, MAX(1, (lowerFrequency * spectralTriggerWindowLength + sampleRate / 2) / sampleRate));
+
+    spectralTriggerHigherBin = MIN(maximumBin, MAX(spectralTriggerLowerBin, (higherFrequency * spectralTriggerWindowLength + sampleRate / 2) / sampleRate));
+
+    /* Leave at least one reference bin outside the band by dropping the bin nearest Nyquist if the band covers every bin */
+
+    if (spectralTriggerLowerBin == 1 && spectralTriggerHigherBin == maximumBin && maximumBin > 1) spectralTriggerHigherBin = maximumBin - 1;
+
+    spectralTriggerRatio = powf(10.0f, ratioDecibels / 10.0f);
+
+}
+
+/* Read back the number of decimation filter taps, which is zero when the sample rate divider falls back to the boxcar sum */
 
-    goertzelFilterThreshold = percentageThreshold >= 100.0f ? FLT_MAX : goertzelFilterThreshold * goertzelFilterThreshold * percentageThreshold / 100.0f * percentageThreshold / 100.0f;
+uint32_t DigitalFilter_getDecimationFilterLength(uint32_t sampleRateDivider) {
 
-    goertzelFilterConstant = 2.0f * cosf(M_TWOPI * (float)frequency / (float)sampleRate);
+    return getDecimationFilter(sampleRateDivider) == NULL ? 0 : DECIMATION_FILTER_TAPS_PER_PHASE * sampleRateDivider;
 
 }
 
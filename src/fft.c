@@ -0,0 +1,162 @@
+/****************************************************************************
+ * fft.c
+ * openacousticdevices.info
+ * October 2026
+ *****************************************************************************/
+
+#include <math.h>
+
+#include "fft.h"
+
+/* Maths constants */
+
+#ifndef M_PI
+#define M_PI            3.14159265358979323846f
+#endif
+
+#ifndef M_TWOPI
+#define M_TWOPI         (2.0f * M_PI)
+#endif
+
+/* Private function to perform an in-place radix-2 decimation in time transform on interleaved complex data */
+
+static void complexTransform(float *data, uint32_t numberOfPoints) {
+
+    /* Bit reversal permutation */
+
+    uint32_t j = 0;
+
+    for (uint32_t i = 0; i < numberOfPoints - 1; i += 1) {
+
+        if (i < j) {
+
+            float real = data[2 * i];
+            float imag = data[2 * i + 1];
+
+            data[2 * i] = data[2 * j];
+            data[2 * i + 1] = data[2 * j + 1];
+
+            data[2 * j] = real;
+            data[2 * j + 1] = imag;
+
+        }
+
+        uint32_t mask = numberOfPoints >> 1;
+
+        while (j & mask) {
+
+            j ^= mask;
+
+            mask >>= 1;
+
+        }
+
+        j |= mask;
+
+    }
+
+    /* Butterflies with twiddle factors generated by recurrence */
+
+    for (uint32_t length = 2; length <= numberOfPoints; length <<= 1) {
+
+        uint32_t halfLength = length >> 1;
+
+        float theta = -M_TWOPI / (float)length;
+
+        float temp = sinf(0.5f * theta);
+
+        float wpr = -2.0f * temp * temp;
+
+        float wpi = sinf(theta);
+
+        float wr = 1.0f;
+
+        float wi = 0.0f;
+
+        for (uint32_t m = 0; m < halfLength; m += 1) {
+
+            for (uint32_t i = m; i < numberOfPoints; i += length) {
+
+                uint32_t k = i + halfLength;
+
+                float tr = wr * data[2 * k] - wi * data[2 * k + 1];
+                float ti = wr * data[2 * k + 1] + wi * data[2 * k];
+
+                data[2 * k] = data[2 * i] - tr;
+                data[2 * k + 1] = data[2 * i + 1] - ti;
+
+                data[2 * i] += tr;
+                data[2 * i + 1] += ti;
+
+            }
+
+            temp = wr;
+
+            wr += wr * wpr - wi * wpi;
+
+            wi += wi * wpr + temp * wpi;
+
+        }
+
+    }
+
+}
+
+/* Public function to transform a real sequence by packing it as a half length complex sequence and then separating the even and odd spectra */
+
+void FFT_realTransform(float *data, uint32_t length) {
+
+    uint32_t numberOfPoints = length >> 1;
+
+    complexTransform(data, numberOfPoints);
+
+    float theta = -M_TWOPI / (float)length;
+
+    float temp = sinf(0.5f * theta);
+
+    float wpr = -2.0f * temp * temp;
+
+    float wpi = sinf(theta);
+
+    float wr = 1.0f + wpr;
+
+    float wi = wpi;
+
+    for (uint32_t k = 1; k <= numberOfPoints / 2; k += 1) {
+
+        uint32_t i1 = 2 * k;
+
+        uint32_t i2 = 2 * (numberOfPoints - k);
+
+        float h1r = 0.5f * (data[i1] + data[i2]);
+        float h1i = 0.5f * (data[i1 + 1] - data[i2 + 1]);
+
+        float h2r = 0.5f * (data[i1 + 1] + data[i2 + 1]);
+        float h2i = -0.5f * (data[i1] - data[i2]);
+
+        float tr = wr * h2r - wi * h2i;
+        float ti = wr * h2i + wi * h2r;
+
+        data[i1] = h1r + tr;
+        data[i1 + 1] = h1i + ti;
+
+        data[i2] = h1r - tr;
+        data[i2 + 1] = ti - h1i;
+
+        temp = wr;
+
+        wr += wr * wpr - wi * wpi;
+
+        wi += wi * wpr + temp * wpi;
+
+    }
+
+    /* Combine the DC and Nyquist terms */
+
+    temp = data[0];
+
+    data[0] = temp + data[1];
+
+    data[1] = temp - data[1];
+
+}
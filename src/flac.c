@@ -0,0 +1,632 @@
+/****************************************************************************
+ * flac.c
+ * openacousticdevices.info
+ * October 2026
+ *****************************************************************************/
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "flac.h"
+
+/* Stream constants */
+
+#define BITS_PER_SAMPLE                 16
+
+#define MAXIMUM_FIXED_ORDER             4
+
+#define MAXIMUM_PARTITION_ORDER         5
+
+#define MAXIMUM_RICE_PARAMETER          14
+
+#define MAXIMUM_BITS_PER_WRITE          24
+
+#define MAXIMUM_FRAME_HEADER_SIZE       16
+
+#define OUTPUT_BUFFER_SIZE              (MAXIMUM_FRAME_HEADER_SIZE + 1 + FLAC_BLOCK_SIZE * BITS_PER_SAMPLE / 8 + 2)
+
+/* Metadata block constants */
+
+#define STREAMINFO_BLOCK                0
+#define PADDING_BLOCK                   1
+#define VORBIS_COMMENT_BLOCK            4
+
+#define LAST_METADATA_BLOCK             0x80
+
+#define METADATA_BLOCK_HEADER_SIZE      4
+
+#define STREAMINFO_SIZE                 34
+
+#define VENDOR_STRING                   "AudioMoth-Firmware-Basic"
+
+/* Frame constants */
+
+#define FRAME_SYNC_CODE                 0xFFF8
+
+#define BLOCK_SIZE_CODE_1024            0x0A
+#define BLOCK_SIZE_CODE_16_BIT          0x07
+
+#define SAMPLE_SIZE_CODE_16_BIT         0x04
+
+#define CONSTANT_SUBFRAME               0x00
+#define VERBATIM_SUBFRAME               0x01
+#define FIXED_SUBFRAME                  0x08
+
+/* Useful macros */
+
+#define MIN(a, b)                       ((a) < (b) ? (a) : (b))
+#define MAX(a, b)                       ((a) > (b) ? (a) : (b))
+
+/* CRC-16 table for polynomial 0x8005 */
+
+static const uint16_t crc16Table[256] = {
+    0x0000, 0x8005, 0x800F, 0x000A, 0x801B, 0x001E, 0x0014, 0x8011,
+    0x8033, 0x0036, 0x003C, 0x8039, 0x0028, 0x802D, 0x8027, 0x0022,
+    0x8063, 0x0066, 0x006C, 0x8069, 0x0078, 0x807D, 0x8077, 0x0072,
+    0x0050, 0x8055, 0x805F, 0x005A, 0x804B, 0x004E, 0x0044, 0x8041,
+    0x80C3, 0x00C6, 0x00CC, 0x80C9, 0x00D8, 0x80DD, 0x80D7, 0x00D2,
+    0x00F0, 0x80F5, 0x80FF, 0x00FA, 0x80EB, 0x00EE, 0x00E4, 0x80E1,
+    0x00A0, 0x80A5, 0x80AF, 0x00AA, 0x80BB, 0x00BE, 0x00B4, 0x80B1,
+    0x8093, 0x0096, 0x009C, 0x8099, 0x0088, 0x808D, 0x8087, 0x0082,
+    0x8183, 0x0186, 0x018C, 0x8189, 0x0198, 0x819D, 0x8197, 0x0192,
+    0x01B0, 0x81B5, 0x81BF, 0x01BA, 0x81AB, 0x01AE, 0x01A4, 0x81A1,
+    0x01E0, 0x81E5, 0x81EF, 0x01EA, 0x81FB, 0x01FE, 0x01F4, 0x81F1,
+    0x81D3, 0x01D6, 0x01DC, 0x81D9, 0x01C8, 0x81CD, 0x81C7, 0x01C2,
+    0x0140, 0x8145, 0x814F, 0x014A, 0x815B, 0x015E, 0x0154, 0x8151,
+    0x8173, 0x0176, 0x017C, 0x8179, 0x0168, 0x816D, 0x8167, 0x0162,
+    0x8123, 0x0126, 0x012C, 0x8129, 0x0138, 0x813D, 0x8137, 0x0132,
+    0x0110, 0x8115, 0x811F, 0x011A, 0x810B, 0x010E, 0x0104, 0x8101,
+    0x8303, 0x0306, 0x030C, 0x8309, 0x0318, 0x831D, 0x8317, 0x0312,
+    0x0330, 0x8335, 0x833F, 0x033A, 0x832B, 0x032E, 0x0324, 0x8321,
+    0x0360, 0x8365, 0x836F, 0x036A, 0x837B, 0x037E, 0x0374, 0x8371,
+    0x8353, 0x0356, 0x035C, 0x8359, 0x0348, 0x834D, 0x8347, 0x0342,
+    0x03C0, 0x83C5, 0x83CF, 0x03CA, 0x83DB, 0x03DE, 0x03D4, 0x83D1,
+    0x83F3, 0x03F6, 0x03FC, 0x83F9, 0x03E8, 0x83ED, 0x83E7, 0x03E2,
+    0x83A3, 0x03A6, 0x03AC, 0x83A9, 0x03B8, 0x83BD, 0x83B7, 0x03B2,
+    0x0390, 0x8395, 0x839F, 0x039A, 0x838B, 0x038E, 0x0384, 0x8381,
+    0x0280, 0x8285, 0x828F, 0x028A, 0x829B, 0x029E, 0x0294, 0x8291,
+    0x82B3, 0x02B6, 0x02BC, 0x82B9, 0x02A8, 0x82AD, 0x82A7, 0x02A2,
+    0x82E3, 0x02E6, 0x02EC, 0x82E9, 0x02F8, 0x82FD, 0x82F7, 0x02F2,
+    0x02D0, 0x82D5, 0x82DF, 0x02DA, 0x82CB, 0x02CE, 0x02C4, 0x82C1,
+    0x8243, 0x0246, 0x024C, 0x8249, 0x0258, 0x825D, 0x8257, 0x0252,
+    0x0270, 0x8275, 0x827F, 0x027A, 0x826B, 0x026E, 0x0264, 0x8261,
+    0x0220, 0x8225, 0x822F, 0x022A, 0x823B, 0x023E, 0x0234, 0x8231,
+    0x8213, 0x0216, 0x021C, 0x8219, 0x0208, 0x820D, 0x8207, 0x0202};
+
+/* Stream variables */
+
+static uint32_t streamSampleRate;
+
+static uint32_t frameNumber;
+
+static uint64_t totalNumberOfSamples;
+
+static uint32_t minimumFrameSize;
+
+static uint32_t maximumFrameSize;
+
+/* Output variables */
+
+static uint8_t outputBuffer[OUTPUT_BUFFER_SIZE];
+
+static uint8_t *outputPointer;
+
+static uint32_t bitBuffer;
+
+static uint32_t bitCount;
+
+/* Bit writer functions */
+
+static inline void writeBits(uint32_t value, uint32_t numberOfBits) {
+
+    bitBuffer = (bitBuffer << numberOfBits) | (value & ((1 << numberOfBits) - 1));
+
+    bitCount += numberOfBits;
+
+    while (bitCount >= 8) {
+
+        bitCount -= 8;
+
+        *outputPointer++ = bitBuffer >> bitCount;
+
+    }
+
+}
+
+static inline void writeRiceCode(int32_t value, uint32_t parameter) {
+
+    uint32_t foldedValue = (uint32_t)(value << 1) ^ (uint32_t)(value >> 31);
+
+    uint32_t quotient = foldedValue >> parameter;
+
+    uint32_t remainder = foldedValue & ((1 << parameter) - 1);
+
+    /* Write the unary quotient and binary remainder together where possible */
+
+    if (quotient + 1 + parameter <= MAXIMUM_BITS_PER_WRITE) {
+
+        writeBits((1 << parameter) | remainder, quotient + 1 + parameter);
+
+        return;
+
+    }
+
+    while (quotient >= MAXIMUM_BITS_PER_WRITE) {
+
+        writeBits(0, MAXIMUM_BITS_PER_WRITE);
+
+        quotient -= MAXIMUM_BITS_PER_WRITE;
+
+    }
+
+    writeBits(1, quotient + 1);
+
+    if (parameter > 0) writeBits(remainder, parameter);
+
+}
+
+static inline void alignToByte() {
+
+    if (bitCount > 0) writeBits(0, 8 - bitCount);
+
+}
+
+/* CRC functions */
+
+static uint8_t calculateCRC8(uint8_t *data, uint32_t length) {
+
+    uint8_t crc = 0;
+
+    for (uint32_t i = 0; i < length; i += 1) {
+
+        crc ^= data[i];
+
+        for (uint32_t j = 0; j < 8; j += 1) {
+
+            crc = crc & 0x80 ? (crc << 1) ^ 0x07 : crc << 1;
+
+        }
+
+    }
+
+    return crc;
+
+}
+
+static uint16_t calculateCRC16(uint8_t *data, uint32_t length) {
+
+    uint16_t crc = 0;
+
+    for (uint32_t i = 0; i < length; i += 1) {
+
+        crc = (crc << 8) ^ crc16Table[(crc >> 8) ^ data[i]];
+
+    }
+
+    return crc;
+
+}
+
+/* Fixed predictor residual */
+
+static inline int32_t calculateResidual(int16_t *x, uint32_t i, uint32_t order) {
+
+    if (order == 0) return x[i];
+
+    if (order == 1) return x[i] - x[i - 1];
+
+    if (order == 2) return x[i] - 2 * x[i - 1] + x[i - 2];
+
+    if (order == 3) return x[i] - 3 * x[i - 1] + 3 * x[i - 2] - x[i - 3];
+
+    return x[i] - 4 * x[i - 1] + 6 * x[i - 2] - 4 * x[i - 3] + x[i - 4];
+
+}
+
+/* Select the fixed predictor order with the smallest total absolute residual */
+
+static uint32_t selectFixedOrder(int16_t *x, uint32_t numberOfSamples) {
+
+    if (numberOfSamples <= MAXIMUM_FIXED_ORDER) return 0;
+
+    uint32_t sum[MAXIMUM_FIXED_ORDER + 1] = {0};
+
+    int32_t lastError0 = x[3];
+    int32_t lastError1 = x[3] - x[2];
+    int32_t lastError2 = lastError1 - (x[2] - x[1]);
+    int32_t lastError3 = lastError2 - (x[2] - 2 * x[1] + x[0]);
+
+    for (uint32_t i = MAXIMUM_FIXED_ORDER; i < numberOfSamples; i += 1) {
+
+        int32_t error0 = x[i];
+        int32_t error1 = error0 - lastError0;
+        int32_t error2 = error1 - lastError1;
+        int32_t error3 = error2 - lastError2;
+        int32_t error4 = error3 - lastError3;
+
+        sum[0] += error0 < 0 ? -error0 : error0;
+        sum[1] += error1 < 0 ? -error1 : error1;
+        sum[2] += error2 < 0 ? -error2 : error2;
+        sum[3] += error3 < 0 ? -error3 : error3;
+        sum[4] += error4 < 0 ? -error4 : error4;
+
+        lastError0 = error0;
+        lastError1 = error1;
+        lastError2 = error2;
+        lastError3 = error3;
+
+    }
+
+    uint32_t order = 0;
+
+    for (uint32_t k = 1; k <= MAXIMUM_FIXED_ORDER; k += 1) {
+
+        if (sum[k] < sum[order]) order = k;
+
+    }
+
+    return order;
+
+}
+
+/* Estimate the Rice parameter and encoded size of a partition from the sum of its folded residuals */
+
+static uint32_t selectRiceParameter(uint32_t numberOfSamples, uint32_t sum, uint32_t *bits) {
+
+    uint32_t parameter = 0;
+
+    while (parameter < MAXIMUM_RICE_PARAMETER && (numberOfSamples << (parameter + 1)) < sum) parameter += 1;
+
+    *bits = numberOfSamples * (parameter + 1) + (sum >> parameter);
+
+    return parameter;
+
+}
+
+/* Encode a fixed predictor subframe if it is smaller than the verbatim subframe */
+
+static bool encodeFixedSubframe(int16_t *x, uint32_t numberOfSamples) {
+
+    uint32_t order = selectFixedOrder(x, numberOfSamples);
+
+    /* Determine the finest usable partition order */
+
+    uint32_t maximumPartitionOrder = 0;
+
+    while (maximumPartitionOrder < MAXIMUM_PARTITION_ORDER && (numberOfSamples & ((2 << maximumPartitionOrder) - 1)) == 0 && (numberOfSamples >> (maximumPartitionOrder + 1)) > order) maximumPartitionOrder += 1;
+
+    /* Sum the folded residuals in each of the finest partitions */
+
+    uint32_t sums[1 << MAXIMUM_PARTITION_ORDER];
+
+    uint32_t partitionSize = numberOfSamples >> maximumPartitionOrder;
+
+    uint32_t index = order;
+
+    for (uint32_t j = 0; j < (1u << maximumPartitionOrder); j += 1) {
+
+        uint32_t sum = 0;
+
+        for (; index < (j + 1) * partitionSize; index += 1) {
+
+            int32_t residual = calculateResidual(x, index, order);
+
+            sum += (uint32_t)(residual << 1) ^ (uint32_t)(residual >> 31);
+
+        }
+
+        sums[j] = sum;
+
+    }
+
+    /* Choose the partition order with the smallest estimated size, merging partition sums at each coarser order */
+
+    uint32_t bestPartitionOrder = maximumPartitionOrder;
+
+    uint32_t bestBits = UINT32_MAX;
+
+    for (int32_t partitionOrder = maximumPartitionOrder; partitionOrder >= 0; partitionOrder -= 1) {
+
+        uint32_t numberOfPartitions = 1 << partitionOrder;
+
+        uint32_t bits = 0;
+
+        for (uint32_t j = 0; j < numberOfPartitions; j += 1) {
+
+            uint32_t partitionBits;
+
+            uint32_t numberOfPartitionSamples = (numberOfSamples >> partitionOrder) - (j == 0 ? order : 0);
+
+            selectRiceParameter(numberOfPartitionSamples, sums[j], &partitionBits);
+
+            bits += 4 + partitionBits;
+
+        }
+
+        if (bits < bestBits) {
+
+            bestBits = bits;
+
+            bestPartitionOrder = partitionOrder;
+
+        }
+
+        for (uint32_t j = 0; j < numberOfPartitions / 2; j += 1) sums[j] = sums[2 * j] + sums[2 * j + 1];
+
+    }
+
+    /* Fall back to a verbatim subframe as the estimate is an upper bound on the encoded size */
+
+    if (order * BITS_PER_SAMPLE + 6 + bestBits >= numberOfSamples * BITS_PER_SAMPLE) return false;
+
+    /* Write the subframe header and warm-up samples */
+
+    writeBits((FIXED_SUBFRAME | order) << 1, 8);
+
+    for (uint32_t i = 0; i < order; i += 1) writeBits((uint16_t)x[i], BITS_PER_SAMPLE);
+
+    /* Write the partitioned Rice coded residual */
+
+    writeBits(0, 2);
+
+    writeBits(bestPartitionOrder, 4);
+
+    partitionSize = numberOfSamples >> bestPartitionOrder;
+
+    index = order;
+
+    for (uint32_t j = 0; j < (1u << bestPartitionOrder); j += 1) {
+
+        uint32_t sum = 0;
+
+        uint32_t start = index;
+
+        for (; index < (j + 1) * partitionSize; index += 1) {
+
+            int32_t residual = calculateResidual(x, index, order);
+
+            sum += (uint32_t)(residual << 1) ^ (uint32_t)(residual >> 31);
+
+        }
+
+        uint32_t partitionBits;
+
+        uint32_t parameter = selectRiceParameter(index - start, sum, &partitionBits);
+
+        writeBits(parameter, 4);
+
+        for (index = start; index < (j + 1) * partitionSize; index += 1) {
+
+            writeRiceCode(calculateResidual(x, index, order), parameter);
+
+        }
+
+    }
+
+    return true;
+
+}
+
+/* Frame functions */
+
+static void writeFrameHeader(uint32_t numberOfSamples) {
+
+    outputPointer = outputBuffer;
+
+    bitBuffer = 0;
+
+    bitCount = 0;
+
+    writeBits(FRAME_SYNC_CODE, 16);
+
+    writeBits(numberOfSamples == FLAC_BLOCK_SIZE ? BLOCK_SIZE_CODE_1024 : BLOCK_SIZE_CODE_16_BIT, 4);
+
+    writeBits(0, 4);
+
+    writeBits(0, 4);
+
+    writeBits(SAMPLE_SIZE_CODE_16_BIT, 3);
+
+    writeBits(0, 1);
+
+    /* Write the frame number with UTF-8 style coding */
+
+    if (frameNumber < 0x80) {
+
+        writeBits(frameNumber, 8);
+
+    } else {
+
+        uint32_t numberOfBytes = 2;
+
+        while (frameNumber >> (5 * numberOfBytes + 1)) numberOfBytes += 1;
+
+        writeBits((0xFF00 >> numberOfBytes) | (frameNumber >> (6 * (numberOfBytes - 1))), 8);
+
+        for (int32_t i = numberOfBytes - 2; i >= 0; i -= 1) writeBits(0x80 | ((frameNumber >> (6 * i)) & 0x3F), 8);
+
+    }
+
+    if (numberOfSamples != FLAC_BLOCK_SIZE) writeBits(numberOfSamples - 1, 16);
+
+    writeBits(calculateCRC8(outputBuffer, outputPointer - outputBuffer), 8);
+
+}
+
+static uint8_t* writeFrameFooter(uint32_t numberOfSamples, uint32_t *frameSize) {
+
+    alignToByte();
+
+    writeBits(calculateCRC16(outputBuffer, outputPointer - outputBuffer), 16);
+
+    *frameSize = outputPointer - outputBuffer;
+
+    /* Update the stream statistics */
+
+    frameNumber += 1;
+
+    totalNumberOfSamples += numberOfSamples;
+
+    minimumFrameSize = minimumFrameSize == 0 ? *frameSize : MIN(minimumFrameSize, *frameSize);
+
+    maximumFrameSize = MAX(maximumFrameSize, *frameSize);
+
+    return outputBuffer;
+
+}
+
+/* Public functions */
+
+void FLAC_initialise(uint32_t sampleRate) {
+
+    streamSampleRate = sampleRate;
+
+    frameNumber = 0;
+
+    totalNumberOfSamples = 0;
+
+    minimumFrameSize = 0;
+
+    maximumFrameSize = 0;
+
+}
+
+uint8_t* FLAC_encodeFrame(int16_t *source, uint32_t numberOfSamples, uint32_t *frameSize) {
+
+    writeFrameHeader(numberOfSamples);
+
+    /* Use a constant subframe when every sample is the same */
+
+    bool constant = true;
+
+    for (uint32_t i = 1; i < numberOfSamples && constant; i += 1) constant = source[i] == source[0];
+
+    if (constant) {
+
+        writeBits(CONSTANT_SUBFRAME << 1, 8);
+
+        writeBits((uint16_t)source[0], BITS_PER_SAMPLE);
+
+    } else if (encodeFixedSubframe(source, numberOfSamples) == false) {
+
+        writeBits(VERBATIM_SUBFRAME << 1, 8);
+
+        for (uint32_t i = 0; i < numberOfSamples; i += 1) writeBits((uint16_t)source[i], BITS_PER_SAMPLE);
+
+    }
+
+    return writeFrameFooter(numberOfSamples, frameSize);
+
+}
+
+uint8_t* FLAC_encodeSilentFrame(uint32_t numberOfSamples, uint32_t *frameSize) {
+
+    writeFrameHeader(numberOfSamples);
+
+    writeBits(CONSTANT_SUBFRAME << 1, 8);
+
+    writeBits(0, BITS_PER_SAMPLE);
+
+    return writeFrameFooter(numberOfSamples, frameSize);
+
+}
+
+static void writeLittleEndian(uint32_t value) {
+
+    for (uint32_t i = 0; i < 4; i += 1) writeBits(value >> (8 * i), 8);
+
+}
+
+static void writeString(char *string, uint32_t length) {
+
+    for (uint32_t i = 0; i < length; i += 1) writeBits(string[i], 8);
+
+}
+
+uint8_t* FLAC_encodeHeader(char *artist, char *comment) {
+
+    outputPointer = outputBuffer;
+
+    bitBuffer = 0;
+
+    bitCount = 0;
+
+    writeString("fLaC", 4);
+
+    /* Write the stream information */
+
+    writeBits(STREAMINFO_BLOCK, 8);
+
+    writeBits(STREAMINFO_SIZE, 24);
+
+    writeBits(FLAC_BLOCK_SIZE, 16);
+
+    writeBits(FLAC_BLOCK_SIZE, 16);
+
+    writeBits(minimumFrameSize, 24);
+
+    writeBits(maximumFrameSize, 24);
+
+    writeBits(streamSampleRate, 20);
+
+    writeBits(0, 3);
+
+    writeBits(BITS_PER_SAMPLE - 1, 5);
+
+    writeBits(totalNumberOfSamples >> 32, 4);
+
+    writeBits(totalNumberOfSamples >> 16, 16);
+
+    writeBits(totalNumberOfSamples, 16);
+
+    for (uint32_t i = 0; i < 16; i += 1) writeBits(0, 8);
+
+    /* Write the Vorbis comment, truncating the comment so the padding block still fits */
+
+    uint32_t vendorLength = strlen(VENDOR_STRING);
+
+    uint32_t artistLength = strlen(artist);
+
+    uint32_t commentLength = strlen(comment);
+
+    uint32_t fixedLength = 4 + vendorLength + 4 + 4 + strlen("ARTIST=") + artistLength + 4 + strlen("COMMENT=");
+
+    uint32_t availableLength = FLAC_HEADER_SIZE - (outputPointer - outputBuffer) - 2 * METADATA_BLOCK_HEADER_SIZE - fixedLength;
+
+    commentLength = MIN(commentLength, availableLength);
+
+    writeBits(VORBIS_COMMENT_BLOCK, 8);
+
+    writeBits(fixedLength + commentLength, 24);
+
+    writeLittleEndian(vendorLength);
+
+    writeString(VENDOR_STRING, vendorLength);
+
+    writeLittleEndian(2);
+
+    writeLittleEndian(strlen("ARTIST=") + artistLength);
+
+    writeString("ARTIST=", strlen("ARTIST="));
+
+    writeString(artist, artistLength);
+
+    writeLittleEndian(strlen("COMMENT=") + commentLength);
+
+    writeString("COMMENT=", strlen("COMMENT="));
+
+    writeString(comment, commentLength);
+
+    /* Pad the header to a fixed size so it can be rewritten when the file is closed */
+
+    uint32_t paddingLength = FLAC_HEADER_SIZE - (outputPointer - outputBuffer) - METADATA_BLOCK_HEADER_SIZE;
+
+    writeBits(LAST_METADATA_BLOCK | PADDING_BLOCK, 8);
+
+    writeBits(paddingLength, 24);
+
+    memset(outputPointer, 0, paddingLength);
+
+    return outputBuffer;
+
+}
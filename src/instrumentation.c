@@ -0,0 +1,108 @@
+/****************************************************************************
+ * instrumentation.c
+ * openacousticdevices.info
+ * October 2026
+ *****************************************************************************/
+
+#include "instrumentation.h"
+
+#ifdef ENABLE_INSTRUMENTATION
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef __arm__
+#include "em_device.h"
+#else
+#include <time.h>
+#endif
+
+/* Useful macros */
+
+#define MIN(a, b)                       ((a) < (b) ? (a) : (b))
+#define MAX(a, b)                       ((a) > (b) ? (a) : (b))
+
+/* Section counter structure */
+
+typedef struct {
+    uint32_t count;
+    uint32_t minimum;
+    uint32_t maximum;
+    uint64_t total;
+} sectionCounter_t;
+
+static sectionCounter_t counters[NUMBER_OF_INSTRUMENTATION_SECTIONS];
+
+/* Section names */
+
+static const char *sectionNames[NUMBER_OF_INSTRUMENTATION_SECTIONS] = {"ISR", "FILTER", "TRIGGER", "WRITE", "SLEEP"};
+
+/* Public functions */
+
+void Instrumentation_reset() {
+
+    #ifdef __arm__
+
+    /* Enable the DWT cycle counter */
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+
+    DWT->CYCCNT = 0;
+
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    #endif
+
+    memset(counters, 0, sizeof(counters));
+
+}
+
+uint32_t Instrumentation_getCycles() {
+
+    #ifdef __arm__
+
+    return DWT->CYCCNT;
+
+    #else
+
+    /* Stub timer for the host build */
+
+    return (uint32_t)clock();
+
+    #endif
+
+}
+
+void Instrumentation_addMeasurement(AM_instrumentationSection_t section, uint32_t value) {
+
+    sectionCounter_t *counter = counters + section;
+
+    counter->minimum = counter->count == 0 ? value : MIN(counter->minimum, value);
+
+    counter->maximum = MAX(counter->maximum, value);
+
+    counter->total += value;
+
+    counter->count += 1;
+
+}
+
+uint32_t Instrumentation_writeSummary(char *buffer, char *separator) {
+
+    uint32_t length = 0;
+
+    for (uint32_t i = 0; i < NUMBER_OF_INSTRUMENTATION_SECTIONS; i += 1) {
+
+        sectionCounter_t *counter = counters + i;
+
+        uint32_t mean = counter->count == 0 ? 0 : (uint32_t)((counter->total + counter->count / 2) / counter->count);
+
+        length += sprintf(buffer + length, "%s%s %lu/%lu/%lu", i == 0 ? "" : separator, sectionNames[i], counter->minimum, mean, counter->maximum);
+
+    }
+
+    return length;
+
+}
+
+#endif
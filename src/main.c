@@ -16,6 +16,9 @@
 #include "audiomoth.h"
 #include "audioconfig.h"
 #include "digitalfilter.h"
+#include "flac.h"
+#include "adpcm.h"
+#include "instrumentation.h"
 
 /* Useful time constants */
 
@@ -68,14 +71,39 @@
 #define EXTERNAL_SRAM_SIZE_IN_SAMPLES           (AM_EXTERNAL_SRAM_SIZE_IN_BYTES / NUMBER_OF_BYTES_IN_SAMPLE)
 #define NUMBER_OF_SAMPLES_IN_BUFFER             (EXTERNAL_SRAM_SIZE_IN_SAMPLES / NUMBER_OF_BUFFERS)
 
-/* DMA transfer constant */
+/* AudioMoth_writeToFile takes a 16-bit length, so coalesced writes are split into the largest whole number of SD card sectors which fits */
+
+#define SD_CARD_SECTOR_SIZE_IN_BYTES            512
+#define MAXIMUM_NUMBER_OF_BYTES_IN_WRITE        (UINT16_MAX / SD_CARD_SECTOR_SIZE_IN_BYTES * SD_CARD_SECTOR_SIZE_IN_BYTES)
+
+_Static_assert(MAXIMUM_NUMBER_OF_BYTES_IN_WRITE <= UINT16_MAX, "Each SD card write must fit in the 16-bit length of AudioMoth_writeToFile");
+
+/* Pre-trigger buffers are held by the main loop, so leave the buffer being filled and two more free to absorb SD card write delays */
+
+#define MINIMUM_NUMBER_OF_FREE_BUFFERS          3
+#define MAXIMUM_NUMBER_OF_PRE_TRIGGER_BUFFERS   (NUMBER_OF_BUFFERS - MINIMUM_NUMBER_OF_FREE_BUFFERS - 1)
+
+/* Trigger attack constant. The attack duration is set in steps of 10ms and rounded up to whole trigger evaluations */
+
+#define TRIGGER_ATTACK_DURATION_STEP_MS         10
+
+/* DMA transfer constants. The number of DMA buffers must be a power of two and at least two */
 
 #define MAXIMUM_SAMPLES_IN_DMA_TRANSFER         1024
+#define NUMBER_OF_DMA_BUFFERS                   4
 
 /* Compression constants */
 
 #define COMPRESSION_BUFFER_SIZE_IN_BYTES        512
 
+/* GUANO constant. The instrumentation summary needs additional space */
+
+#ifdef ENABLE_INSTRUMENTATION
+#define GUANO_BUFFER_SIZE_IN_BYTES              1024
+#else
+#define GUANO_BUFFER_SIZE_IN_BYTES              768
+#endif
+
 /* File size constants */
 
 #define MAXIMUM_FILE_NAME_LENGTH                64
@@ -90,10 +118,16 @@
 /* WAV header constant */
 
 #define PCM_FORMAT                              1
+#define IMA_ADPCM_FORMAT                        0x11
 #define RIFF_ID_LENGTH                          4
 #define LENGTH_OF_ARTIST                        32
 #define LENGTH_OF_COMMENT                       384
 
+/* The header is padded with a JUNK chunk so the audio data starts on an SD card sector boundary */
+
+#define WAV_HEADER_SIZE                         512
+#define LENGTH_OF_WAV_HEADER_PADDING            16
+
 /* USB configuration constant */
 
 #define MAX_RECORDING_PERIODS                   5
@@ -140,14 +174,23 @@
 #define GPS_FREQUENCY_PRECISION                 1000
 #define GPS_FILENAME                            "GPS.TXT"
 
+/* SD card statistics constants */
+
+#define NUMBER_OF_LATENCY_BUCKETS               10
+#define STATISTICS_BUFFER_LENGTH                256
+#define STATISTICS_FILENAME                     "STATS.CSV"
+#define INSTRUMENTATION_FILENAME                "CYCLES.CSV"
+
 /* Magnetic switch constants */
 
 #define MAGNETIC_SWITCH_WAIT_MULTIPLIER         2
 #define MAGNETIC_SWITCH_CHANGE_FLASHES          10
 
-/* USB configuration constant */
+/* USB configuration constants. The first byte of each packet is the message type. Extended settings packets start with a marker in place of the configuration time */
 
 #define USB_CONFIG_TIME_CORRECTION              26
+#define USB_PACKET_PAYLOAD_SIZE                 63
+#define EXTENDED_SETTINGS_PACKET_MARKER         UINT32_MAX
 
 /* Recording preparation constants */
 
@@ -160,11 +203,35 @@
 
 #define ENERGY_SAVER_SAMPLE_RATE_THRESHOLD      48000
 
+/* Automatic energy saver mode constants. Processing costs are the largest cycle counts reported by the cost model section of host/benchmark over five runs. The SD card transfer cost cannot be measured on the host and is an estimate */
+
+#define FULL_SPEED_CLOCK_FREQUENCY              48000000
+#define ENERGY_SAVER_MAXIMUM_LOAD_PERCENTAGE    50
+
+#define DMA_INTERRUPT_CYCLES                    23
+#define DECIMATION_CYCLES_PER_RAW_SAMPLE        28
+#define FILTER_CYCLES_PER_SAMPLE                10
+#define FILTER_CYCLES_PER_SECTION               6
+#define AMPLITUDE_THRESHOLD_CYCLES_PER_SAMPLE   1
+#define FREQUENCY_TRIGGER_CYCLES_PER_SAMPLE     5
+#define SPECTRAL_TRIGGER_CYCLES_PER_SAMPLE      34
+#define FLAC_CYCLES_PER_SAMPLE                  62
+#define IMA_ADPCM_CYCLES_PER_SAMPLE             29
+#define SD_CARD_CYCLES_PER_BYTE                 16
+
 /* Frequency trigger constants */
 
 #define FREQUENCY_TRIGGER_WINDOW_MINIMUM        16
 #define FREQUENCY_TRIGGER_WINDOW_MAXIMUM        1024
 
+#define MAXIMUM_ADDITIONAL_FREQUENCY_TRIGGERS   7
+
+#define SPECTRAL_TRIGGER_WINDOW_MINIMUM         256
+
+/* Event file constant */
+
+#define MINIMUM_EVENT_FILE_HOLD_OFF             1
+
 /* Sunrise and sunset recording constants */
 
 #define MINIMUM_SUN_RECORDING_GAP               60
@@ -237,7 +304,7 @@
 
 /* Recording state enumeration */
 
-typedef enum {RECORDING_OKAY, FILE_SIZE_LIMITED, SUPPLY_VOLTAGE_LOW, SWITCH_CHANGED, MICROPHONE_CHANGED, MAGNETIC_SWITCH, SDCARD_WRITE_ERROR} AM_recordingState_t;
+typedef enum {RECORDING_OKAY, FILE_SIZE_LIMITED, SUPPLY_VOLTAGE_LOW, SWITCH_CHANGED, MICROPHONE_CHANGED, MAGNETIC_SWITCH, SDCARD_WRITE_ERROR, BUFFER_OVERRUN} AM_recordingState_t;
 
 /* Filter type enumeration */
 
@@ -247,6 +314,28 @@ typedef enum {NO_FILTER, LOW_PASS_FILTER, BAND_PASS_FILTER, HIGH_PASS_FILTER} AM
 
 typedef enum {BATTERY_LEVEL, NIMH_LIPO_BATTERY_VOLTAGE} AM_batteryLevelDisplayType_t;
 
+/* Buffer overrun policy enumeration */
+
+typedef enum {DROP_OLDEST_BUFFER, DROP_NEWEST_BUFFER, STOP_RECORDING_ON_OVERRUN} AM_bufferOverrunPolicy_t;
+
+/* Trigger state enumeration */
+
+typedef enum {TRIGGER_IDLE, TRIGGER_ATTACK, TRIGGER_ACTIVE, TRIGGER_RELEASE} AM_triggerState_t;
+
+/* File format enumeration */
+
+typedef enum {WAV_FILE_FORMAT, FLAC_FILE_FORMAT, IMA_ADPCM_FILE_FORMAT} AM_fileFormat_t;
+
+/* SD card statistics structure. Latency bucket zero counts operations under 1ms and bucket n counts those from 2^(n - 1)ms */
+
+typedef struct {
+    uint32_t numberOfOperations;
+    uint32_t numberOfBytesWritten;
+    uint32_t maximumLatency;
+    uint32_t peakBufferOccupancy;
+    uint32_t latencyHistogram[NUMBER_OF_LATENCY_BUCKETS];
+} fileStatistics_t;
+
 /* Sun recording mode enumeration */
 
 typedef enum {SUNRISE_RECORDING, SUNSET_RECORDING, SUNRISE_AND_SUNSET_RECORDING, SUNSET_TO_SUNRISE_RECORDING, SUNRISE_TO_SUNSET_RECORDING} AM_sunRecordingMode_t;
@@ -292,11 +381,38 @@ typedef struct {
     char info[RIFF_ID_LENGTH];
     icmt_t icmt;
     iart_t iart;
+    chunk_t junk;
+    char padding[LENGTH_OF_WAV_HEADER_PADDING];
     chunk_t data;
 } wavHeader_t;
 
+typedef struct {
+    wavFormat_t wavFormat;
+    uint16_t extraFormatSize;
+    uint16_t samplesPerBlock;
+} imaAdpcmFormat_t;
+
+typedef struct {
+    chunk_t riff;
+    char format[RIFF_ID_LENGTH];
+    chunk_t fmt;
+    imaAdpcmFormat_t imaAdpcmFormat;
+    chunk_t fact;
+    uint32_t numberOfSamples;
+    chunk_t list;
+    char info[RIFF_ID_LENGTH];
+} imaAdpcmHeader_t;
+
 #pragma pack(pop)
 
+_Static_assert(sizeof(wavHeader_t) == WAV_HEADER_SIZE, "The WAV header must fill a single SD card sector");
+
+/* The IMA-ADPCM header takes the comment and artist chunks from the WAV header and needs its own padding */
+
+#define LENGTH_OF_IMA_ADPCM_HEADER_PADDING      (WAV_HEADER_SIZE - sizeof(imaAdpcmHeader_t) - sizeof(icmt_t) - sizeof(iart_t) - 2 * sizeof(chunk_t))
+
+_Static_assert(LENGTH_OF_IMA_ADPCM_HEADER_PADDING <= LENGTH_OF_WAV_HEADER_PADDING, "The IMA-ADPCM header must fill a single SD card sector");
+
 static wavHeader_t wavHeader = {
     .riff = {.id = "RIFF", .size = 0},
     .format = "WAVE",
@@ -306,9 +422,26 @@ static wavHeader_t wavHeader = {
     .info = "INFO",
     .icmt = {.icmt.id = "ICMT", .icmt.size = LENGTH_OF_COMMENT, .comment = ""},
     .iart = {.iart.id = "IART", .iart.size = LENGTH_OF_ARTIST, .artist = ""},
+    .junk = {.id = "JUNK", .size = LENGTH_OF_WAV_HEADER_PADDING},
+    .padding = "",
     .data = {.id = "data", .size = 0}
 };
 
+/* The IMA-ADPCM header is followed by the comment and artist chunks of the WAV header, its own padding chunk and the data chunk of the WAV header */
+
+static imaAdpcmHeader_t imaAdpcmHeader = {
+    .riff = {.id = "RIFF", .size = 0},
+    .format = "WAVE",
+    .fmt = {.id = "fmt ", .size = sizeof(imaAdpcmFormat_t)},
+    .imaAdpcmFormat = {.wavFormat = {.format = IMA_ADPCM_FORMAT, .numberOfChannels = 1, .samplesPerSecond = 0, .bytesPerSecond = 0, .bytesPerCapture = ADPCM_BLOCK_SIZE, .bitsPerSample = 4}, .extraFormatSize = 2, .samplesPerBlock = ADPCM_SAMPLES_PER_BLOCK},
+    .fact = {.id = "fact", .size = sizeof(uint32_t)},
+    .numberOfSamples = 0,
+    .list = {.id = "LIST", .size = RIFF_ID_LENGTH + sizeof(icmt_t) + sizeof(iart_t)},
+    .info = "INFO"
+};
+
+static chunk_t imaAdpcmPaddingChunk = {.id = "JUNK", .size = LENGTH_OF_IMA_ADPCM_HEADER_PADDING};
+
 /* USB configuration data structure */
 
 #pragma pack(push, 1)
@@ -318,6 +451,12 @@ typedef struct {
     uint16_t endMinutes;
 } recordingPeriod_t;
 
+typedef struct {
+    uint16_t centreFrequency;
+    uint8_t thresholdPercentageMantissa : 4;
+    int8_t thresholdPercentageExponent : 3;
+} frequencyTrigger_t;
+
 typedef struct {
     uint32_t time;
     AM_gainSetting_t gain;
@@ -387,10 +526,38 @@ typedef struct {
     uint8_t enableFrequencyTrigger : 1;
     uint8_t enableDailyFolders : 1;
     uint8_t enableSunRecording : 1;
+    AM_bufferOverrunPolicy_t bufferOverrunPolicy : 2;
+    uint8_t enableFixedPointFilter : 1;
+    uint8_t filterOrder : 2;
+    uint8_t preTriggerBuffers : 3;
 } configSettings_t;
 
+/* Extended configuration settings which do not fit in the configuration packet and follow it in a second packet */
+
+typedef struct {
+    frequencyTrigger_t additionalFrequencyTriggers[MAXIMUM_ADDITIONAL_FREQUENCY_TRIGGERS];
+    uint8_t enableSpectralTrigger : 1;
+    uint8_t spectralTriggerRatioDecibels : 7;
+    uint16_t spectralTriggerBandwidth;
+    uint8_t enableAdaptiveAmplitudeThreshold : 1;
+    uint8_t adaptiveAmplitudeThresholdMarginDecibels : 7;
+    uint8_t triggerAttackDuration : 4;
+    uint8_t triggerHysteresisDecibels : 4;
+    uint8_t enableEventFiles : 1;
+    uint8_t eventFileHoldOff : 6;
+    AM_fileFormat_t fileFormat : 2;
+    uint8_t enableFilePreallocation : 1;
+    uint8_t enableDeferredProcessing : 1;
+    uint8_t enableAutomaticEnergySaverMode : 1;
+    uint8_t energySaverModeSelected : 1;
+} extendedConfigSettings_t;
+
 #pragma pack(pop)
 
+_Static_assert(sizeof(configSettings_t) <= USB_PACKET_PAYLOAD_SIZE, "Configuration settings must fit in a single USB packet");
+
+_Static_assert(sizeof(extendedConfigSettings_t) <= USB_PACKET_PAYLOAD_SIZE - UINT32_SIZE_IN_BYTES, "Extended configuration settings must fit in a single USB packet after the marker");
+
 static const configSettings_t defaultConfigSettings = {
     .time = 0,
     .gain = AM_GAIN_MEDIUM,
@@ -438,7 +605,37 @@ static const configSettings_t defaultConfigSettings = {
     .enableLowGainRange = 0,
     .enableFrequencyTrigger = 0,
     .enableDailyFolders = 0,
-    .enableSunRecording = 0
+    .enableSunRecording = 0,
+    .bufferOverrunPolicy = DROP_OLDEST_BUFFER,
+    .enableFixedPointFilter = 0,
+    .filterOrder = 0,
+    .preTriggerBuffers = 0
+};
+
+static const extendedConfigSettings_t defaultExtendedConfigSettings = {
+    .additionalFrequencyTriggers = {
+        {.centreFrequency = 0, .thresholdPercentageMantissa = 0, .thresholdPercentageExponent = 0},
+        {.centreFrequency = 0, .thresholdPercentageMantissa = 0, .thresholdPercentageExponent = 0},
+        {.centreFrequency = 0, .thresholdPercentageMantissa = 0, .thresholdPercentageExponent = 0},
+        {.centreFrequency = 0, .thresholdPercentageMantissa = 0, .thresholdPercentageExponent = 0},
+        {.centreFrequency = 0, .thresholdPercentageMantissa = 0, .thresholdPercentageExponent = 0},
+        {.centreFrequency = 0, .thresholdPercentageMantissa = 0, .thresholdPercentageExponent = 0},
+        {.centreFrequency = 0, .thresholdPercentageMantissa = 0, .thresholdPercentageExponent = 0}
+    },
+    .enableSpectralTrigger = 0,
+    .spectralTriggerRatioDecibels = 0,
+    .spectralTriggerBandwidth = 0,
+    .enableAdaptiveAmplitudeThreshold = 0,
+    .adaptiveAmplitudeThresholdMarginDecibels = 0,
+    .triggerAttackDuration = 0,
+    .triggerHysteresisDecibels = 0,
+    .enableEventFiles = 0,
+    .eventFileHoldOff = 0,
+    .fileFormat = WAV_FILE_FORMAT,
+    .enableFilePreallocation = 0,
+    .enableDeferredProcessing = 0,
+    .enableAutomaticEnergySaverMode = 0,
+    .energySaverModeSelected = 0
 };
 
 /* Persistent configuration data structure */
@@ -449,6 +646,7 @@ typedef struct {
     uint8_t firmwareVersion[AM_FIRMWARE_VERSION_LENGTH];
     uint8_t firmwareDescription[AM_FIRMWARE_DESCRIPTION_LENGTH];
     configSettings_t configSettings;
+    extendedConfigSettings_t extendedConfigSettings;
 } persistentConfigSettings_t;
 
 #pragma pack(pop)
@@ -464,11 +662,107 @@ typedef struct {
 
 #pragma pack(pop)
 
-/* Function to select energy saver mode */
+/* Function to determine the order of the user filter with zero selecting the default filter */
+
+static uint32_t getFilterOrder(configSettings_t *configSettings) {
+
+    bool filterEnabled = configSettings->lowerFilterFreq > 0 || configSettings->higherFilterFreq > 0;
+
+    return filterEnabled && configSettings->filterOrder > 0 ? 2 + 2 * configSettings->filterOrder : 0;
 
-static bool isEnergySaverMode(configSettings_t *configSettings) {
+}
+
+/* Function to estimate the processing cycles per second needed by a configuration at full clock speed */
+
+static uint64_t estimateProcessingCyclesPerSecond(configSettings_t *configSettings, extendedConfigSettings_t *extendedConfigSettings) {
+
+    uint32_t effectiveSampleRate = configSettings->sampleRate / configSettings->sampleRateDivider;
+
+    /* Decimation of every raw sample when the sample rate is divided and the fixed cost of each DMA interrupt */
+
+    uint64_t cycles = configSettings->sampleRate / MAXIMUM_SAMPLES_IN_DMA_TRANSFER * DMA_INTERRUPT_CYCLES;
+
+    if (configSettings->sampleRateDivider > 1) cycles += (uint64_t)configSettings->sampleRate * DECIMATION_CYCLES_PER_RAW_SAMPLE;
+
+    /* Filtering of every output sample with additional sections for higher order filters */
+
+    uint32_t cyclesPerSample = FILTER_CYCLES_PER_SAMPLE + getFilterOrder(configSettings) / 2 * FILTER_CYCLES_PER_SECTION;
+
+    /* Trigger evaluation */
+
+    bool amplitudeThresholdEnabled = configSettings->amplitudeThreshold > 0 || configSettings->enableAmplitudeThresholdDecibelScale || configSettings->enableAmplitudeThresholdPercentageScale || extendedConfigSettings->enableAdaptiveAmplitudeThreshold;
+
+    if (configSettings->enableFrequencyTrigger && extendedConfigSettings->enableSpectralTrigger) {
+
+        cyclesPerSample += SPECTRAL_TRIGGER_CYCLES_PER_SAMPLE;
+
+    } else if (configSettings->enableFrequencyTrigger) {
+
+        uint32_t numberOfFrequencyTriggers = 1;
+
+        for (uint32_t i = 0; i < MAXIMUM_ADDITIONAL_FREQUENCY_TRIGGERS; i += 1) {
+
+            if (extendedConfigSettings->additionalFrequencyTriggers[i].centreFrequency > 0) numberOfFrequencyTriggers += 1;
+
+        }
+
+        cyclesPerSample += numberOfFrequencyTriggers * FREQUENCY_TRIGGER_CYCLES_PER_SAMPLE;
+
+    } else if (amplitudeThresholdEnabled) {
+
+        cyclesPerSample += AMPLITUDE_THRESHOLD_CYCLES_PER_SAMPLE;
+
+    }
+
+    /* Encoding and writing to the SD card assuming every buffer is written */
+
+    if (extendedConfigSettings->fileFormat == FLAC_FILE_FORMAT) {
+
+        cyclesPerSample += FLAC_CYCLES_PER_SAMPLE + NUMBER_OF_BYTES_IN_SAMPLE * SD_CARD_CYCLES_PER_BYTE;
+
+    } else if (extendedConfigSettings->fileFormat == IMA_ADPCM_FILE_FORMAT) {
+
+        cyclesPerSample += IMA_ADPCM_CYCLES_PER_SAMPLE + SD_CARD_CYCLES_PER_BYTE;
+
+    } else {
+
+        cyclesPerSample += NUMBER_OF_BYTES_IN_SAMPLE * SD_CARD_CYCLES_PER_BYTE;
+
+    }
+
+    cycles += (uint64_t)effectiveSampleRate * cyclesPerSample;
+
+    return cycles;
+
+}
+
+/* Function to decide whether energy saver mode should be used when the configuration is received */
+
+static bool selectEnergySaverMode(configSettings_t *configSettings, extendedConfigSettings_t *extendedConfigSettings) {
+
+    uint32_t effectiveSampleRate = configSettings->sampleRate / configSettings->sampleRateDivider;
+
+    if (configSettings->enableEnergySaverMode) return effectiveSampleRate <= ENERGY_SAVER_SAMPLE_RATE_THRESHOLD;
+
+    if (extendedConfigSettings->enableAutomaticEnergySaverMode == false) return false;
+
+    /* The sample rate, clock divider and sample rate divider must all halve exactly */
+
+    if (configSettings->sampleRate % 2 || configSettings->clockDivider % 2 || configSettings->sampleRateDivider % 2) return false;
 
-    return configSettings->enableEnergySaverMode && configSettings->sampleRate / configSettings->sampleRateDivider <= ENERGY_SAVER_SAMPLE_RATE_THRESHOLD;
+    /* Halve the clock if the estimated load at half clock speed stays within the safety margin */
+
+    uint64_t availableCycles = (uint64_t)FULL_SPEED_CLOCK_FREQUENCY / 2 * ENERGY_SAVER_MAXIMUM_LOAD_PERCENTAGE / 100;
+
+    return estimateProcessingCyclesPerSecond(configSettings, extendedConfigSettings) <= availableCycles;
+
+}
+
+/* Function to select energy saver mode using the decision made when the configuration was received */
+
+static bool isEnergySaverMode(extendedConfigSettings_t *extendedConfigSettings) {
+
+    return extendedConfigSettings->energySaverModeSelected;
 
 }
 
@@ -509,7 +803,17 @@ static void setHeaderDetails(wavHeader_t *wavHeader, uint32_t sampleRate, uint32
 
 }
 
-static void setHeaderComment(wavHeader_t *wavHeader, configSettings_t *configSettings, uint32_t currentTime, uint8_t *serialNumber, uint8_t *deploymentID, uint8_t *defaultDeploymentID, AM_extendedBatteryState_t extendedBatteryState, int32_t temperature, bool externalMicrophone, AM_recordingState_t recordingState, AM_filterType_t filterType) {
+static void setImaAdpcmHeaderDetails(imaAdpcmHeader_t *imaAdpcmHeader, wavHeader_t *wavHeader, uint32_t sampleRate, uint32_t numberOfSamples, uint32_t numberOfBytes, uint32_t guanoHeaderSize) {
+
+    imaAdpcmHeader->imaAdpcmFormat.wavFormat.samplesPerSecond = sampleRate;
+    imaAdpcmHeader->imaAdpcmFormat.wavFormat.bytesPerSecond = ROUNDED_DIV(sampleRate * ADPCM_BLOCK_SIZE, ADPCM_SAMPLES_PER_BLOCK);
+    imaAdpcmHeader->numberOfSamples = numberOfSamples;
+    wavHeader->data.size = numberOfBytes;
+    imaAdpcmHeader->riff.size = numberOfBytes + WAV_HEADER_SIZE + guanoHeaderSize - sizeof(chunk_t);
+
+}
+
+static void setHeaderComment(wavHeader_t *wavHeader, configSettings_t *configSettings, extendedConfigSettings_t *extendedConfigSettings, uint32_t currentTime, uint8_t *serialNumber, uint8_t *deploymentID, uint8_t *defaultDeploymentID, AM_extendedBatteryState_t extendedBatteryState, int32_t temperature, bool externalMicrophone, AM_recordingState_t recordingState, AM_filterType_t filterType, uint32_t numberOfDroppedBuffers) {
 
     struct tm time;
 
@@ -601,9 +905,15 @@ static void setHeaderComment(wavHeader_t *wavHeader, configSettings_t *configSet
     
     bool frequencyTriggerEnabled = configSettings->enableFrequencyTrigger;
 
-    bool amplitudeThresholdEnabled = frequencyTriggerEnabled ? false : configSettings->amplitudeThreshold > 0 || configSettings->enableAmplitudeThresholdDecibelScale || configSettings->enableAmplitudeThresholdPercentageScale;
+    bool amplitudeThresholdEnabled = frequencyTriggerEnabled ? false : configSettings->amplitudeThreshold > 0 || configSettings->enableAmplitudeThresholdDecibelScale || configSettings->enableAmplitudeThresholdPercentageScale || extendedConfigSettings->enableAdaptiveAmplitudeThreshold;
+
+    if (frequencyTriggerEnabled && extendedConfigSettings->enableSpectralTrigger) {
 
-    if (frequencyTriggerEnabled) {
+        comment += sprintf(comment, " Spectral trigger (%u.%ukHz with %u.%ukHz bandwidth and window length of %u samples) threshold was %udB", configSettings->frequencyTriggerCentreFrequency / 10, configSettings->frequencyTriggerCentreFrequency % 10, extendedConfigSettings->spectralTriggerBandwidth / 10, extendedConfigSettings->spectralTriggerBandwidth % 10, (0x01 << configSettings->frequencyTriggerWindowLengthShift), extendedConfigSettings->spectralTriggerRatioDecibels);
+
+        comment += sprintf(comment, " with %us minimum trigger duration.", configSettings->minimumTriggerDuration);
+
+    } else if (frequencyTriggerEnabled) {
 
         comment += sprintf(comment, " Frequency trigger (%u.%ukHz and window length of %u samples) threshold was ", configSettings->frequencyTriggerCentreFrequency / 10, configSettings->frequencyTriggerCentreFrequency % 10, (0x01 << configSettings->frequencyTriggerWindowLengthShift));
 
@@ -617,17 +927,31 @@ static void setHeaderComment(wavHeader_t *wavHeader, configSettings_t *configSet
 
     uint16_t higherFilterFreq = configSettings->higherFilterFreq;
 
+    char filterOrderText[16];
+
+    uint32_t filterOrder = getFilterOrder(configSettings);
+
+    if (filterOrder > 0) {
+
+        sprintf(filterOrderText, " (%luth order)", filterOrder);
+
+    } else {
+
+        filterOrderText[0] = 0;
+
+    }
+
     if (filterType == LOW_PASS_FILTER) {
 
-        comment += sprintf(comment, " Low-pass filter with frequency of %01u.%01ukHz applied.", higherFilterFreq / 10, higherFilterFreq % 10);
+        comment += sprintf(comment, " Low-pass filter%s with frequency of %01u.%01ukHz applied.", filterOrderText, higherFilterFreq / 10, higherFilterFreq % 10);
 
     } else if (filterType == BAND_PASS_FILTER) {
 
-        comment += sprintf(comment, " Band-pass filter with frequencies of %01u.%01ukHz and %01u.%01ukHz applied.", lowerFilterFreq / 10, lowerFilterFreq % 10, higherFilterFreq / 10, higherFilterFreq % 10);
+        comment += sprintf(comment, " Band-pass filter%s with frequencies of %01u.%01ukHz and %01u.%01ukHz applied.", filterOrderText, lowerFilterFreq / 10, lowerFilterFreq % 10, higherFilterFreq / 10, higherFilterFreq % 10);
 
     } else if (filterType == HIGH_PASS_FILTER) {
 
-        comment += sprintf(comment, " High-pass filter with frequency of %01u.%01ukHz applied.", lowerFilterFreq / 10, lowerFilterFreq % 10);
+        comment += sprintf(comment, " High-pass filter%s with frequency of %01u.%01ukHz applied.", filterOrderText, lowerFilterFreq / 10, lowerFilterFreq % 10);
 
     }
 
@@ -649,10 +973,18 @@ static void setHeaderComment(wavHeader_t *wavHeader, configSettings_t *configSet
 
         }
 
+        if (extendedConfigSettings->enableAdaptiveAmplitudeThreshold) comment += sprintf(comment, " adapting at %udB above the noise floor", extendedConfigSettings->adaptiveAmplitudeThresholdMarginDecibels);
+
         comment += sprintf(comment, " with %us minimum trigger duration.", configSettings->minimumTriggerDuration);
 
     }
 
+    if (numberOfDroppedBuffers > 0) {
+
+        comment += sprintf(comment, " %lu buffer%s dropped due to slow SD card writes.", numberOfDroppedBuffers, numberOfDroppedBuffers == 1 ? "" : "s");
+
+    }
+
     if (recordingState != RECORDING_OKAY) {
 
         comment += sprintf(comment, " Recording stopped");
@@ -681,6 +1013,10 @@ static void setHeaderComment(wavHeader_t *wavHeader, configSettings_t *configSet
 
             comment += sprintf(comment, " due to SD card write error.");
 
+        } else if (recordingState == BUFFER_OVERRUN) {
+
+            comment += sprintf(comment, " due to buffer overrun.");
+
         }
 
     }
@@ -689,7 +1025,7 @@ static void setHeaderComment(wavHeader_t *wavHeader, configSettings_t *configSet
 
 /* Function to write the GUANO data */
 
-static uint32_t writeGuanoData(char *buffer, configSettings_t *configSettings, uint32_t currentTime, bool gpsLocationReceived, int32_t *gpsLastFixLatitude, int32_t *gpsLastFixLongitude, bool acousticLocationReceived, int32_t *acousticLatitude, int32_t *acousticLongitude, uint8_t *firmwareDescription, uint8_t *firmwareVersion, uint8_t *serialNumber, uint8_t *deploymentID, uint8_t *defaultDeploymentID, char *filename, AM_extendedBatteryState_t extendedBatteryState, int32_t temperature, AM_filterType_t filterType) {
+static uint32_t writeGuanoData(char *buffer, configSettings_t *configSettings, extendedConfigSettings_t *extendedConfigSettings, uint32_t currentTime, uint32_t currentMilliseconds, bool gpsLocationReceived, int32_t *gpsLastFixLatitude, int32_t *gpsLastFixLongitude, bool acousticLocationReceived, int32_t *acousticLatitude, int32_t *acousticLongitude, uint8_t *firmwareDescription, uint8_t *firmwareVersion, uint8_t *serialNumber, uint8_t *deploymentID, uint8_t *defaultDeploymentID, char *filename, AM_extendedBatteryState_t extendedBatteryState, int32_t temperature, AM_filterType_t filterType, uint32_t numberOfDroppedBuffers, fileStatistics_t *fileStatistics) {
 
     uint32_t length = sprintf(buffer, "guan") + UINT32_SIZE_IN_BYTES;
 
@@ -717,6 +1053,8 @@ static uint32_t writeGuanoData(char *buffer, configSettings_t *configSettings, u
 
     length += sprintf(buffer + length, "Timestamp:%04d-%02d-%02dT%02d:%02d:%02d", YEAR_OFFSET + time.tm_year, MONTH_OFFSET + time.tm_mon, time.tm_mday, time.tm_hour, time.tm_min, time.tm_sec);
 
+    if (currentMilliseconds > 0) length += sprintf(buffer + length, ".%03lu", currentMilliseconds);
+
     if (timezoneOffset == 0) {
 
         length += sprintf(buffer + length, "Z\n");
@@ -771,9 +1109,13 @@ static uint32_t writeGuanoData(char *buffer, configSettings_t *configSettings, u
 
     bool frequencyTriggerEnabled = configSettings->enableFrequencyTrigger;
 
-    bool amplitudeThresholdEnabled = frequencyTriggerEnabled ? false : configSettings->amplitudeThreshold > 0 || configSettings->enableAmplitudeThresholdDecibelScale || configSettings->enableAmplitudeThresholdPercentageScale;
+    bool amplitudeThresholdEnabled = frequencyTriggerEnabled ? false : configSettings->amplitudeThreshold > 0 || configSettings->enableAmplitudeThresholdDecibelScale || configSettings->enableAmplitudeThresholdPercentageScale || extendedConfigSettings->enableAdaptiveAmplitudeThreshold;
 
-    if (frequencyTriggerEnabled) {
+    if (frequencyTriggerEnabled && extendedConfigSettings->enableSpectralTrigger) {
+
+        length += sprintf(buffer + length, " SPEC %u %u %u %udB %u", FILTER_FREQ_MULTIPLIER * configSettings->frequencyTriggerCentreFrequency, FILTER_FREQ_MULTIPLIER * extendedConfigSettings->spectralTriggerBandwidth, 0x01 << configSettings->frequencyTriggerWindowLengthShift, extendedConfigSettings->spectralTriggerRatioDecibels, configSettings->minimumTriggerDuration);
+
+    } else if (frequencyTriggerEnabled) {
 
         length += sprintf(buffer + length, " FREQ %u %u ", FILTER_FREQ_MULTIPLIER * configSettings->frequencyTriggerCentreFrequency, 0x01 << configSettings->frequencyTriggerWindowLengthShift);
 
@@ -781,8 +1123,24 @@ static uint32_t writeGuanoData(char *buffer, configSettings_t *configSettings, u
 
         length += sprintf(buffer + length, " %u", configSettings->minimumTriggerDuration);
 
+        for (uint32_t i = 0; i < MAXIMUM_ADDITIONAL_FREQUENCY_TRIGGERS; i += 1) {
+
+            frequencyTrigger_t *frequencyTrigger = extendedConfigSettings->additionalFrequencyTriggers + i;
+
+            if (frequencyTrigger->centreFrequency == 0) continue;
+
+            length += sprintf(buffer + length, " BIN %u ", FILTER_FREQ_MULTIPLIER * frequencyTrigger->centreFrequency);
+
+            length += formatPercentage(buffer + length, frequencyTrigger->thresholdPercentageMantissa, frequencyTrigger->thresholdPercentageExponent);
+
+        }
+
     }
 
+    if (frequencyTriggerEnabled && configSettings->preTriggerBuffers > 0) length += sprintf(buffer + length, " PRE %u", MIN(MAXIMUM_NUMBER_OF_PRE_TRIGGER_BUFFERS, configSettings->preTriggerBuffers));
+
+    if (frequencyTriggerEnabled && (extendedConfigSettings->triggerAttackDuration > 0 || extendedConfigSettings->triggerHysteresisDecibels > 0)) length += sprintf(buffer + length, " HYS %ums %udB", TRIGGER_ATTACK_DURATION_STEP_MS * extendedConfigSettings->triggerAttackDuration, extendedConfigSettings->triggerHysteresisDecibels);
+
     uint32_t lowerFilterFreq = FILTER_FREQ_MULTIPLIER * configSettings->lowerFilterFreq;
 
     uint32_t higherFilterFreq = FILTER_FREQ_MULTIPLIER * configSettings->higherFilterFreq;
@@ -801,6 +1159,10 @@ static uint32_t writeGuanoData(char *buffer, configSettings_t *configSettings, u
 
     }
 
+    uint32_t filterOrder = getFilterOrder(configSettings);
+
+    if (filterType != NO_FILTER && filterOrder > 0) length += sprintf(buffer + length, " ORD %lu", filterOrder);
+
     if (amplitudeThresholdEnabled) {
 
         length += sprintf(buffer + length, " AMP ");
@@ -821,13 +1183,23 @@ static uint32_t writeGuanoData(char *buffer, configSettings_t *configSettings, u
         
         length += sprintf(buffer + length, " %u", configSettings->minimumTriggerDuration);
 
+        if (extendedConfigSettings->enableAdaptiveAmplitudeThreshold) length += sprintf(buffer + length, " ADP %udB", extendedConfigSettings->adaptiveAmplitudeThresholdMarginDecibels);
+
+        if (configSettings->preTriggerBuffers > 0) length += sprintf(buffer + length, " PRE %u", MIN(MAXIMUM_NUMBER_OF_PRE_TRIGGER_BUFFERS, configSettings->preTriggerBuffers));
+
+        if (extendedConfigSettings->triggerAttackDuration > 0 || extendedConfigSettings->triggerHysteresisDecibels > 0) length += sprintf(buffer + length, " HYS %ums %udB", TRIGGER_ATTACK_DURATION_STEP_MS * extendedConfigSettings->triggerAttackDuration, extendedConfigSettings->triggerHysteresisDecibels);
+
     }
 
+    if ((frequencyTriggerEnabled || amplitudeThresholdEnabled) && extendedConfigSettings->enableEventFiles) length += sprintf(buffer + length, " EVT %u", MAX(MINIMUM_EVENT_FILE_HOLD_OFF, extendedConfigSettings->eventFileHoldOff));
+
     if (configSettings->enableLowGainRange) length += sprintf(buffer + length, " LGR");
 
     if (configSettings->disable48HzDCBlockingFilter) length += sprintf(buffer + length, " D48");
 
-    if (isEnergySaverMode(configSettings)) length += sprintf(buffer + length, " ESM");
+    if (isEnergySaverMode(extendedConfigSettings)) length += sprintf(buffer + length, " ESM");
+
+    if (configSettings->enableFixedPointFilter) length += sprintf(buffer + length, " FXP");
 
     /* Battery and temperature */
 
@@ -841,6 +1213,26 @@ static uint32_t writeGuanoData(char *buffer, configSettings_t *configSettings, u
 
     length += sprintf(buffer + length, "Temperature Int:%s%lu.%lu", temperatureSign, temperatureInDecidegrees / 10, temperatureInDecidegrees % 10);
 
+    /* Dropped buffers */
+
+    if (numberOfDroppedBuffers > 0) length += sprintf(buffer + length, "\nOAD|Dropped Buffers:%lu", numberOfDroppedBuffers);
+
+    /* SD card statistics */
+
+    length += sprintf(buffer + length, "\nOAD|SD Card:OPS %lu BYTES %lu MAX %lums PEAK %lu HIST", fileStatistics->numberOfOperations, fileStatistics->numberOfBytesWritten, fileStatistics->maximumLatency, fileStatistics->peakBufferOccupancy);
+
+    for (uint32_t i = 0; i < NUMBER_OF_LATENCY_BUCKETS; i += 1) length += sprintf(buffer + length, " %lu", fileStatistics->latencyHistogram[i]);
+
+    /* Instrumentation summary */
+
+    #ifdef ENABLE_INSTRUMENTATION
+
+    length += sprintf(buffer + length, "\nOAD|Cycles:");
+
+    length += Instrumentation_writeSummary(buffer + length, " ");
+
+    #endif
+
     /* Set GUANO chunk size */
 
     *(uint32_t*)(buffer + RIFF_ID_LENGTH) = length - sizeof(chunk_t);;
@@ -851,7 +1243,7 @@ static uint32_t writeGuanoData(char *buffer, configSettings_t *configSettings, u
 
 /* Function to write configuration to file */
 
-static bool writeConfigurationToFile(configSettings_t *configSettings, uint32_t currentTime, bool gpsLocationReceived, int32_t *gpsLatitude, int32_t *gpsLongitude, bool acousticLocationReceived, int32_t *acousticLatitude, int32_t *acousticLongitude, uint8_t *firmwareDescription, uint8_t *firmwareVersion, uint8_t *serialNumber, uint8_t *deploymentID, uint8_t *defaultDeploymentID) {
+static bool writeConfigurationToFile(configSettings_t *configSettings, extendedConfigSettings_t *extendedConfigSettings, uint32_t currentTime, bool gpsLocationReceived, int32_t *gpsLatitude, int32_t *gpsLongitude, bool acousticLocationReceived, int32_t *acousticLatitude, int32_t *acousticLongitude, uint8_t *firmwareDescription, uint8_t *firmwareVersion, uint8_t *serialNumber, uint8_t *deploymentID, uint8_t *defaultDeploymentID) {
 
     static char configBuffer[CONFIG_BUFFER_LENGTH];
 
@@ -905,6 +1297,26 @@ static bool writeConfigurationToFile(configSettings_t *configSettings, uint32_t
 
     length = sprintf(configBuffer, "\r\n\r\nSample rate (Hz)                : %lu\r\n", configSettings->sampleRate / configSettings->sampleRateDivider);
 
+    uint32_t decimationFilterLength = DigitalFilter_getDecimationFilterLength(configSettings->sampleRateDivider);
+
+    length += sprintf(configBuffer + length, "Decimation filter               : ");
+
+    if (configSettings->sampleRateDivider == 1) {
+
+        length += sprintf(configBuffer + length, "-");
+
+    } else if (decimationFilterLength == 0) {
+
+        length += sprintf(configBuffer + length, "Boxcar sum of %u samples", configSettings->sampleRateDivider);
+
+    } else {
+
+        length += sprintf(configBuffer + length, "%lu-tap FIR (%lu multiply-accumulates per output sample, %lu per raw sample)", decimationFilterLength, decimationFilterLength, decimationFilterLength / configSettings->sampleRateDivider);
+
+    }
+
+    length += sprintf(configBuffer + length, "\r\n");
+
     static char *gainSettings[5] = {"Low", "Low-Medium", "Medium", "Medium-High", "High"};
 
     length += sprintf(configBuffer + length, "Gain                            : %s\r\n\r\n", gainSettings[configSettings->gain]);
@@ -1132,13 +1544,33 @@ static bool writeConfigurationToFile(configSettings_t *configSettings, uint32_t
 
     }
 
+    uint32_t filterOrder = getFilterOrder(configSettings);
+
+    length += sprintf(configBuffer + length, "\r\nFilter order                    : ");
+
+    if (filterOrder > 0) {
+
+        length += sprintf(configBuffer + length, "%lu", filterOrder);
+
+    } else {
+
+        length += sprintf(configBuffer + length, "-");
+
+    }
+
     bool frequencyTriggerEnabled = configSettings->enableFrequencyTrigger;
 
-    bool amplitudeThresholdEnabled = frequencyTriggerEnabled ? false : configSettings->amplitudeThreshold > 0 || configSettings->enableAmplitudeThresholdDecibelScale || configSettings->enableAmplitudeThresholdPercentageScale;
+    bool amplitudeThresholdEnabled = frequencyTriggerEnabled ? false : configSettings->amplitudeThreshold > 0 || configSettings->enableAmplitudeThresholdDecibelScale || configSettings->enableAmplitudeThresholdPercentageScale || extendedConfigSettings->enableAdaptiveAmplitudeThreshold;
 
     length += sprintf(configBuffer + length, "\r\n\r\nTrigger type                    : ");
 
-    if (frequencyTriggerEnabled) {
+    if (frequencyTriggerEnabled && extendedConfigSettings->enableSpectralTrigger) {
+
+        length += sprintf(configBuffer + length, "Spectral (%u.%ukHz with %u.%ukHz bandwidth and window length of %u samples)", configSettings->frequencyTriggerCentreFrequency / 10, configSettings->frequencyTriggerCentreFrequency % 10, extendedConfigSettings->spectralTriggerBandwidth / 10, extendedConfigSettings->spectralTriggerBandwidth % 10, (0x01 << configSettings->frequencyTriggerWindowLengthShift));
+
+        length += sprintf(configBuffer + length, "\r\nThreshold setting               : %udB", extendedConfigSettings->spectralTriggerRatioDecibels);
+
+    } else if (frequencyTriggerEnabled) {
 
         length += sprintf(configBuffer + length, "Frequency (%u.%ukHz and window length of %u samples)", configSettings->frequencyTriggerCentreFrequency / 10, configSettings->frequencyTriggerCentreFrequency % 10, (0x01 << configSettings->frequencyTriggerWindowLengthShift));
 
@@ -1146,6 +1578,18 @@ static bool writeConfigurationToFile(configSettings_t *configSettings, uint32_t
 
         length += formatPercentage(configBuffer + length, configSettings->frequencyTriggerThresholdPercentageMantissa, configSettings->frequencyTriggerThresholdPercentageExponent);
 
+        for (uint32_t i = 0; i < MAXIMUM_ADDITIONAL_FREQUENCY_TRIGGERS; i += 1) {
+
+            frequencyTrigger_t *frequencyTrigger = extendedConfigSettings->additionalFrequencyTriggers + i;
+
+            if (frequencyTrigger->centreFrequency == 0) continue;
+
+            length += sprintf(configBuffer + length, "\r\nAdditional frequency (kHz)      : %u.%u at ", frequencyTrigger->centreFrequency / 10, frequencyTrigger->centreFrequency % 10);
+
+            length += formatPercentage(configBuffer + length, frequencyTrigger->thresholdPercentageMantissa, frequencyTrigger->thresholdPercentageExponent);
+
+        }
+
     } else if (amplitudeThresholdEnabled) {
 
         length += sprintf(configBuffer + length, "Amplitude");
@@ -1174,11 +1618,11 @@ static bool writeConfigurationToFile(configSettings_t *configSettings, uint32_t
 
     }
 
-    length += sprintf(configBuffer + length, "\r\nMinimum trigger duration (s)    : ");
+    length += sprintf(configBuffer + length, "\r\nAdaptive threshold margin (dB)  : ");
 
-    if (frequencyTriggerEnabled || amplitudeThresholdEnabled) {
+    if (amplitudeThresholdEnabled && extendedConfigSettings->enableAdaptiveAmplitudeThreshold) {
 
-        length += sprintf(configBuffer + length, "%u", configSettings->minimumTriggerDuration);
+        length += sprintf(configBuffer + length, "%u", extendedConfigSettings->adaptiveAmplitudeThresholdMarginDecibels);
 
     } else {
 
@@ -1186,71 +1630,151 @@ static bool writeConfigurationToFile(configSettings_t *configSettings, uint32_t
 
     }
 
-    RETURN_BOOL_ON_ERROR(AudioMoth_writeToFile(configBuffer, length));
+    length += sprintf(configBuffer + length, "\r\nMinimum trigger duration (s)    : ");
 
-    length = sprintf(configBuffer, "\r\n\r\nEnable LED                      : %s\r\n", configSettings->enableLED ? "Yes" : "No");
+    if (frequencyTriggerEnabled || amplitudeThresholdEnabled) {
 
-    length += sprintf(configBuffer + length, "Enable low-voltage cut-off      : %s\r\n", configSettings->enableLowVoltageCutoff ? "Yes" : "No");
+        length += sprintf(configBuffer + length, "%u", configSettings->minimumTriggerDuration);
 
-    length += sprintf(configBuffer + length, "Enable battery level indication : %s\r\n\r\n", configSettings->disableBatteryLevelDisplay ? "No" : configSettings->batteryLevelDisplayType == NIMH_LIPO_BATTERY_VOLTAGE ? "Yes (NiMH/LiPo voltage range)" : "Yes");
+    } else {
 
-    length += sprintf(configBuffer + length, "Always require acoustic chime   : %s\r\n", configSettings->requireAcousticConfiguration ? "Yes" : "No");
+        length += sprintf(configBuffer + length, "-");
 
-    length += sprintf(configBuffer + length, "Use device ID in WAV file name  : %s\r\n", configSettings->enableFilenameWithDeviceID ? "Yes" : "No");
+    }
 
-    length += sprintf(configBuffer + length, "Use daily folder for WAV files  : %s\r\n\r\n", configSettings->enableDailyFolders ? "Yes" : "No");
+    length += sprintf(configBuffer + length, "\r\nPre-trigger buffers             : ");
 
-    length += sprintf(configBuffer + length, "Disable 48Hz DC blocking filter : %s\r\n", configSettings->disable48HzDCBlockingFilter ? "Yes" : "No");
+    if (frequencyTriggerEnabled || amplitudeThresholdEnabled) {
 
-    length += sprintf(configBuffer + length, "Enable energy saver mode        : %s\r\n", configSettings->enableEnergySaverMode ? "Yes" : "No");
+        uint32_t numberOfPreTriggerBuffers = MIN(MAXIMUM_NUMBER_OF_PRE_TRIGGER_BUFFERS, configSettings->preTriggerBuffers);
 
-    length += sprintf(configBuffer + length, "Enable low gain range           : %s\r\n\r\n", configSettings->enableLowGainRange ? "Yes" : "No");
+        uint32_t bufferDuration = NUMBER_OF_SAMPLES_IN_BUFFER * MILLISECONDS_IN_SECOND / (configSettings->sampleRate / configSettings->sampleRateDivider);
 
-    length += sprintf(configBuffer + length, "Enable magnetic switch          : %s\r\n\r\n", configSettings->enableMagneticSwitch ? "Yes" : "No");
+        /* Each pre-trigger buffer held back is one less buffer to absorb SD card write delays */
 
-    RETURN_BOOL_ON_ERROR(AudioMoth_writeToFile(configBuffer, length));
+        length += sprintf(configBuffer + length, "%lu (%lums of pre-trigger audio with %lums of SD card write tolerance)", numberOfPreTriggerBuffers, numberOfPreTriggerBuffers * bufferDuration, (NUMBER_OF_BUFFERS - numberOfPreTriggerBuffers - 2) * bufferDuration);
 
-    length = sprintf(configBuffer, "Enable GPS time setting         : %s\r\n", configSettings->enableTimeSettingFromGPS ? "Yes" : "No");
+    } else {
 
-    length += sprintf(configBuffer + length, "GPS fix before and after        : %s\r\n", configSettings->enableTimeSettingFromGPS == false ? "-" : configSettings->enableTimeSettingBeforeAndAfterRecordings ? "Individual recordings" : "Recording periods");
+        length += sprintf(configBuffer + length, "-");
 
-    length += sprintf(configBuffer + length, "GPS fix time (mins)             : ");
+    }
 
-    if (configSettings->enableTimeSettingFromGPS) {
+    length += sprintf(configBuffer + length, "\r\nTrigger attack duration (ms)    : ");
 
-        uint32_t gpsTimeSettingPeriod = configSettings->gpsTimeSettingPeriod == 0 ? GPS_DEFAULT_TIME_SETTING_PERIOD / SECONDS_IN_MINUTE : configSettings->gpsTimeSettingPeriod;
+    if (frequencyTriggerEnabled || amplitudeThresholdEnabled) {
 
-        length += sprintf(configBuffer + length, "%ld\r\n", gpsTimeSettingPeriod);
+        length += sprintf(configBuffer + length, "%u", TRIGGER_ATTACK_DURATION_STEP_MS * extendedConfigSettings->triggerAttackDuration);
 
     } else {
 
-        length += sprintf(configBuffer + length, "-\r\n");
+        length += sprintf(configBuffer + length, "-");
 
     }
 
-    RETURN_BOOL_ON_ERROR(AudioMoth_writeToFile(configBuffer, length));
+    length += sprintf(configBuffer + length, "\r\nTrigger hysteresis (dB)         : ");
 
-    RETURN_BOOL_ON_ERROR(AudioMoth_closeFile());
+    if (frequencyTriggerEnabled || amplitudeThresholdEnabled) {
 
-    return true;
+        length += sprintf(configBuffer + length, "%u", extendedConfigSettings->triggerHysteresisDecibels);
 
-}
+    } else {
 
-/* Backup domain variables */
+        length += sprintf(configBuffer + length, "-");
 
-static uint32_t *backupDomainFlags = (uint32_t*)AM_BACKUP_DOMAIN_START_ADDRESS;
+    }
 
-static uint32_t *previousSwitchPosition = (uint32_t*)(AM_BACKUP_DOMAIN_START_ADDRESS + 4);
+    length += sprintf(configBuffer + length, "\r\nEvent file hold-off (s)         : ");
 
-static uint32_t *startOfRecordingPeriod = (uint32_t*)(AM_BACKUP_DOMAIN_START_ADDRESS + 8);
+    if ((frequencyTriggerEnabled || amplitudeThresholdEnabled) && extendedConfigSettings->enableEventFiles) {
 
-static uint32_t *timeOfNextRecording = (uint32_t*)(AM_BACKUP_DOMAIN_START_ADDRESS + 12);
+        length += sprintf(configBuffer + length, "%u", MAX(MINIMUM_EVENT_FILE_HOLD_OFF, extendedConfigSettings->eventFileHoldOff));
 
-static uint32_t *indexOfNextRecording = (uint32_t*)(AM_BACKUP_DOMAIN_START_ADDRESS + 16);
+    } else {
 
-static uint32_t *durationOfNextRecording = (uint32_t*)(AM_BACKUP_DOMAIN_START_ADDRESS + 20);
+        length += sprintf(configBuffer + length, "-");
 
-static uint32_t *timeOfNextGPSTimeSetting = (uint32_t*)(AM_BACKUP_DOMAIN_START_ADDRESS + 24);
+    }
+
+    RETURN_BOOL_ON_ERROR(AudioMoth_writeToFile(configBuffer, length));
+
+    length = sprintf(configBuffer, "\r\n\r\nEnable LED                      : %s\r\n", configSettings->enableLED ? "Yes" : "No");
+
+    length += sprintf(configBuffer + length, "Enable low-voltage cut-off      : %s\r\n", configSettings->enableLowVoltageCutoff ? "Yes" : "No");
+
+    length += sprintf(configBuffer + length, "Enable battery level indication : %s\r\n\r\n", configSettings->disableBatteryLevelDisplay ? "No" : configSettings->batteryLevelDisplayType == NIMH_LIPO_BATTERY_VOLTAGE ? "Yes (NiMH/LiPo voltage range)" : "Yes");
+
+    length += sprintf(configBuffer + length, "Always require acoustic chime   : %s\r\n", configSettings->requireAcousticConfiguration ? "Yes" : "No");
+
+    length += sprintf(configBuffer + length, "Use device ID in WAV file name  : %s\r\n", configSettings->enableFilenameWithDeviceID ? "Yes" : "No");
+
+    length += sprintf(configBuffer + length, "Use daily folder for WAV files  : %s\r\n\r\n", configSettings->enableDailyFolders ? "Yes" : "No");
+
+    RETURN_BOOL_ON_ERROR(AudioMoth_writeToFile(configBuffer, length));
+
+    length = sprintf(configBuffer, "Disable 48Hz DC blocking filter : %s\r\n", configSettings->disable48HzDCBlockingFilter ? "Yes" : "No");
+
+    length += sprintf(configBuffer + length, "Enable energy saver mode        : %s\r\n", configSettings->enableEnergySaverMode ? "Yes" : "No");
+
+    length += sprintf(configBuffer + length, "Automatic energy saver mode     : %s\r\n", extendedConfigSettings->enableAutomaticEnergySaverMode == false ? "No" : extendedConfigSettings->energySaverModeSelected ? "Yes (half clock speed)" : "Yes (full clock speed)");
+
+    length += sprintf(configBuffer + length, "Enable low gain range           : %s\r\n", configSettings->enableLowGainRange ? "Yes" : "No");
+
+    length += sprintf(configBuffer + length, "Enable fixed-point filter       : %s\r\n", configSettings->enableFixedPointFilter ? "Yes" : "No");
+
+    length += sprintf(configBuffer + length, "File format                     : %s\r\n", (frequencyTriggerEnabled || amplitudeThresholdEnabled) && extendedConfigSettings->enableEventFiles ? "WAV" : extendedConfigSettings->fileFormat == FLAC_FILE_FORMAT ? "FLAC" : extendedConfigSettings->fileFormat == IMA_ADPCM_FILE_FORMAT ? "WAV (IMA-ADPCM)" : "WAV");
+
+    length += sprintf(configBuffer + length, "Preallocate WAV files           : %s\r\n", extendedConfigSettings->enableFilePreallocation ? "Yes" : "No");
+
+    length += sprintf(configBuffer + length, "Defer DMA processing            : %s\r\n", extendedConfigSettings->enableDeferredProcessing ? "Yes" : "No");
+
+    length += sprintf(configBuffer + length, "Buffer overrun policy           : %s\r\n\r\n", configSettings->bufferOverrunPolicy == STOP_RECORDING_ON_OVERRUN ? "Stop recording" : configSettings->bufferOverrunPolicy == DROP_NEWEST_BUFFER ? "Drop newest buffer" : "Drop oldest buffer");
+
+    length += sprintf(configBuffer + length, "Enable magnetic switch          : %s\r\n\r\n", configSettings->enableMagneticSwitch ? "Yes" : "No");
+
+    RETURN_BOOL_ON_ERROR(AudioMoth_writeToFile(configBuffer, length));
+
+    length = sprintf(configBuffer, "Enable GPS time setting         : %s\r\n", configSettings->enableTimeSettingFromGPS ? "Yes" : "No");
+
+    length += sprintf(configBuffer + length, "GPS fix before and after        : %s\r\n", configSettings->enableTimeSettingFromGPS == false ? "-" : configSettings->enableTimeSettingBeforeAndAfterRecordings ? "Individual recordings" : "Recording periods");
+
+    length += sprintf(configBuffer + length, "GPS fix time (mins)             : ");
+
+    if (configSettings->enableTimeSettingFromGPS) {
+
+        uint32_t gpsTimeSettingPeriod = configSettings->gpsTimeSettingPeriod == 0 ? GPS_DEFAULT_TIME_SETTING_PERIOD / SECONDS_IN_MINUTE : configSettings->gpsTimeSettingPeriod;
+
+        length += sprintf(configBuffer + length, "%ld\r\n", gpsTimeSettingPeriod);
+
+    } else {
+
+        length += sprintf(configBuffer + length, "-\r\n");
+
+    }
+
+    RETURN_BOOL_ON_ERROR(AudioMoth_writeToFile(configBuffer, length));
+
+    RETURN_BOOL_ON_ERROR(AudioMoth_closeFile());
+
+    return true;
+
+}
+
+/* Backup domain variables */
+
+static uint32_t *backupDomainFlags = (uint32_t*)AM_BACKUP_DOMAIN_START_ADDRESS;
+
+static uint32_t *previousSwitchPosition = (uint32_t*)(AM_BACKUP_DOMAIN_START_ADDRESS + 4);
+
+static uint32_t *startOfRecordingPeriod = (uint32_t*)(AM_BACKUP_DOMAIN_START_ADDRESS + 8);
+
+static uint32_t *timeOfNextRecording = (uint32_t*)(AM_BACKUP_DOMAIN_START_ADDRESS + 12);
+
+static uint32_t *indexOfNextRecording = (uint32_t*)(AM_BACKUP_DOMAIN_START_ADDRESS + 16);
+
+static uint32_t *durationOfNextRecording = (uint32_t*)(AM_BACKUP_DOMAIN_START_ADDRESS + 20);
+
+static uint32_t *timeOfNextGPSTimeSetting = (uint32_t*)(AM_BACKUP_DOMAIN_START_ADDRESS + 24);
 
 static uint8_t *deploymentID = (uint8_t*)(AM_BACKUP_DOMAIN_START_ADDRESS + 28);
 
@@ -1280,6 +1804,8 @@ static uint32_t *timeOfNextSunriseSunsetCalculation = (uint32_t*)(AM_BACKUP_DOMA
 
 static configSettings_t *configSettings = (configSettings_t*)(AM_BACKUP_DOMAIN_START_ADDRESS + 84);
 
+static extendedConfigSettings_t *extendedConfigSettings = (extendedConfigSettings_t*)(AM_BACKUP_DOMAIN_START_ADDRESS + 148);
+
 /* Functions to query, set and clear backup domain flags */
 
 typedef enum {
@@ -1320,8 +1846,18 @@ static volatile uint32_t writeBuffer;
 
 static volatile uint32_t writeBufferIndex;
 
+static volatile uint32_t readBuffer;
+
 static int16_t* buffers[NUMBER_OF_BUFFERS];
 
+/* Buffer overrun variables */
+
+static volatile bool bufferOverrun;
+
+static volatile uint32_t numberOfDroppedBuffers;
+
+static volatile bool readBufferInUse;
+
 /* Flag to start processing DMA transfers */
 
 static volatile uint32_t numberOfDMATransfers;
@@ -1332,10 +1868,34 @@ static volatile uint32_t numberOfDMATransfersToWait;
 
 static bool writeIndicator[NUMBER_OF_BUFFERS];
 
+/* Trigger state machine variables */
+
+static bool evaluateTriggerInMainLoop;
+
+static AM_triggerState_t triggerState;
+
+static uint32_t triggerStateCounter;
+
+static uint32_t triggerAttackCount;
+
+static uint32_t triggerHoldOffCount;
+
 /* Compression buffer */
 
 static int16_t compressionBuffer[COMPRESSION_BUFFER_SIZE_IN_BYTES / NUMBER_OF_BYTES_IN_SAMPLE];
 
+/* GUANO buffer */
+
+static char guanoBuffer[GUANO_BUFFER_SIZE_IN_BYTES];
+
+/* SD card statistics */
+
+static fileStatistics_t fileStatistics;
+
+static fileStatistics_t eventStartFileStatistics;
+
+static uint32_t eventStartNumberOfDroppedBuffers;
+
 /* GPS fix variables */
 
 static bool gpsEnableLED;
@@ -1378,11 +1938,21 @@ static volatile bool microphoneChanged;
 
 static volatile bool switchPositionChanged;
 
-/* DMA buffers */
+/* DMA buffers. Transfers complete into the ring in order and each completed buffer is not refilled until the ring wraps */
+
+static int16_t dmaBuffers[NUMBER_OF_DMA_BUFFERS][MAXIMUM_SAMPLES_IN_DMA_TRANSFER];
+
+static volatile uint32_t numberOfCompletedDMABlocks;
 
-static int16_t primaryBuffer[MAXIMUM_SAMPLES_IN_DMA_TRANSFER];
+/* Deferred DMA processing variables. The difference between the completed and processed counts is the number of blocks queued for the main loop */
 
-static int16_t secondaryBuffer[MAXIMUM_SAMPLES_IN_DMA_TRANSFER];
+static bool deferredProcessingEnabled;
+
+static volatile uint32_t numberOfProcessedDMABlocks;
+
+static volatile bool mainLoopProcessingDMABlocks;
+
+static volatile uint32_t numberOfInlineDMABlocks;
 
 /* Firmware version and description */
 
@@ -1394,6 +1964,10 @@ static uint8_t firmwareDescription[AM_FIRMWARE_DESCRIPTION_LENGTH] = "AudioMoth-
 
 static AM_recordingState_t makeRecording(uint32_t timeOfNextRecording, uint32_t recordDuration, bool enableLED, AM_extendedBatteryState_t extendedBatteryState, int32_t temperature, uint32_t *fileOpenTime, uint32_t *fileOpenMilliseconds);
 
+static bool writeStatisticsToFile(uint32_t timeOfRecording, AM_recordingState_t recordingState);
+
+static void processDMABlock(int16_t *source);
+
 static void scheduleRecording(uint32_t currentTime, uint32_t *timeOfNextRecording, uint32_t *indexOfNextRecording, uint32_t *durationOfNextRecording, uint32_t *startOfRecordingPeriod, uint32_t *endOfRecordingPeriod);
 
 static void determineTimeOfNextSunriseSunsetCalculation(uint32_t currentTime, uint32_t *timeOfNextSunriseSunsetCalculation);
@@ -1430,6 +2004,42 @@ static void copyToBackupDomain(uint32_t *dst, uint8_t *src, uint32_t length) {
 
 }
 
+/* Trigger state machine function which is updated on each trigger evaluation and returns whether the samples should be written */
+
+static bool updateTriggerState(bool thresholdExceeded) {
+
+    if (triggerState == TRIGGER_IDLE || triggerState == TRIGGER_ATTACK) {
+
+        /* Require consecutive evaluations above the on threshold */
+
+        triggerStateCounter = thresholdExceeded ? triggerStateCounter + 1 : 0;
+
+        triggerState = triggerStateCounter >= triggerAttackCount ? TRIGGER_ACTIVE : triggerStateCounter > 0 ? TRIGGER_ATTACK : TRIGGER_IDLE;
+
+        if (triggerState == TRIGGER_ACTIVE) triggerStateCounter = 0;
+
+    } else {
+
+        /* Remain active until the hold-off period has passed below the off threshold */
+
+        triggerStateCounter = thresholdExceeded ? 0 : triggerStateCounter + 1;
+
+        triggerState = triggerStateCounter == 0 ? TRIGGER_ACTIVE : triggerStateCounter <= triggerHoldOffCount ? TRIGGER_RELEASE : TRIGGER_IDLE;
+
+        if (triggerState == TRIGGER_IDLE) triggerStateCounter = 0;
+
+    }
+
+    bool triggerActive = triggerState == TRIGGER_ACTIVE || triggerState == TRIGGER_RELEASE;
+
+    /* Switch the digital filter to the off threshold while active */
+
+    DigitalFilter_setTriggerActive(triggerActive);
+
+    return triggerActive;
+
+}
+
 /* GPS time setting functions */
 
 static void writeGPSLogMessage(uint32_t currentTime, uint32_t currentMilliseconds, char *message) {
@@ -1644,10 +2254,14 @@ int main(void) {
 
             copyToBackupDomain((uint32_t*)configSettings, (uint8_t*)&persistentConfigSettings->configSettings, sizeof(configSettings_t));
 
+            copyToBackupDomain((uint32_t*)extendedConfigSettings, (uint8_t*)&persistentConfigSettings->extendedConfigSettings, sizeof(extendedConfigSettings_t));
+
         } else {
 
             copyToBackupDomain((uint32_t*)configSettings, (uint8_t*)&defaultConfigSettings, sizeof(configSettings_t));
 
+            copyToBackupDomain((uint32_t*)extendedConfigSettings, (uint8_t*)&defaultExtendedConfigSettings, sizeof(extendedConfigSettings_t));
+
         }
 
     }
@@ -1804,7 +2418,7 @@ int main(void) {
 
             /* Enable energy saver mode */
 
-            if (isEnergySaverMode(configSettings)) AudioMoth_setClockDivider(AM_HF_CLK_DIV2);
+            if (isEnergySaverMode(extendedConfigSettings)) AudioMoth_setClockDivider(AM_HF_CLK_DIV2);
 
             /* Reset the recording error counter */
 
@@ -1842,7 +2456,7 @@ int main(void) {
 
                     bool acousticLocationReceived = getBackupFlag(BACKUP_ACOUSTIC_LOCATION_RECEIVED);
 
-                    bool success = writeConfigurationToFile(configSettings, currentTime, gpsLocationReceived, gpsLatitude, gpsLongitude, acousticLocationReceived, acousticLatitude, acousticLongitude, firmwareDescription, firmwareVersion, (uint8_t*)AM_UNIQUE_ID_START_ADDRESS, deploymentID, defaultDeploymentID);
+                    bool success = writeConfigurationToFile(configSettings, extendedConfigSettings, currentTime, gpsLocationReceived, gpsLatitude, gpsLongitude, acousticLocationReceived, acousticLatitude, acousticLongitude, firmwareDescription, firmwareVersion, (uint8_t*)AM_UNIQUE_ID_START_ADDRESS, deploymentID, defaultDeploymentID);
 
                     setBackupFlag(BACKUP_WRITTEN_CONFIGURATION_TO_FILE, success);
 
@@ -1988,7 +2602,7 @@ int main(void) {
 
                 bool acousticLocationReceived = getBackupFlag(BACKUP_ACOUSTIC_LOCATION_RECEIVED);
 
-                bool success = writeConfigurationToFile(configSettings, currentTime, gpsLocationReceived, gpsLatitude, gpsLongitude, acousticLocationReceived, acousticLatitude, acousticLongitude, firmwareDescription, firmwareVersion, (uint8_t*)AM_UNIQUE_ID_START_ADDRESS, deploymentID, defaultDeploymentID);
+                bool success = writeConfigurationToFile(configSettings, extendedConfigSettings, currentTime, gpsLocationReceived, gpsLatitude, gpsLongitude, acousticLocationReceived, acousticLatitude, acousticLongitude, firmwareDescription, firmwareVersion, (uint8_t*)AM_UNIQUE_ID_START_ADDRESS, deploymentID, defaultDeploymentID);
 
                 setBackupFlag(BACKUP_WRITTEN_CONFIGURATION_TO_FILE, success);
 
@@ -2020,7 +2634,7 @@ int main(void) {
 
         /* Enable energy saver mode */
 
-        if (isEnergySaverMode(configSettings)) AudioMoth_setClockDivider(AM_HF_CLK_DIV2);
+        if (isEnergySaverMode(extendedConfigSettings)) AudioMoth_setClockDivider(AM_HF_CLK_DIV2);
 
         /* Write configuration if not already done so */
 
@@ -2034,7 +2648,7 @@ int main(void) {
 
                 bool acousticLocationReceived = getBackupFlag(BACKUP_ACOUSTIC_LOCATION_RECEIVED);
 
-                bool success = writeConfigurationToFile(configSettings, currentTime, gpsLocationReceived, gpsLatitude, gpsLongitude, acousticLocationReceived, acousticLatitude, acousticLongitude, firmwareDescription, firmwareVersion, (uint8_t*)AM_UNIQUE_ID_START_ADDRESS, deploymentID, defaultDeploymentID);
+                bool success = writeConfigurationToFile(configSettings, extendedConfigSettings, currentTime, gpsLocationReceived, gpsLatitude, gpsLongitude, acousticLocationReceived, acousticLatitude, acousticLongitude, firmwareDescription, firmwareVersion, (uint8_t*)AM_UNIQUE_ID_START_ADDRESS, deploymentID, defaultDeploymentID);
 
                 setBackupFlag(BACKUP_WRITTEN_CONFIGURATION_TO_FILE, success);
 
@@ -2086,6 +2700,10 @@ int main(void) {
 
                 recordingState = makeRecording(*timeOfNextRecording, *durationOfNextRecording, enableLED, extendedBatteryState, temperature, &fileOpenTime, &fileOpenMilliseconds);
 
+                /* Append the SD card statistics unless the card has failed */
+
+                if (recordingState != SDCARD_WRITE_ERROR) writeStatisticsToFile(*timeOfNextRecording, recordingState);
+
             } else {
 
                 FLASH_LED(Both, LONG_LED_FLASH_DURATION);
@@ -2158,7 +2776,7 @@ int main(void) {
 
             /* Update schedule time as if the recording has ended correctly */
 
-            if (recordingState == RECORDING_OKAY || recordingState == SUPPLY_VOLTAGE_LOW || recordingState == SDCARD_WRITE_ERROR) {
+            if (recordingState == RECORDING_OKAY || recordingState == SUPPLY_VOLTAGE_LOW || recordingState == SDCARD_WRITE_ERROR || recordingState == BUFFER_OVERRUN) {
 
                 scheduleTime = MAX(scheduleTime, *timeOfNextRecording + *durationOfNextRecording);
 
@@ -2560,21 +3178,67 @@ inline void AudioMoth_handleSwitchInterrupt() {
 
 inline void AudioMoth_handleDirectMemoryAccessInterrupt(bool isPrimaryBuffer, int16_t **nextBuffer) {
 
-    int16_t *source = secondaryBuffer;
+    /* Pass the transfer to the acoustic configuration receiver while it is listening */
+
+    if (AudioConfig_handleDirectMemoryAccessInterrupt(isPrimaryBuffer, nextBuffer)) return;
+
+    INSTRUMENTATION_START(interruptStartCycles);
+
+    int16_t *source = dmaBuffers[numberOfCompletedDMABlocks & (NUMBER_OF_DMA_BUFFERS - 1)];
+
+    /* The ping-pong descriptor which has just completed is reloaded with the buffer two ahead in the ring */
+
+    *nextBuffer = dmaBuffers[(numberOfCompletedDMABlocks + 2) & (NUMBER_OF_DMA_BUFFERS - 1)];
+
+    numberOfCompletedDMABlocks += 1;
 
-    if (isPrimaryBuffer) source = primaryBuffer;
+    /* Process the block immediately unless deferred processing is enabled */
+
+    if (deferredProcessingEnabled == false) {
+
+        processDMABlock(source);
+
+        numberOfProcessedDMABlocks = numberOfCompletedDMABlocks;
+
+    } else if (mainLoopProcessingDMABlocks == false) {
+
+        /* Process the oldest queued blocks here if the main loop is busy elsewhere and the next transfer would overwrite them */
+
+        while (numberOfCompletedDMABlocks - numberOfProcessedDMABlocks > NUMBER_OF_DMA_BUFFERS - 2) {
+
+            processDMABlock(dmaBuffers[numberOfProcessedDMABlocks & (NUMBER_OF_DMA_BUFFERS - 1)]);
+
+            numberOfProcessedDMABlocks += 1;
+
+            numberOfInlineDMABlocks += 1;
+
+        }
+
+    }
+
+    INSTRUMENTATION_STOP(INSTRUMENTATION_DMA_INTERRUPT, interruptStartCycles);
+
+}
+
+/* Filter a completed DMA block into the SRAM buffers, update the trigger state and advance the write buffer */
+
+static void processDMABlock(int16_t *source) {
 
     /* Apply filter to samples */
 
+    INSTRUMENTATION_START(filterStartCycles);
+
     bool thresholdExceeded = DigitalFilter_applyFilter(source, buffers[writeBuffer] + writeBufferIndex, configSettings->sampleRateDivider, numberOfRawSamplesInDMATransfer);
 
+    INSTRUMENTATION_STOP(INSTRUMENTATION_FILTER, filterStartCycles);
+
     numberOfDMATransfers += 1;
 
     /* Update the current buffer index and write buffer if wait period is over */
 
     if (numberOfDMATransfers > numberOfDMATransfersToWait) {
 
-        writeIndicator[writeBuffer] |= thresholdExceeded;
+        if (evaluateTriggerInMainLoop == false) writeIndicator[writeBuffer] |= updateTriggerState(thresholdExceeded);
 
         writeBufferIndex += numberOfRawSamplesInDMATransfer / configSettings->sampleRateDivider;
 
@@ -2582,7 +3246,41 @@ inline void AudioMoth_handleDirectMemoryAccessInterrupt(bool isPrimaryBuffer, in
 
             writeBufferIndex = 0;
 
-            writeBuffer = (writeBuffer + 1) & (NUMBER_OF_BUFFERS - 1);
+            uint32_t nextWriteBuffer = (writeBuffer + 1) & (NUMBER_OF_BUFFERS - 1);
+
+            /* Check whether the next buffer has not yet been written to the SD card */
+
+            if (nextWriteBuffer == readBuffer) {
+
+                numberOfDroppedBuffers += 1;
+
+                if (configSettings->bufferOverrunPolicy == DROP_NEWEST_BUFFER || configSettings->bufferOverrunPolicy == STOP_RECORDING_ON_OVERRUN) {
+
+                    /* Discard the buffer just filled and fill it again */
+
+                    if (configSettings->bufferOverrunPolicy == STOP_RECORDING_ON_OVERRUN) bufferOverrun = true;
+
+                    writeIndicator[writeBuffer] = false;
+
+                    return;
+
+                }
+
+                /* Discard the oldest unwritten buffer unless the main loop is using it, in which case discard the buffer just filled */
+
+                if (readBufferInUse) {
+
+                    writeIndicator[writeBuffer] = false;
+
+                    return;
+
+                }
+
+                readBuffer = (readBuffer + 1) & (NUMBER_OF_BUFFERS - 1);
+
+            }
+
+            writeBuffer = nextWriteBuffer;
 
             writeIndicator[writeBuffer] = false;
 
@@ -2592,6 +3290,26 @@ inline void AudioMoth_handleDirectMemoryAccessInterrupt(bool isPrimaryBuffer, in
 
 }
 
+/* Process the DMA blocks queued by the interrupt handler when deferred processing is enabled */
+
+static void processDeferredDMABlocks() {
+
+    if (deferredProcessingEnabled == false) return;
+
+    mainLoopProcessingDMABlocks = true;
+
+    while (numberOfProcessedDMABlocks != numberOfCompletedDMABlocks) {
+
+        processDMABlock(dmaBuffers[numberOfProcessedDMABlocks & (NUMBER_OF_DMA_BUFFERS - 1)]);
+
+        numberOfProcessedDMABlocks += 1;
+
+    }
+
+    mainLoopProcessingDMABlocks = false;
+
+}
+
 /* AudioMoth USB message handlers */
 
 inline void AudioMoth_usbFirmwareVersionRequested(uint8_t **firmwareVersionPtr) {
@@ -2644,15 +3362,55 @@ inline void AudioMoth_usbApplicationPacketReceived(uint32_t messageType, uint8_t
 
     static persistentConfigSettings_t persistentConfigSettings __attribute__ ((aligned(UINT32_SIZE_IN_BYTES)));
 
+    /* Keep the configuration settings as received so the extended settings packet can be combined with them */
+
+    static configSettings_t receivedConfigSettings;
+
+    static bool configSettingsReceived = false;
+
+    uint32_t marker;
+
+    memcpy(&marker, receiveBuffer + 1, UINT32_SIZE_IN_BYTES);
+
+    bool extendedSettingsPacket = marker == EXTENDED_SETTINGS_PACKET_MARKER;
+
+    if (extendedSettingsPacket) {
+
+        /* Reject extended settings which do not follow a configuration packet */
+
+        if (configSettingsReceived == false) {
+
+            memset(transmitBuffer + 1, 0, USB_PACKET_PAYLOAD_SIZE);
+
+            return;
+
+        }
+
+        memcpy(&persistentConfigSettings.extendedConfigSettings, receiveBuffer + 1 + UINT32_SIZE_IN_BYTES, sizeof(extendedConfigSettings_t));
+
+    } else {
+
+        /* A configuration packet on its own selects the default extended settings */
+
+        memcpy(&receivedConfigSettings, receiveBuffer + 1, sizeof(configSettings_t));
+
+        memcpy(&persistentConfigSettings.extendedConfigSettings, &defaultExtendedConfigSettings, sizeof(extendedConfigSettings_t));
+
+        configSettingsReceived = true;
+
+    }
+
     memcpy(&persistentConfigSettings.firmwareVersion, &firmwareVersion, AM_FIRMWARE_VERSION_LENGTH);
 
     memcpy(&persistentConfigSettings.firmwareDescription, &firmwareDescription, AM_FIRMWARE_DESCRIPTION_LENGTH);
 
-    memcpy(&persistentConfigSettings.configSettings, receiveBuffer + 1,  sizeof(configSettings_t));
+    memcpy(&persistentConfigSettings.configSettings, &receivedConfigSettings, sizeof(configSettings_t));
 
     /* Implement energy saver mode changes */
 
-    if (isEnergySaverMode(&persistentConfigSettings.configSettings)) {
+    persistentConfigSettings.extendedConfigSettings.energySaverModeSelected = selectEnergySaverMode(&persistentConfigSettings.configSettings, &persistentConfigSettings.extendedConfigSettings);
+
+    if (isEnergySaverMode(&persistentConfigSettings.extendedConfigSettings)) {
 
         persistentConfigSettings.configSettings.sampleRate /= 2;
         persistentConfigSettings.configSettings.clockDivider /= 2;
@@ -2672,25 +3430,45 @@ inline void AudioMoth_usbApplicationPacketReceived(uint32_t messageType, uint8_t
 
         copyToBackupDomain((uint32_t*)configSettings, (uint8_t*)&persistentConfigSettings.configSettings, sizeof(configSettings_t));
 
-        /* Copy the back-up register data structure to the USB packet */
+        copyToBackupDomain((uint32_t*)extendedConfigSettings, (uint8_t*)&persistentConfigSettings.extendedConfigSettings, sizeof(extendedConfigSettings_t));
 
-        copyFromBackupDomain(transmitBuffer + 1, (uint32_t*)configSettings, sizeof(configSettings_t));
+        if (extendedSettingsPacket) {
 
-        /* Revert energy saver mode changes */
+            /* Copy the marker and the back-up register data structure to the USB packet */
 
-        configSettings_t *tempConfigSettings = (configSettings_t*)(transmitBuffer + 1);
+            memcpy(transmitBuffer + 1, &marker, UINT32_SIZE_IN_BYTES);
 
-        if (isEnergySaverMode(tempConfigSettings)) {
+            copyFromBackupDomain(transmitBuffer + 1 + UINT32_SIZE_IN_BYTES, (uint32_t*)extendedConfigSettings, sizeof(extendedConfigSettings_t));
 
-            tempConfigSettings->sampleRate *= 2;
-            tempConfigSettings->clockDivider *= 2;
-            tempConfigSettings->sampleRateDivider *= 2;
+            /* Revert energy saver mode changes */
 
-        }    
+            extendedConfigSettings_t *tempExtendedConfigSettings = (extendedConfigSettings_t*)(transmitBuffer + 1 + UINT32_SIZE_IN_BYTES);
 
-        /* Set the time */
+            tempExtendedConfigSettings->energySaverModeSelected = 0;
+
+        } else {
+
+            /* Copy the back-up register data structure to the USB packet */
+
+            copyFromBackupDomain(transmitBuffer + 1, (uint32_t*)configSettings, sizeof(configSettings_t));
 
-        AudioMoth_setTime(configSettings->time, USB_CONFIG_TIME_CORRECTION);
+            /* Revert energy saver mode changes */
+
+            configSettings_t *tempConfigSettings = (configSettings_t*)(transmitBuffer + 1);
+
+            if (isEnergySaverMode(extendedConfigSettings)) {
+
+                tempConfigSettings->sampleRate *= 2;
+                tempConfigSettings->clockDivider *= 2;
+                tempConfigSettings->sampleRateDivider *= 2;
+
+            }
+
+            /* Set the time */
+
+            AudioMoth_setTime(configSettings->time, USB_CONFIG_TIME_CORRECTION);
+
+        }
 
         /* Blink the green LED */
 
@@ -2700,7 +3478,7 @@ inline void AudioMoth_usbApplicationPacketReceived(uint32_t messageType, uint8_t
 
         /* Return blank configuration as error indicator */
 
-        memset(transmitBuffer + 1, 0, sizeof(configSettings_t));
+        memset(transmitBuffer + 1, 0, USB_PACKET_PAYLOAD_SIZE);
 
     }
 
@@ -2808,16 +3586,6 @@ inline void AudioConfig_handleAudioConfigurationPacket(uint8_t *receiveBuffer, u
 
 /* Clear and encode the compression buffer */
 
-static void clearCompressionBuffer() {
-
-    for (uint32_t i = 0; i < COMPRESSION_BUFFER_SIZE_IN_BYTES / NUMBER_OF_BYTES_IN_SAMPLE; i += 1) {
-
-        compressionBuffer[i] = 0;
-
-    }
-
-}
-
 static void encodeCompressionBuffer(uint32_t numberOfCompressedBuffers) {
 
     for (uint32_t i = 0; i < UINT32_SIZE_IN_BITS; i += 1) {
@@ -2836,63 +3604,363 @@ static void encodeCompressionBuffer(uint32_t numberOfCompressedBuffers) {
 
 }
 
-/* Generate foldername and filename from time */
+/* Functions to time SD card operations */
 
-static void generateFolderAndFilename(char *foldername, char *filename, uint32_t timestamp, bool triggeredRecording) {
+static uint32_t getMillisecondTime() {
 
-    struct tm time;
+    uint32_t currentTime, currentMilliseconds;
 
-    time_t rawTime = timestamp + configSettings->timezoneHours * SECONDS_IN_HOUR + configSettings->timezoneMinutes * SECONDS_IN_MINUTE;
+    AudioMoth_getTime(&currentTime, &currentMilliseconds);
 
-    gmtime_r(&rawTime, &time);
+    return currentTime * MILLISECONDS_IN_SECOND + currentMilliseconds;
 
-    sprintf(foldername, "%04d%02d%02d", YEAR_OFFSET + time.tm_year, MONTH_OFFSET + time.tm_mon, time.tm_mday);
+}
 
-    uint32_t length = 0;
-    
-    if (configSettings->enableDailyFolders) {
+static void updateFileStatistics(uint32_t startTime, uint32_t numberOfBytes) {
 
-        length += sprintf(filename, "%s/", foldername);
+    uint32_t latency = getMillisecondTime() - startTime;
 
-    } 
-    
-    if (configSettings->enableFilenameWithDeviceID) {
+    uint32_t bucket = 0;
 
-        uint8_t *source = memcmp(deploymentID, defaultDeploymentID, DEPLOYMENT_ID_LENGTH) ? deploymentID : (uint8_t*)AM_UNIQUE_ID_START_ADDRESS;
+    while (bucket < NUMBER_OF_LATENCY_BUCKETS - 1 && latency >> bucket) bucket += 1;
 
-        length += sprintf(filename + length, SERIAL_NUMBER "_", FORMAT_SERIAL_NUMBER(source));
+    fileStatistics.latencyHistogram[bucket] += 1;
 
-    }
-    
-    length += sprintf(filename + length, "%s_%02d%02d%02d", foldername, time.tm_hour, time.tm_min, time.tm_sec);
+    fileStatistics.maximumLatency = MAX(fileStatistics.maximumLatency, latency);
 
-    char *extension = triggeredRecording ? "T.WAV" : ".WAV";
+    fileStatistics.numberOfOperations += 1;
 
-    strcpy(filename + length, extension);
+    fileStatistics.numberOfBytesWritten += numberOfBytes;
 
 }
 
-/* Save recording to SD card */
+static bool timedWriteToFile(void *bytes, uint32_t numberOfBytes) {
 
-static AM_recordingState_t makeRecording(uint32_t timeOfNextRecording, uint32_t recordDuration, bool enableLED, AM_extendedBatteryState_t extendedBatteryState, int32_t temperature, uint32_t *fileOpenTime, uint32_t *fileOpenMilliseconds) {
+    uint8_t *source = (uint8_t*)bytes;
 
-    /* Initialise buffers */
+    while (numberOfBytes > 0) {
 
-    writeBuffer = 0;
+        uint32_t numberOfBytesInWrite = MIN(numberOfBytes, MAXIMUM_NUMBER_OF_BYTES_IN_WRITE);
 
-    writeBufferIndex = 0;
+        uint32_t startTime = getMillisecondTime();
 
-    buffers[0] = (int16_t*)AM_EXTERNAL_SRAM_START_ADDRESS;
+        INSTRUMENTATION_START(writeStartCycles);
 
-    for (uint32_t i = 1; i < NUMBER_OF_BUFFERS; i += 1) {
-        buffers[i] = buffers[i - 1] + NUMBER_OF_SAMPLES_IN_BUFFER;
-    }
+        bool success = AudioMoth_writeToFile(source, numberOfBytesInWrite);
 
-    /* Calculate effective sample rate */
+        INSTRUMENTATION_STOP(INSTRUMENTATION_SD_WRITE, writeStartCycles);
+
+        updateFileStatistics(startTime, numberOfBytesInWrite);
+
+        if (success == false) return false;
+
+        source += numberOfBytesInWrite;
+
+        numberOfBytes -= numberOfBytesInWrite;
+
+    }
+
+    return true;
+
+}
+
+static bool timedSyncFile() {
+
+    uint32_t startTime = getMillisecondTime();
+
+    bool success = AudioMoth_syncFile();
+
+    updateFileStatistics(startTime, 0);
+
+    return success;
+
+}
+
+static bool timedSeekInFile(uint32_t position) {
+
+    uint32_t startTime = getMillisecondTime();
+
+    bool success = AudioMoth_seekInFile(position);
+
+    updateFileStatistics(startTime, 0);
+
+    return success;
+
+}
+
+static bool timedTruncateFile() {
+
+    uint32_t startTime = getMillisecondTime();
+
+    bool success = AudioMoth_truncateFile();
+
+    updateFileStatistics(startTime, 0);
+
+    return success;
+
+}
+
+static bool timedCloseFile() {
+
+    uint32_t startTime = getMillisecondTime();
+
+    bool success = AudioMoth_closeFile();
+
+    updateFileStatistics(startTime, 0);
+
+    return success;
+
+}
+
+/* Append the SD card statistics for a recording to the statistics file as time, sample rate, recording state, operations, bytes written, maximum latency, peak buffer occupancy, dropped buffers, DMA blocks processed in the interrupt handler, total DMA blocks and the latency histogram */
+
+static bool writeStatisticsToFile(uint32_t timeOfRecording, AM_recordingState_t recordingState) {
+
+    static char statisticsBuffer[STATISTICS_BUFFER_LENGTH];
+
+    static char *recordingStates[] = {"OKAY", "FILE_SIZE_LIMITED", "SUPPLY_VOLTAGE_LOW", "SWITCH_CHANGED", "MICROPHONE_CHANGED", "MAGNETIC_SWITCH", "SDCARD_WRITE_ERROR", "BUFFER_OVERRUN"};
+
+    struct tm time;
+
+    time_t rawTime = timeOfRecording;
+
+    gmtime_r(&rawTime, &time);
+
+    RETURN_BOOL_ON_ERROR(AudioMoth_appendFile(STATISTICS_FILENAME));
+
+    uint32_t length = sprintf(statisticsBuffer, "%04d-%02d-%02dT%02d:%02d:%02dZ,%lu,%s", YEAR_OFFSET + time.tm_year, MONTH_OFFSET + time.tm_mon, time.tm_mday, time.tm_hour, time.tm_min, time.tm_sec, configSettings->sampleRate / configSettings->sampleRateDivider, recordingStates[recordingState]);
+
+    uint32_t numberOfDMABlocksInInterrupt = deferredProcessingEnabled ? numberOfInlineDMABlocks : numberOfProcessedDMABlocks;
+
+    length += sprintf(statisticsBuffer + length, ",%lu,%lu,%lu,%lu,%lu,%lu,%lu", fileStatistics.numberOfOperations, fileStatistics.numberOfBytesWritten, fileStatistics.maximumLatency, fileStatistics.peakBufferOccupancy, numberOfDroppedBuffers, numberOfDMABlocksInInterrupt, numberOfProcessedDMABlocks);
+
+    for (uint32_t i = 0; i < NUMBER_OF_LATENCY_BUCKETS; i += 1) length += sprintf(statisticsBuffer + length, ",%lu", fileStatistics.latencyHistogram[i]);
+
+    length += sprintf(statisticsBuffer + length, "\r\n");
+
+    RETURN_BOOL_ON_ERROR(AudioMoth_writeToFile(statisticsBuffer, length));
+
+    RETURN_BOOL_ON_ERROR(AudioMoth_closeFile());
+
+    /* Append the minimum, mean and maximum of each instrumented section to the instrumentation file */
+
+    #ifdef ENABLE_INSTRUMENTATION
+
+    RETURN_BOOL_ON_ERROR(AudioMoth_appendFile(INSTRUMENTATION_FILENAME));
+
+    length = sprintf(statisticsBuffer, "%04d-%02d-%02dT%02d:%02d:%02dZ,%lu,", YEAR_OFFSET + time.tm_year, MONTH_OFFSET + time.tm_mon, time.tm_mday, time.tm_hour, time.tm_min, time.tm_sec, configSettings->sampleRate / configSettings->sampleRateDivider);
+
+    length += Instrumentation_writeSummary(statisticsBuffer + length, ",");
+
+    length += sprintf(statisticsBuffer + length, "\r\n");
+
+    RETURN_BOOL_ON_ERROR(AudioMoth_writeToFile(statisticsBuffer, length));
+
+    RETURN_BOOL_ON_ERROR(AudioMoth_closeFile());
+
+    #endif
+
+    return true;
+
+}
+
+/* Write the IMA-ADPCM header followed by the comment and artist chunks, the padding and the data chunk, filling a single SD card sector */
+
+static bool writeImaAdpcmHeader() {
+
+    RETURN_BOOL_ON_ERROR(timedWriteToFile(&imaAdpcmHeader, sizeof(imaAdpcmHeader_t)));
+
+    RETURN_BOOL_ON_ERROR(timedWriteToFile(&wavHeader.icmt, sizeof(icmt_t) + sizeof(iart_t)));
+
+    RETURN_BOOL_ON_ERROR(timedWriteToFile(&imaAdpcmPaddingChunk, sizeof(chunk_t)));
+
+    RETURN_BOOL_ON_ERROR(timedWriteToFile(wavHeader.padding, LENGTH_OF_IMA_ADPCM_HEADER_PADDING));
+
+    RETURN_BOOL_ON_ERROR(timedWriteToFile(&wavHeader.data, sizeof(chunk_t)));
+
+    return true;
+
+}
+
+/* Generate foldername and filename from time */
+
+static void generateFolderAndFilename(char *foldername, char *filename, uint32_t timestamp, bool triggeredRecording, bool flacFile) {
+
+    struct tm time;
+
+    time_t rawTime = timestamp + configSettings->timezoneHours * SECONDS_IN_HOUR + configSettings->timezoneMinutes * SECONDS_IN_MINUTE;
+
+    gmtime_r(&rawTime, &time);
+
+    sprintf(foldername, "%04d%02d%02d", YEAR_OFFSET + time.tm_year, MONTH_OFFSET + time.tm_mon, time.tm_mday);
+
+    uint32_t length = 0;
+    
+    if (configSettings->enableDailyFolders) {
+
+        length += sprintf(filename, "%s/", foldername);
+
+    } 
+    
+    if (configSettings->enableFilenameWithDeviceID) {
+
+        uint8_t *source = memcmp(deploymentID, defaultDeploymentID, DEPLOYMENT_ID_LENGTH) ? deploymentID : (uint8_t*)AM_UNIQUE_ID_START_ADDRESS;
+
+        length += sprintf(filename + length, SERIAL_NUMBER "_", FORMAT_SERIAL_NUMBER(source));
+
+    }
+    
+    length += sprintf(filename + length, "%s_%02d%02d%02d", foldername, time.tm_hour, time.tm_min, time.tm_sec);
+
+    char *extension = flacFile ? (triggeredRecording ? "T.FLAC" : ".FLAC") : (triggeredRecording ? "T.WAV" : ".WAV");
+
+    strcpy(filename + length, extension);
+
+}
+
+/* Save recording to SD card */
+
+/* Determine whether a buffer should be written from its own trigger and those of later evaluated buffers in the pre-trigger window */
+
+static bool shouldWriteBuffer(uint32_t buffer, uint32_t numberOfEvaluatedBuffers, uint32_t numberOfPreTriggerBuffers, bool triggerEnabled) {
+
+    bool writeIndicated = triggerEnabled == false || writeIndicator[buffer];
+
+    /* Check if a later buffer within the pre-trigger window has triggered */
+
+    bool preTriggerIndicated = false;
+
+    for (uint32_t i = 1; i < MIN(numberOfEvaluatedBuffers, numberOfPreTriggerBuffers + 1); i += 1) {
+
+        preTriggerIndicated |= writeIndicator[(buffer + i) & (NUMBER_OF_BUFFERS - 1)];
+
+    }
+
+    /* The minimum trigger duration is applied by the trigger state machine hold-off */
+
+    return writeIndicated || preTriggerIndicated;
+
+}
+
+/* Functions to open and close the file for each triggered event */
+
+static bool openEventFile(char *foldername, char *filename, uint32_t eventStartTime) {
+
+    generateFolderAndFilename(foldername, filename, eventStartTime, true, false);
+
+    if (configSettings->enableDailyFolders) {
+
+        bool directoryExists = AudioMoth_doesDirectoryExist(foldername);
+
+        if (directoryExists == false) RETURN_BOOL_ON_ERROR(AudioMoth_makeDirectory(foldername));
+
+    }
+
+    RETURN_BOOL_ON_ERROR(AudioMoth_openFile(filename));
+
+    /* Snapshot the recording statistics so the event file reports only its own, restarting the maxima which are merged back on closing */
+
+    eventStartFileStatistics = fileStatistics;
+
+    eventStartNumberOfDroppedBuffers = numberOfDroppedBuffers;
+
+    fileStatistics.maximumLatency = 0;
+
+    fileStatistics.peakBufferOccupancy = 0;
+
+    /* Write the header which is rewritten when the file is closed */
+
+    RETURN_BOOL_ON_ERROR(timedWriteToFile(&wavHeader, sizeof(wavHeader_t)));
+
+    return true;
+
+}
+
+static bool closeEventFile(char *filename, uint32_t eventStartTime, uint32_t eventStartMilliseconds, uint32_t numberOfSamples, uint32_t effectiveSampleRate, bool externalMicrophone, AM_recordingState_t recordingState, AM_extendedBatteryState_t extendedBatteryState, int32_t temperature) {
+
+    /* Calculate the statistics since the event file was opened */
+
+    fileStatistics_t eventFileStatistics = fileStatistics;
+
+    eventFileStatistics.numberOfOperations -= eventStartFileStatistics.numberOfOperations;
+
+    eventFileStatistics.numberOfBytesWritten -= eventStartFileStatistics.numberOfBytesWritten;
+
+    for (uint32_t i = 0; i < NUMBER_OF_LATENCY_BUCKETS; i += 1) eventFileStatistics.latencyHistogram[i] -= eventStartFileStatistics.latencyHistogram[i];
+
+    uint32_t eventNumberOfDroppedBuffers = numberOfDroppedBuffers - eventStartNumberOfDroppedBuffers;
+
+    fileStatistics.maximumLatency = MAX(fileStatistics.maximumLatency, eventStartFileStatistics.maximumLatency);
+
+    fileStatistics.peakBufferOccupancy = MAX(fileStatistics.peakBufferOccupancy, eventStartFileStatistics.peakBufferOccupancy);
+
+    /* Write the GUANO data */
+
+    bool gpsLocationReceived = getBackupFlag(BACKUP_GPS_LOCATION_RECEIVED);
+
+    bool acousticLocationReceived = getBackupFlag(BACKUP_ACOUSTIC_LOCATION_RECEIVED);
+
+    uint32_t guanoDataSize = writeGuanoData(guanoBuffer, configSettings, extendedConfigSettings, eventStartTime, eventStartMilliseconds, gpsLocationReceived, gpsLastFixLatitude, gpsLastFixLongitude, acousticLocationReceived, acousticLatitude, acousticLongitude, firmwareDescription, firmwareVersion, (uint8_t*)AM_UNIQUE_ID_START_ADDRESS, deploymentID, defaultDeploymentID, filename, extendedBatteryState, temperature, requestedFilterType, eventNumberOfDroppedBuffers, &eventFileStatistics);
+
+    RETURN_BOOL_ON_ERROR(timedWriteToFile(guanoBuffer, guanoDataSize));
+
+    /* Write the WAV header */
+
+    setHeaderDetails(&wavHeader, effectiveSampleRate, numberOfSamples, guanoDataSize);
+
+    setHeaderComment(&wavHeader, configSettings, extendedConfigSettings, eventStartTime, (uint8_t*)AM_UNIQUE_ID_START_ADDRESS, deploymentID, defaultDeploymentID, extendedBatteryState, temperature, externalMicrophone, recordingState, requestedFilterType, eventNumberOfDroppedBuffers);
+
+    RETURN_BOOL_ON_ERROR(timedSeekInFile(0));
+
+    RETURN_BOOL_ON_ERROR(timedWriteToFile(&wavHeader, sizeof(wavHeader_t)));
+
+    RETURN_BOOL_ON_ERROR(timedCloseFile());
+
+    return true;
+
+}
+
+static AM_recordingState_t makeRecording(uint32_t timeOfNextRecording, uint32_t recordDuration, bool enableLED, AM_extendedBatteryState_t extendedBatteryState, int32_t temperature, uint32_t *fileOpenTime, uint32_t *fileOpenMilliseconds) {
+
+    /* Initialise buffers */
+
+    writeBuffer = 0;
+
+    writeBufferIndex = 0;
+
+    readBuffer = 0;
+
+    readBufferInUse = false;
+
+    bufferOverrun = false;
+
+    numberOfDroppedBuffers = 0;
+
+    memset(&fileStatistics, 0, sizeof(fileStatistics_t));
+
+    #ifdef ENABLE_INSTRUMENTATION
+
+    Instrumentation_reset();
+
+    #endif
+
+    buffers[0] = (int16_t*)AM_EXTERNAL_SRAM_START_ADDRESS;
+
+    for (uint32_t i = 1; i < NUMBER_OF_BUFFERS; i += 1) {
+        buffers[i] = buffers[i - 1] + NUMBER_OF_SAMPLES_IN_BUFFER;
+    }
+
+    /* Calculate effective sample rate */
 
     uint32_t effectiveSampleRate = configSettings->sampleRate / configSettings->sampleRateDivider;
 
-    /* Set up the digital filter */
+    /* Set up the digital filter and select the arithmetic before the filter and trigger are configured */
+
+    DigitalFilter_setFixedPointArithmetic(configSettings->enableFixedPointFilter);
+
+    DigitalFilter_setDecimationFilter(configSettings->sampleRateDivider);
+
+    DigitalFilter_setFilterOrder(getFilterOrder(configSettings));
 
     uint32_t blockingFilterFrequency = configSettings->disable48HzDCBlockingFilter ? LOW_DC_BLOCKING_FREQ : DEFAULT_DC_BLOCKING_FREQ;
 
@@ -2934,10 +4002,6 @@ static AM_recordingState_t makeRecording(uint32_t timeOfNextRecording, uint32_t
 
     numberOfRawSamplesInDMATransfer *= configSettings->sampleRateDivider;
 
-    /* Calculate the minimum amplitude threshold duration */
-
-    uint32_t minimumNumberOfTriggeredBuffersToWrite = ROUNDED_UP_DIV(configSettings->minimumTriggerDuration * effectiveSampleRate, NUMBER_OF_SAMPLES_IN_BUFFER);
-
     /* Initialise termination conditions */
 
     microphoneChanged = false;
@@ -2952,7 +4016,17 @@ static AM_recordingState_t makeRecording(uint32_t timeOfNextRecording, uint32_t
 
     bool externalMicrophone = AudioMoth_enableMicrophone(gainRange, configSettings->gain, configSettings->clockDivider, configSettings->acquisitionCycles, configSettings->oversampleRate);
 
-    AudioMoth_initialiseDirectMemoryAccess(primaryBuffer, secondaryBuffer, numberOfRawSamplesInDMATransfer);
+    numberOfCompletedDMABlocks = 0;
+
+    numberOfProcessedDMABlocks = 0;
+
+    numberOfInlineDMABlocks = 0;
+
+    mainLoopProcessingDMABlocks = false;
+
+    deferredProcessingEnabled = extendedConfigSettings->enableDeferredProcessing;
+
+    AudioMoth_initialiseDirectMemoryAccess(dmaBuffers[0], dmaBuffers[1], numberOfRawSamplesInDMATransfer);
 
     /* Calculate the sample multiplier */
 
@@ -2968,11 +4042,27 @@ static AM_recordingState_t makeRecording(uint32_t timeOfNextRecording, uint32_t
 
     bool frequencyTriggerEnabled = configSettings->enableFrequencyTrigger;
 
-    bool amplitudeThresholdEnabled = frequencyTriggerEnabled ? false : configSettings->amplitudeThreshold > 0 || configSettings->enableAmplitudeThresholdDecibelScale || configSettings->enableAmplitudeThresholdPercentageScale;
+    bool amplitudeThresholdEnabled = frequencyTriggerEnabled ? false : configSettings->amplitudeThreshold > 0 || configSettings->enableAmplitudeThresholdDecibelScale || configSettings->enableAmplitudeThresholdPercentageScale || extendedConfigSettings->enableAdaptiveAmplitudeThreshold;
 
     /* Configure the digital filter for the appropriate trigger */
-    
-    if (frequencyTriggerEnabled) {
+
+    bool spectralTriggerEnabled = frequencyTriggerEnabled && extendedConfigSettings->enableSpectralTrigger;
+
+    if (spectralTriggerEnabled) {
+
+        uint32_t centreFrequency = FILTER_FREQ_MULTIPLIER * configSettings->frequencyTriggerCentreFrequency;
+
+        uint32_t halfBandwidth = FILTER_FREQ_MULTIPLIER * extendedConfigSettings->spectralTriggerBandwidth / 2;
+
+        uint32_t lowerFrequency = centreFrequency > halfBandwidth ? centreFrequency - halfBandwidth : 0;
+
+        uint32_t higherFrequency = MIN(effectiveSampleRate / 2, centreFrequency + halfBandwidth);
+
+        uint32_t windowLength = MIN(FREQUENCY_TRIGGER_WINDOW_MAXIMUM, MAX(SPECTRAL_TRIGGER_WINDOW_MINIMUM, 1 << configSettings->frequencyTriggerWindowLengthShift));
+
+        DigitalFilter_setSpectralTrigger(windowLength, effectiveSampleRate, lowerFrequency, higherFrequency, (float)extendedConfigSettings->spectralTriggerRatioDecibels);
+
+    } else if (frequencyTriggerEnabled) {
 
         uint32_t frequency = MIN(effectiveSampleRate / 2, FILTER_FREQ_MULTIPLIER * configSettings->frequencyTriggerCentreFrequency);
 
@@ -2982,67 +4072,149 @@ static AM_recordingState_t makeRecording(uint32_t timeOfNextRecording, uint32_t
 
         DigitalFilter_setFrequencyTrigger(windowLength, effectiveSampleRate, frequency, percentageThreshold);
 
+        /* Add any additional target frequencies to the Goertzel filter bank */
+
+        for (uint32_t i = 0; i < MAXIMUM_ADDITIONAL_FREQUENCY_TRIGGERS; i += 1) {
+
+            frequencyTrigger_t *frequencyTrigger = extendedConfigSettings->additionalFrequencyTriggers + i;
+
+            if (frequencyTrigger->centreFrequency == 0) continue;
+
+            frequency = MIN(effectiveSampleRate / 2, FILTER_FREQ_MULTIPLIER * frequencyTrigger->centreFrequency);
+
+            percentageThreshold = (float)frequencyTrigger->thresholdPercentageMantissa * powf(10.0f, (float)frequencyTrigger->thresholdPercentageExponent);
+
+            DigitalFilter_addFrequencyTrigger(effectiveSampleRate, frequency, percentageThreshold);
+
+        }
+
     }
 
     if (amplitudeThresholdEnabled) {
         
         DigitalFilter_setAmplitudeThreshold(configSettings->amplitudeThreshold);
 
+        /* The noise floor is updated once per DMA transfer */
+
+        if (extendedConfigSettings->enableAdaptiveAmplitudeThreshold) DigitalFilter_setAdaptiveAmplitudeThreshold(configSettings->sampleRate / numberOfRawSamplesInDMATransfer, (float)extendedConfigSettings->adaptiveAmplitudeThresholdMarginDecibels);
+
     }
 
+    /* Initialise the trigger state machine which runs on each DMA transfer unless the trigger is evaluated on whole SRAM buffers in the main loop */
+
+    evaluateTriggerInMainLoop = spectralTriggerEnabled || (frequencyTriggerEnabled && configSettings->sampleRateDivider > 1);
+
+    uint32_t numberOfSamplesInTriggerEvaluation = evaluateTriggerInMainLoop ? NUMBER_OF_SAMPLES_IN_BUFFER : numberOfRawSamplesInDMATransfer / configSettings->sampleRateDivider;
+
+    triggerAttackCount = MAX(1, ROUNDED_UP_DIV(TRIGGER_ATTACK_DURATION_STEP_MS * extendedConfigSettings->triggerAttackDuration * effectiveSampleRate, MILLISECONDS_IN_SECOND * numberOfSamplesInTriggerEvaluation));
+
+    triggerHoldOffCount = ROUNDED_UP_DIV(configSettings->minimumTriggerDuration * effectiveSampleRate, numberOfSamplesInTriggerEvaluation);
+
+    triggerState = TRIGGER_IDLE;
+
+    triggerStateCounter = 0;
+
+    DigitalFilter_setTriggerHysteresis((float)extendedConfigSettings->triggerHysteresisDecibels);
+
+    DigitalFilter_setTriggerActive(false);
+
     /* Set the initial header comment details */
 
     AM_recordingState_t recordingState = SDCARD_WRITE_ERROR;
 
     setHeaderDetails(&wavHeader, effectiveSampleRate, 0, 0);
 
-    setHeaderComment(&wavHeader, configSettings, timeOfNextRecording, (uint8_t*)AM_UNIQUE_ID_START_ADDRESS, deploymentID, defaultDeploymentID, extendedBatteryState, temperature, externalMicrophone, recordingState, requestedFilterType);
-
-    /* Show LED for SD card activity */
-
-    if (enableLED) AudioMoth_setRedLED(true);
+    setHeaderComment(&wavHeader, configSettings, extendedConfigSettings, timeOfNextRecording, (uint8_t*)AM_UNIQUE_ID_START_ADDRESS, deploymentID, defaultDeploymentID, extendedBatteryState, temperature, externalMicrophone, recordingState, requestedFilterType, numberOfDroppedBuffers);
 
-    /* Open a file with the current local time as the name */
+    /* File and folder names */
 
     static char filename[MAXIMUM_FILE_NAME_LENGTH];
 
     static char foldername[MAXIMUM_FILE_NAME_LENGTH];
 
-    generateFolderAndFilename(foldername, filename, timeOfNextRecording, frequencyTriggerEnabled || amplitudeThresholdEnabled);
+    /* Open a file with the current local time as the name unless each triggered event will be written to its own file */
 
-    if (configSettings->enableDailyFolders) {
+    bool eventFilesEnabled = (frequencyTriggerEnabled || amplitudeThresholdEnabled) && extendedConfigSettings->enableEventFiles;
 
-        bool directoryExists = AudioMoth_doesDirectoryExist(foldername);
+    /* Event files are always written as WAV files */
+
+    bool flacEnabled = extendedConfigSettings->fileFormat == FLAC_FILE_FORMAT && eventFilesEnabled == false;
+
+    if (flacEnabled) FLAC_initialise(effectiveSampleRate);
+
+    bool imaAdpcmEnabled = extendedConfigSettings->fileFormat == IMA_ADPCM_FILE_FORMAT && eventFilesEnabled == false;
+
+    if (imaAdpcmEnabled) {
+
+        ADPCM_initialise();
 
-        if (directoryExists == false) FLASH_LED_AND_RETURN_ON_ERROR(AudioMoth_makeDirectory(foldername));
+        setImaAdpcmHeaderDetails(&imaAdpcmHeader, &wavHeader, effectiveSampleRate, 0, 0, 0);
 
     }
 
-    FLASH_LED_AND_RETURN_ON_ERROR(AudioMoth_openFile(filename));
+    /* Preallocate continuous uncompressed recordings whose maximum length is known in advance with space for the GUANO data */
 
-    /* Write the header */
+    bool filePreallocationEnabled = extendedConfigSettings->enableFilePreallocation && frequencyTriggerEnabled == false && amplitudeThresholdEnabled == false && flacEnabled == false && imaAdpcmEnabled == false;
 
-    FLASH_LED_AND_RETURN_ON_ERROR(AudioMoth_writeToFile(&wavHeader, sizeof(wavHeader_t)));    
+    uint32_t preallocatedFileSize = sizeof(wavHeader_t) + NUMBER_OF_BYTES_IN_SAMPLE * effectiveSampleRate * MIN(recordDuration, (MAXIMUM_WAV_FILE_SIZE - sizeof(wavHeader_t)) / NUMBER_OF_BYTES_IN_SAMPLE / effectiveSampleRate) + GUANO_BUFFER_SIZE_IN_BYTES;
 
-    FLASH_LED_AND_RETURN_ON_ERROR(AudioMoth_syncFile());
+    if (eventFilesEnabled == false) {
 
-    FLASH_LED_AND_RETURN_ON_ERROR(AudioMoth_seekInFile(0));
+        /* Show LED for SD card activity */
 
-    AudioMoth_setRedLED(false);
+        if (enableLED) AudioMoth_setRedLED(true);
 
-    /* Measure the time difference from the start time */
+        generateFolderAndFilename(foldername, filename, timeOfNextRecording, frequencyTriggerEnabled || amplitudeThresholdEnabled, flacEnabled);
 
-    AudioMoth_getTime(fileOpenTime, fileOpenMilliseconds);
+        if (configSettings->enableDailyFolders) {
+
+            bool directoryExists = AudioMoth_doesDirectoryExist(foldername);
+
+            if (directoryExists == false) FLASH_LED_AND_RETURN_ON_ERROR(AudioMoth_makeDirectory(foldername));
+
+        }
+
+        FLASH_LED_AND_RETURN_ON_ERROR(AudioMoth_openFile(filename));
+
+        /* Write the header which is rewritten with the final details when the file is closed */
+
+        if (flacEnabled) {
 
-    /* Calculate time correction for sample rate due to file header */
+            FLASH_LED_AND_RETURN_ON_ERROR(timedWriteToFile(FLAC_encodeHeader(wavHeader.iart.artist, wavHeader.icmt.comment), FLAC_HEADER_SIZE));
 
-    uint32_t numberOfSamplesInHeader = sizeof(wavHeader_t) / NUMBER_OF_BYTES_IN_SAMPLE;
+            FLASH_LED_AND_RETURN_ON_ERROR(timedSyncFile());
 
-    int32_t sampleRateTimeOffset = ROUNDED_DIV(numberOfSamplesInHeader * MILLISECONDS_IN_SECOND, effectiveSampleRate);
+        } else if (imaAdpcmEnabled) {
+
+            FLASH_LED_AND_RETURN_ON_ERROR(writeImaAdpcmHeader());
+
+            FLASH_LED_AND_RETURN_ON_ERROR(timedSyncFile());
+
+        } else {
+
+            FLASH_LED_AND_RETURN_ON_ERROR(timedWriteToFile(&wavHeader, sizeof(wavHeader_t)));    
+
+            /* Seeking beyond the end of the file allocates the cluster chain before the microphone is started */
+
+            if (filePreallocationEnabled) FLASH_LED_AND_RETURN_ON_ERROR(timedSeekInFile(preallocatedFileSize));
+
+            FLASH_LED_AND_RETURN_ON_ERROR(timedSyncFile());
+
+            if (filePreallocationEnabled) FLASH_LED_AND_RETURN_ON_ERROR(timedSeekInFile(sizeof(wavHeader_t)));
+
+        }
+
+        AudioMoth_setRedLED(false);
+
+    }
+
+    /* Measure the time difference from the start time */
+
+    AudioMoth_getTime(fileOpenTime, fileOpenMilliseconds);
 
     /* Calculate time until the recording should start */
 
-    int64_t millisecondsUntilRecordingShouldStart = (int64_t)timeOfNextRecording * MILLISECONDS_IN_SECOND - (int64_t)*fileOpenTime * MILLISECONDS_IN_SECOND - (int64_t)*fileOpenMilliseconds - (int64_t)sampleRateTimeOffset;
+    int64_t millisecondsUntilRecordingShouldStart = (int64_t)timeOfNextRecording * MILLISECONDS_IN_SECOND - (int64_t)*fileOpenTime * MILLISECONDS_IN_SECOND - (int64_t)*fileOpenMilliseconds;
 
     /* Calculate the actual recording start time if the intended start has been missed */
 
@@ -3074,19 +4246,33 @@ static AM_recordingState_t makeRecording(uint32_t timeOfNextRecording, uint32_t
 
     /* Initialise main loop variables */
 
-    uint32_t readBuffer = 0;
-
     uint32_t samplesWritten = 0;
 
-    uint32_t buffersProcessed = 0;
-
     uint32_t numberOfCompressedBuffers = 0;
 
     uint32_t totalNumberOfCompressedSamples = 0;
 
-    uint32_t numberOfTriggeredBuffersWritten = 0;
+    uint32_t numberOfImaAdpcmBytes = 0;
+
+    /* Initialise the event file variables */
+
+    bool eventFileOpen = false;
+
+    uint32_t eventStartTime = 0;
+
+    uint32_t eventStartMilliseconds = 0;
 
-    bool triggerHasOccurred = false;
+    uint32_t eventSamplesWritten = 0;
+
+    uint32_t eventQuietSamples = 0;
+
+    uint32_t eventHoldOffSamples = MAX(MINIMUM_EVENT_FILE_HOLD_OFF, extendedConfigSettings->eventFileHoldOff) * effectiveSampleRate;
+
+    /* Initialise the trigger evaluation buffer which runs ahead of the read buffer to provide pre-trigger audio */
+
+    uint32_t evaluateBuffer = 0;
+
+    uint32_t numberOfPreTriggerBuffers = frequencyTriggerEnabled || amplitudeThresholdEnabled ? MIN(MAXIMUM_NUMBER_OF_PRE_TRIGGER_BUFFERS, configSettings->preTriggerBuffers) : 0;
 
     /* Start processing DMA transfers */
 
@@ -3098,31 +4284,183 @@ static AM_recordingState_t makeRecording(uint32_t timeOfNextRecording, uint32_t
 
     /* Main recording loop */
 
-    while (samplesWritten < numberOfSamples + numberOfSamplesInHeader && !microphoneChanged && !switchPositionChanged && !magneticSwitch && !supplyVoltageLow) {
+    while (samplesWritten < numberOfSamples && !microphoneChanged && !switchPositionChanged && !magneticSwitch && !supplyVoltageLow && !bufferOverrun) {
+
+        /* Process any DMA blocks queued since the main loop last woke */
+
+        processDeferredDMABlocks();
+
+        while (readBuffer != writeBuffer && samplesWritten < numberOfSamples && !microphoneChanged && !switchPositionChanged && !magneticSwitch && !supplyVoltageLow && !bufferOverrun) {
+
+            /* Stop an overrun discarding the read buffer while it is evaluated, encoded or written to the SD card */
+
+            readBufferInUse = true;
+
+            /* Evaluate the trigger for each filled buffer */
+
+            while (evaluateBuffer != writeBuffer) {
+
+                if (spectralTriggerEnabled) {
+
+                    INSTRUMENTATION_START(triggerStartCycles);
+
+                    writeIndicator[evaluateBuffer] = updateTriggerState(DigitalFilter_applySpectralTrigger(buffers[evaluateBuffer], NUMBER_OF_SAMPLES_IN_BUFFER));
+
+                    INSTRUMENTATION_STOP(INSTRUMENTATION_TRIGGER, triggerStartCycles);
+
+                } else if (frequencyTriggerEnabled && configSettings->sampleRateDivider > 1) {
+
+                    INSTRUMENTATION_START(triggerStartCycles);
+
+                    writeIndicator[evaluateBuffer] = updateTriggerState(DigitalFilter_applyFrequencyTrigger(buffers[evaluateBuffer], NUMBER_OF_SAMPLES_IN_BUFFER));
+
+                    INSTRUMENTATION_STOP(INSTRUMENTATION_TRIGGER, triggerStartCycles);
+
+                }
+
+                evaluateBuffer = (evaluateBuffer + 1) & (NUMBER_OF_BUFFERS - 1);
+
+            }
+
+            /* Record the peak number of filled buffers waiting to be written */
+
+            fileStatistics.peakBufferOccupancy = MAX(fileStatistics.peakBufferOccupancy, (writeBuffer - readBuffer) & (NUMBER_OF_BUFFERS - 1));
+
+            uint32_t currentBuffer = readBuffer;
+
+            /* Hold the buffer in SRAM until enough later buffers have been evaluated to decide whether it is pre-trigger audio */
 
-        while (readBuffer != writeBuffer && samplesWritten < numberOfSamples + numberOfSamplesInHeader && !microphoneChanged && !switchPositionChanged && !magneticSwitch && !supplyVoltageLow) {
+            uint32_t numberOfEvaluatedBuffers = (evaluateBuffer - currentBuffer) & (NUMBER_OF_BUFFERS - 1);
+
+            bool allBuffersEvaluated = samplesWritten + numberOfEvaluatedBuffers * NUMBER_OF_SAMPLES_IN_BUFFER >= numberOfSamples;
+
+            if (numberOfEvaluatedBuffers <= numberOfPreTriggerBuffers && allBuffersEvaluated == false) {
+
+                readBufferInUse = false;
+
+                break;
+
+            }
 
             /* Determine the appropriate number of bytes to the SD card */
 
-            uint32_t numberOfSamplesToWrite = MIN(numberOfSamples + numberOfSamplesInHeader - samplesWritten, NUMBER_OF_SAMPLES_IN_BUFFER);
+            uint32_t numberOfSamplesToWrite = MIN(numberOfSamples - samplesWritten, NUMBER_OF_SAMPLES_IN_BUFFER);
 
             /* Check if this buffer should actually be written to the SD card */
 
-            bool writeIndicated = (amplitudeThresholdEnabled == false && frequencyTriggerEnabled == false) || writeIndicator[readBuffer];
+            bool shouldWriteThisSector = shouldWriteBuffer(currentBuffer, numberOfEvaluatedBuffers, numberOfPreTriggerBuffers, frequencyTriggerEnabled || amplitudeThresholdEnabled);
+
+            uint32_t numberOfBuffersToWrite = 1;
+
+            /* Write the buffer to the file for the current event, encode the buffer as FLAC frames or IMA-ADPCM blocks, compress the buffer or write the buffer to SD card */
+
+            bool startEvent = eventFilesEnabled && eventFileOpen == false && shouldWriteThisSector;
+
+            if (eventFilesEnabled) {
+
+                if (eventFileOpen || startEvent) {
+
+                    /* Light LED during SD card write if appropriate */
+
+                    if (enableLED) AudioMoth_setRedLED(true);
+
+                    /* Open a new file timestamped at the first sample of the buffer */
+
+                    if (startEvent) {
+
+                        uint64_t eventOffset = ROUNDED_DIV((uint64_t)samplesWritten * MILLISECONDS_IN_SECOND, effectiveSampleRate);
+
+                        eventStartTime = timeOfNextRecording + timeOffset + eventOffset / MILLISECONDS_IN_SECOND;
+
+                        eventStartMilliseconds = eventOffset % MILLISECONDS_IN_SECOND;
+
+                        FLASH_LED_AND_RETURN_ON_ERROR(openEventFile(foldername, filename, eventStartTime));
+
+                        eventFileOpen = true;
+
+                        eventSamplesWritten = 0;
+
+                    }
+
+                    FLASH_LED_AND_RETURN_ON_ERROR(timedWriteToFile(buffers[currentBuffer], NUMBER_OF_BYTES_IN_SAMPLE * numberOfSamplesToWrite));
+
+                    eventSamplesWritten += numberOfSamplesToWrite;
+
+                    eventQuietSamples = shouldWriteThisSector ? 0 : eventQuietSamples + numberOfSamplesToWrite;
+
+                    /* Close the file once the trigger has been quiet for the hold-off period */
+
+                    if (eventQuietSamples >= eventHoldOffSamples) {
 
-            if (frequencyTriggerEnabled && configSettings->sampleRateDivider > 1) writeIndicated = DigitalFilter_applyFrequencyTrigger(buffers[readBuffer], NUMBER_OF_SAMPLES_IN_BUFFER);
+                        FLASH_LED_AND_RETURN_ON_ERROR(closeEventFile(filename, eventStartTime, eventStartMilliseconds, eventSamplesWritten, effectiveSampleRate, externalMicrophone, RECORDING_OKAY, extendedBatteryState, temperature));
 
-            /* Ensure the minimum number of buffers will be written */
+                        eventFileOpen = false;
 
-            triggerHasOccurred |= writeIndicated;
+                    }
+
+                    /* Clear LED */
+
+                    AudioMoth_setRedLED(false);
+
+                }
+
+            } else if (flacEnabled) {
+
+                /* Light LED during SD card write if appropriate */
+
+                if (enableLED) AudioMoth_setRedLED(true);
+
+                /* Encode the buffer or a blank buffer one frame at a time */
+
+                for (uint32_t i = 0; i < numberOfSamplesToWrite; i += FLAC_BLOCK_SIZE) {
+
+                    uint32_t frameSize;
+
+                    uint32_t numberOfFrameSamples = MIN(numberOfSamplesToWrite - i, FLAC_BLOCK_SIZE);
+
+                    uint8_t *frame = shouldWriteThisSector ? FLAC_encodeFrame(buffers[currentBuffer] + i, numberOfFrameSamples, &frameSize) : FLAC_encodeSilentFrame(numberOfFrameSamples, &frameSize);
+
+                    FLASH_LED_AND_RETURN_ON_ERROR(timedWriteToFile(frame, frameSize));
+
+                    processDeferredDMABlocks();
+
+                }
+
+                /* Clear LED */
+
+                AudioMoth_setRedLED(false);
+
+            } else if (imaAdpcmEnabled) {
+
+                /* Light LED during SD card write if appropriate */
+
+                if (enableLED) AudioMoth_setRedLED(true);
 
-            numberOfTriggeredBuffersWritten = writeIndicated ? 0 : numberOfTriggeredBuffersWritten + 1;
+                /* Encode the buffer or silence one block at a time. Silence is encoded as genuine blocks as a compression buffer cannot be expanded within IMA-ADPCM data */
 
-            bool shouldWriteThisSector = writeIndicated || (triggerHasOccurred && numberOfTriggeredBuffersWritten < minimumNumberOfTriggeredBuffersToWrite);
+                uint32_t numberOfSamplesEncoded = 0;
 
-            /* Compress the buffer or write the buffer to SD card */
+                while (numberOfSamplesEncoded < numberOfSamplesToWrite) {
 
-            if (shouldWriteThisSector == false && buffersProcessed > 0 && numberOfSamplesToWrite == NUMBER_OF_SAMPLES_IN_BUFFER) {
+                    uint8_t *block;
+
+                    numberOfSamplesEncoded += ADPCM_encode(shouldWriteThisSector ? buffers[currentBuffer] + numberOfSamplesEncoded : NULL, numberOfSamplesToWrite - numberOfSamplesEncoded, &block);
+
+                    if (block) {
+
+                        FLASH_LED_AND_RETURN_ON_ERROR(timedWriteToFile(block, ADPCM_BLOCK_SIZE));
+
+                        numberOfImaAdpcmBytes += ADPCM_BLOCK_SIZE;
+
+                    }
+
+                }
+
+                /* Clear LED */
+
+                AudioMoth_setRedLED(false);
+
+            } else if (shouldWriteThisSector == false && numberOfSamplesToWrite == NUMBER_OF_SAMPLES_IN_BUFFER) {
 
                 numberOfCompressedBuffers += NUMBER_OF_BYTES_IN_SAMPLE * NUMBER_OF_SAMPLES_IN_BUFFER / COMPRESSION_BUFFER_SIZE_IN_BYTES;
 
@@ -3140,7 +4478,7 @@ static AM_recordingState_t makeRecording(uint32_t timeOfNextRecording, uint32_t
 
                     totalNumberOfCompressedSamples += (numberOfCompressedBuffers - 1) * COMPRESSION_BUFFER_SIZE_IN_BYTES / NUMBER_OF_BYTES_IN_SAMPLE;
 
-                    FLASH_LED_AND_RETURN_ON_ERROR(AudioMoth_writeToFile(compressionBuffer, COMPRESSION_BUFFER_SIZE_IN_BYTES));
+                    FLASH_LED_AND_RETURN_ON_ERROR(timedWriteToFile(compressionBuffer, COMPRESSION_BUFFER_SIZE_IN_BYTES));
 
                     numberOfCompressedBuffers = 0;
 
@@ -3150,35 +4488,35 @@ static AM_recordingState_t makeRecording(uint32_t timeOfNextRecording, uint32_t
 
                 if (shouldWriteThisSector) {
 
-                    if (buffersProcessed == 0) memcpy(buffers[readBuffer], &wavHeader, sizeof(wavHeader_t));
-                        
-                    FLASH_LED_AND_RETURN_ON_ERROR(AudioMoth_writeToFile(buffers[readBuffer], NUMBER_OF_BYTES_IN_SAMPLE * numberOfSamplesToWrite));
+                    /* Extend the write over later buffers which are ready, physically contiguous in SRAM and should also be written */
 
-                } else {
+                    while (currentBuffer + numberOfBuffersToWrite < NUMBER_OF_BUFFERS && numberOfBuffersToWrite < numberOfEvaluatedBuffers) {
 
-                    clearCompressionBuffer();
+                        uint32_t numberOfLaterEvaluatedBuffers = numberOfEvaluatedBuffers - numberOfBuffersToWrite;
 
-                    uint32_t blankBuffersWritten = 0;
+                        bool nextBufferReady = numberOfLaterEvaluatedBuffers > numberOfPreTriggerBuffers || allBuffersEvaluated;
 
-                    uint32_t numberOfBlankSamplesToWrite = numberOfSamplesToWrite;
+                        bool nextBufferFull = samplesWritten + (numberOfBuffersToWrite + 1) * NUMBER_OF_SAMPLES_IN_BUFFER <= numberOfSamples;
 
-                    while (numberOfBlankSamplesToWrite > 0) {
+                        if (nextBufferReady == false || nextBufferFull == false) break;
 
-                        uint32_t numberOfSamples = MIN(numberOfBlankSamplesToWrite, COMPRESSION_BUFFER_SIZE_IN_BYTES / NUMBER_OF_BYTES_IN_SAMPLE);
+                        if (shouldWriteBuffer(currentBuffer + numberOfBuffersToWrite, numberOfLaterEvaluatedBuffers, numberOfPreTriggerBuffers, frequencyTriggerEnabled || amplitudeThresholdEnabled) == false) break;
 
-                        bool writeHeader = buffersProcessed == 0 && blankBuffersWritten == 0 && numberOfSamples >= sizeof(wavHeader_t) / NUMBER_OF_BYTES_IN_SAMPLE;
+                        numberOfBuffersToWrite += 1;
 
-                        if (writeHeader) memcpy(compressionBuffer, &wavHeader, sizeof(wavHeader_t));
+                    }
 
-                        FLASH_LED_AND_RETURN_ON_ERROR(AudioMoth_writeToFile(compressionBuffer, NUMBER_OF_BYTES_IN_SAMPLE * numberOfSamples));
-                            
-                        if (writeHeader) memset(compressionBuffer, 0, sizeof(wavHeader_t));
+                    numberOfSamplesToWrite += (numberOfBuffersToWrite - 1) * NUMBER_OF_SAMPLES_IN_BUFFER;
 
-                        numberOfBlankSamplesToWrite -= numberOfSamples;
+                    FLASH_LED_AND_RETURN_ON_ERROR(timedWriteToFile(buffers[currentBuffer], NUMBER_OF_BYTES_IN_SAMPLE * numberOfSamplesToWrite));
 
-                        blankBuffersWritten += 1;
+                } else {
 
-                    }
+                    /* Clear the discarded buffer in SRAM so the blank region is a single write */
+
+                    memset(buffers[currentBuffer], 0, NUMBER_OF_BYTES_IN_SAMPLE * numberOfSamplesToWrite);
+
+                    FLASH_LED_AND_RETURN_ON_ERROR(timedWriteToFile(buffers[currentBuffer], NUMBER_OF_BYTES_IN_SAMPLE * numberOfSamplesToWrite));
 
                 }
 
@@ -3190,11 +4528,15 @@ static AM_recordingState_t makeRecording(uint32_t timeOfNextRecording, uint32_t
 
             /* Increment buffer counters */
 
-            readBuffer = (readBuffer + 1) & (NUMBER_OF_BUFFERS - 1);
+            readBuffer = (currentBuffer + numberOfBuffersToWrite) & (NUMBER_OF_BUFFERS - 1);
+
+            readBufferInUse = false;
 
             samplesWritten += numberOfSamplesToWrite;
 
-            buffersProcessed += 1;
+            /* Process DMA blocks queued during the SD card write */
+
+            processDeferredDMABlocks();
 
         }
 
@@ -3208,13 +4550,53 @@ static AM_recordingState_t makeRecording(uint32_t timeOfNextRecording, uint32_t
 
         /* Sleep until next DMA transfer is complete */
 
+        #ifdef ENABLE_INSTRUMENTATION
+
+        uint32_t sleepStartTime = getMillisecondTime();
+
+        #endif
+
         AudioMoth_sleep();
 
+        #ifdef ENABLE_INSTRUMENTATION
+
+        Instrumentation_addMeasurement(INSTRUMENTATION_SLEEP, getMillisecondTime() - sleepStartTime);
+
+        #endif
+
+    }
+
+    /* Write the final partial block of the IMA-ADPCM file */
+
+    if (imaAdpcmEnabled) {
+
+        /* Light LED during SD card write if appropriate */
+
+        if (enableLED) AudioMoth_setRedLED(true);
+
+        /* Write partial block */
+
+        uint32_t blockSize;
+
+        uint8_t *block = ADPCM_flush(&blockSize);
+
+        if (block) {
+
+            FLASH_LED_AND_RETURN_ON_ERROR(timedWriteToFile(block, blockSize));
+
+            numberOfImaAdpcmBytes += blockSize;
+
+        }
+
+        /* Clear LED */
+
+        AudioMoth_setRedLED(false);
+
     }
 
     /* Write the compression buffer files at the end */
 
-    if (samplesWritten < numberOfSamples + numberOfSamplesInHeader && numberOfCompressedBuffers > 0) {
+    if (eventFilesEnabled == false && samplesWritten < numberOfSamples && numberOfCompressedBuffers > 0) {
 
         /* Light LED during SD card write if appropriate */
 
@@ -3226,7 +4608,7 @@ static AM_recordingState_t makeRecording(uint32_t timeOfNextRecording, uint32_t
 
         totalNumberOfCompressedSamples += (numberOfCompressedBuffers - 1) * COMPRESSION_BUFFER_SIZE_IN_BYTES / NUMBER_OF_BYTES_IN_SAMPLE;
 
-        FLASH_LED_AND_RETURN_ON_ERROR(AudioMoth_writeToFile(compressionBuffer, COMPRESSION_BUFFER_SIZE_IN_BYTES));
+        FLASH_LED_AND_RETURN_ON_ERROR(timedWriteToFile(compressionBuffer, COMPRESSION_BUFFER_SIZE_IN_BYTES));
 
         /* Clear LED */
 
@@ -3240,48 +4622,101 @@ static AM_recordingState_t makeRecording(uint32_t timeOfNextRecording, uint32_t
                      switchPositionChanged ? SWITCH_CHANGED :
                      magneticSwitch ? MAGNETIC_SWITCH :
                      supplyVoltageLow ? SUPPLY_VOLTAGE_LOW :
+                     bufferOverrun ? BUFFER_OVERRUN :
                      fileSizeLimited ? FILE_SIZE_LIMITED :
                      RECORDING_OKAY;
 
+    /* Close the file for the last event */
+
+    if (eventFilesEnabled) {
+
+        if (eventFileOpen) {
+
+            if (enableLED) AudioMoth_setRedLED(true);
+
+            FLASH_LED_AND_RETURN_ON_ERROR(closeEventFile(filename, eventStartTime, eventStartMilliseconds, eventSamplesWritten, effectiveSampleRate, externalMicrophone, recordingState, extendedBatteryState, temperature));
+
+            AudioMoth_setRedLED(false);
+
+        }
+
+        return recordingState;
+
+    }
+
     /* Generate the new file name if necessary */
     
     static char newFilename[MAXIMUM_FILE_NAME_LENGTH];
 
     if (timeOffset > 0) {
 
-        generateFolderAndFilename(foldername, newFilename, timeOfNextRecording + timeOffset, frequencyTriggerEnabled || amplitudeThresholdEnabled);
+        generateFolderAndFilename(foldername, newFilename, timeOfNextRecording + timeOffset, frequencyTriggerEnabled || amplitudeThresholdEnabled, flacEnabled);
 
     }
 
-    /* Write the GUANO data */
+    if (flacEnabled) {
 
-    bool gpsLocationReceived = getBackupFlag(BACKUP_GPS_LOCATION_RECEIVED);
+        /* Write the FLAC header with the final stream details and header comment */
 
-    bool acousticLocationReceived = getBackupFlag(BACKUP_ACOUSTIC_LOCATION_RECEIVED);
+        setHeaderComment(&wavHeader, configSettings, extendedConfigSettings, timeOfNextRecording + timeOffset, (uint8_t*)AM_UNIQUE_ID_START_ADDRESS, deploymentID, defaultDeploymentID, extendedBatteryState, temperature, externalMicrophone, recordingState, requestedFilterType, numberOfDroppedBuffers);
+
+        if (enableLED) AudioMoth_setRedLED(true);
+
+        FLASH_LED_AND_RETURN_ON_ERROR(timedSeekInFile(0));
+
+        FLASH_LED_AND_RETURN_ON_ERROR(timedWriteToFile(FLAC_encodeHeader(wavHeader.iart.artist, wavHeader.icmt.comment), FLAC_HEADER_SIZE));
+
+    } else {
+
+        /* Write the GUANO data */
+
+        bool gpsLocationReceived = getBackupFlag(BACKUP_GPS_LOCATION_RECEIVED);
+
+        bool acousticLocationReceived = getBackupFlag(BACKUP_ACOUSTIC_LOCATION_RECEIVED);
+
+        uint32_t guanoDataSize = writeGuanoData(guanoBuffer, configSettings, extendedConfigSettings, timeOfNextRecording + timeOffset, 0, gpsLocationReceived, gpsLastFixLatitude, gpsLastFixLongitude, acousticLocationReceived, acousticLatitude, acousticLongitude, firmwareDescription, firmwareVersion, (uint8_t*)AM_UNIQUE_ID_START_ADDRESS, deploymentID, defaultDeploymentID, timeOffset > 0 ? newFilename : filename, extendedBatteryState, temperature, requestedFilterType, numberOfDroppedBuffers, &fileStatistics);
+
+        FLASH_LED_AND_RETURN_ON_ERROR(timedWriteToFile(guanoBuffer, guanoDataSize));
 
-    uint32_t guanoDataSize = writeGuanoData((char*)compressionBuffer, configSettings, timeOfNextRecording + timeOffset, gpsLocationReceived, gpsLastFixLatitude, gpsLastFixLongitude, acousticLocationReceived, acousticLatitude, acousticLongitude, firmwareDescription, firmwareVersion, (uint8_t*)AM_UNIQUE_ID_START_ADDRESS, deploymentID, defaultDeploymentID, timeOffset > 0 ? newFilename : filename, extendedBatteryState, temperature, requestedFilterType);
+        /* Release the unused preallocated space after the GUANO data */
 
-    FLASH_LED_AND_RETURN_ON_ERROR(AudioMoth_writeToFile(compressionBuffer, guanoDataSize));
+        if (filePreallocationEnabled) FLASH_LED_AND_RETURN_ON_ERROR(timedTruncateFile());
 
-    /* Initialise the WAV header */
+        /* Initialise the WAV header */
 
-    samplesWritten = MAX(numberOfSamplesInHeader, samplesWritten);
+        if (imaAdpcmEnabled) {
 
-    setHeaderDetails(&wavHeader, effectiveSampleRate, samplesWritten - numberOfSamplesInHeader - totalNumberOfCompressedSamples, guanoDataSize);
+            setImaAdpcmHeaderDetails(&imaAdpcmHeader, &wavHeader, effectiveSampleRate, samplesWritten - totalNumberOfCompressedSamples, numberOfImaAdpcmBytes, guanoDataSize);
 
-    setHeaderComment(&wavHeader, configSettings, timeOfNextRecording + timeOffset, (uint8_t*)AM_UNIQUE_ID_START_ADDRESS, deploymentID, defaultDeploymentID, extendedBatteryState, temperature, externalMicrophone, recordingState, requestedFilterType);
+        } else {
+
+            setHeaderDetails(&wavHeader, effectiveSampleRate, samplesWritten - totalNumberOfCompressedSamples, guanoDataSize);
+
+        }
+
+        setHeaderComment(&wavHeader, configSettings, extendedConfigSettings, timeOfNextRecording + timeOffset, (uint8_t*)AM_UNIQUE_ID_START_ADDRESS, deploymentID, defaultDeploymentID, extendedBatteryState, temperature, externalMicrophone, recordingState, requestedFilterType, numberOfDroppedBuffers);
+
+        /* Write the header */
+
+        if (enableLED) AudioMoth_setRedLED(true);
+
+        FLASH_LED_AND_RETURN_ON_ERROR(timedSeekInFile(0));
 
-    /* Write the header */
+        if (imaAdpcmEnabled) {
 
-    if (enableLED) AudioMoth_setRedLED(true);
+            FLASH_LED_AND_RETURN_ON_ERROR(writeImaAdpcmHeader());
+
+        } else {
 
-    FLASH_LED_AND_RETURN_ON_ERROR(AudioMoth_seekInFile(0));
+            FLASH_LED_AND_RETURN_ON_ERROR(timedWriteToFile(&wavHeader, sizeof(wavHeader_t)));
 
-    FLASH_LED_AND_RETURN_ON_ERROR(AudioMoth_writeToFile(&wavHeader, sizeof(wavHeader_t)));
+        }
+
+    }
 
     /* Close the file */
 
-    FLASH_LED_AND_RETURN_ON_ERROR(AudioMoth_closeFile());
+    FLASH_LED_AND_RETURN_ON_ERROR(timedCloseFile());
 
     AudioMoth_setRedLED(false);
 